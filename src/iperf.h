@@ -46,9 +46,46 @@
 #include "timer.h"
 #include "queue.h"
 #include "cjson.h"
+#include "iperf_histogram.h"
+#include "iperf_seqwin.h"
+#include "iperf_perf.h"
+#include "iperf_fairness.h"
+#include "net.h"
 
 typedef uint64_t iperf_size_t;
 
+/*
+ * Where a TCP sender's time went, from extended TCP_INFO (Linux 4.10
+ * and later).  busy is all the time there was data to send, of which
+ * rwnd and sndbuf were spent waiting on the receive window and the
+ * send buffer; the rest of busy was up to cwnd, and the time that was
+ * not busy was up to the application.  Any of them is -1 if the
+ * kernel does not report it.
+ */
+struct iperf_tcp_limits
+{
+    int64_t   busy;			/* us */
+    int64_t   rwnd;			/* us */
+    int64_t   sndbuf;			/* us */
+    int64_t   bytes_retrans;		/* Linux 4.19 and later */
+    int64_t   delivery_rate;		/* bytes/sec, latest; Linux 4.9 and later */
+};
+
+/*
+ * What a TCP receiver sees of its own socket: the receive-side RTT
+ * estimate, the autotuned receive space and window clamp, segments
+ * that arrived out of order and the bytes queued unread.  Any of them
+ * is -1 if the kernel does not report it.
+ */
+struct iperf_tcp_rcv
+{
+    int64_t   rcv_rtt;			/* us */
+    int64_t   rcv_space;		/* bytes */
+    int64_t   rcv_ssthresh;		/* bytes */
+    int64_t   ooopack;			/* Linux 5.4 and later */
+    int64_t   inq;			/* bytes, SIOCINQ */
+};
+
 struct iperf_interval_results
 {
     iperf_size_t bytes_transferred; /* bytes transfered in this interval */
@@ -64,6 +101,8 @@ struct iperf_interval_results
     double    jitter;
     int       outoforder_packets;
     int       cnt_error;
+    int64_t   interval_socket_drops;	/* of interval_cnt_error, -1 if unknown */
+    int64_t   socket_drops;
 
     int omitted;
 #if defined(linux) || defined(__FreeBSD__)
@@ -75,11 +114,34 @@ struct iperf_interval_results
     int interval_retrans;
     int interval_sacks;
     int snd_cwnd;
-    TAILQ_ENTRY(iperf_interval_results) irlistentries;
     void     *custom_data;
     int rtt;
+    double    target_rate;	/* --rate-schedule: mean target over the interval */
+    int       rate_step;	/* --rate-schedule: step in effect */
+    struct iperf_histogram_summary owd;		/* UDP receiver: one-way delay */
+    struct iperf_histogram_summary ipdv;	/* UDP receiver: |D(i-1,i)| */
+    struct iperf_seqwin_counts seqwin;		/* UDP receiver: reordering and loss bursts */
+    iperf_size_t interval_transactions;		/* --rr */
+    struct iperf_histogram_summary rr_rtt;	/* --rr client: round-trip times */
+    iperf_size_t interval_failures;		/* --crr client: failed connections */
+    struct iperf_histogram_summary crr_connect;	/* --crr client: connect times */
+    struct iperf_tcp_limits limits;		/* TCP sender, over the interval */
+    struct iperf_tcp_rcv rcv;			/* TCP receiver, at the interval end */
+    double cpu_user;				/* CPU seconds of the I/O thread */
+    double cpu_system;				/*   over the interval */
+    struct iperf_perf_counts perf;		/* --perf-counters, over the interval */
+    struct net_stats io;			/* data path system calls */
+    struct net_sockmem sockmem;			/* at the interval end */
 };
 
+/*
+ * Interval results are kept in a small ring per stream: the interval
+ * being reported, and the one before it, which the next interval is
+ * measured from.  Whatever the summary needs is accumulated as the
+ * test goes, so memory does not grow with the length of the test.
+ */
+#define IPERF_INTERVAL_RING 2
+
 struct iperf_stream_result
 {
     iperf_size_t bytes_received;
@@ -95,9 +157,15 @@ struct iperf_stream_result
     int stream_sum_rtt;
     int stream_count_rtt;
     int stream_max_snd_cwnd;
+    struct iperf_tcp_limits stream_prev_limits;	/* totals at the last interval */
+    struct iperf_tcp_limits stream_limits;	/* since the start of the test */
+    int64_t stream_prev_ooopack;		/* total at the last interval */
+    struct iperf_tcp_rcv stream_rcv;		/* latest, with ooopack total and inq max */
     struct timeval start_time;
     struct timeval end_time;
-    TAILQ_HEAD(irlisthead, iperf_interval_results) interval_results;
+    struct iperf_interval_results interval_ring[IPERF_INTERVAL_RING];
+    int interval_count;				/* intervals added, ever */
+    struct iperf_fairness_series *rate_series;	/* -P: for the steady share */
     void     *data;
 };
 
@@ -140,6 +208,8 @@ struct iperf_stream
     int       buffer_fd;	/* data to send, file descriptor */
     char      *buffer;		/* data to send, mmapped */
     int       diskfile_fd;	/* file to send, file descriptor */
+    struct net_stats io;	/* data path system calls since the start */
+    struct net_stats io_mark;	/* ... at the last stats interval */
 
     /*
      * for udp measurements - This can be a structure outside stream, and
@@ -149,10 +219,56 @@ struct iperf_stream
     int       omitted_packet_count;
     double    jitter;
     double    prev_transit;
+    struct iperf_histogram *owd_hist;		/* transit times, whole test */
+    struct iperf_histogram *ipdv_hist;		/* |D(i-1,i)|, whole test */
+    struct iperf_histogram *owd_hist_interval;
+    struct iperf_histogram *ipdv_hist_interval;
+    struct iperf_seqwin *seqwin;		/* sequence numbers seen */
     int       outoforder_packets;
     int       cnt_error;
+    int64_t   socket_drops;		/* receiver: SO_RXQ_OVFL, -1 if unknown */
+    int64_t   omitted_socket_drops;
     uint64_t  target;
 
+    /* for --txtime scheduled departures (times in ns) */
+    uint64_t  txtime_next;		/* sender: departure time of next packet */
+    int       txtime_burst_pos;		/* sender: packets sent in current burst */
+    uint64_t  txtime_late;		/* sender: packets dropped as late */
+    uint64_t  txtime_prev_departure;	/* receiver: last in-order packet */
+    uint64_t  txtime_prev_arrival;
+    uint64_t  txtime_prev_pcount;
+    double    txtime_error_sum;		/* receiver: |actual - intended| spacing */
+    double    txtime_error_max;
+    uint64_t  txtime_error_count;
+
+    /* for --profile / --size-mix (see iperf_profile.c) */
+    int       send_size;		/* length of the next write */
+    double    profile_epoch;		/* time of the first arrival */
+    double    profile_vtime;		/* schedule position, in on time */
+    double    profile_next;		/* time of the next arrival */
+    int       profile_burst_left;	/* writes left in the current arrival */
+    unsigned short profile_seed[3];	/* erand48() state */
+    size_t    profile_cursor;		/* --trace: offset of the next record */
+    double    profile_trace_ts;		/* --trace: last pcap timestamp */
+
+    /* for --rr request/response transactions (see iperf_rr.c) */
+    uint64_t  *rr_sent;			/* client: send times of the requests in flight, ns */
+    int       rr_head;			/* client: oldest request in flight */
+    int       rr_inflight;
+    iperf_size_t rr_write_left;		/* request (client) or responses (server) left to write */
+    int       rr_read_acc;		/* bytes of a partial response (client) or request (server) */
+    iperf_size_t rr_transactions;	/* completed (client) or answered (server) */
+    iperf_size_t rr_transactions_this_interval;
+    struct iperf_histogram *rr_hist;	/* client: round-trip times, whole test */
+    struct iperf_histogram *rr_hist_interval;
+    struct iperf_crr *crr;		/* --crr client: connections in progress */
+    iperf_size_t crr_failures;		/* --crr client: connects or transactions that failed */
+    iperf_size_t crr_failures_this_interval;
+    struct iperf_histogram *crr_connect_hist;	/* --crr client: connect times, whole test */
+    struct iperf_histogram *crr_connect_hist_interval;
+    struct iperf_tcpsample_ring *tcpsample;	/* --tcpinfo-sample samples */
+    struct iperf_sample_ring *sample;		/* --sample-interval samples */
+
     struct sockaddr_storage local_addr;
     struct sockaddr_storage remote_addr;
 
@@ -225,6 +341,25 @@ struct iperf_test
     int       debug;				/* -d option - enable debug */
     int	      get_server_output;		/* --get-server-output */
     int	      udp_counters_64bit;		/* --use-64-bit-udp-counters */
+    int	      txtime;				/* --txtime departure scheduling mode */
+    struct iperf_profile *profile;		/* --profile / --size-mix, or NULL */
+    struct iperf_rate_schedule *rate_schedule;	/* --rate-schedule, or NULL */
+    struct iperf_search *search;		/* --search (client only), or NULL */
+    int       trial;			/* --search: trials started after the first */
+    struct iperf_rr *rr;			/* --rr or --crr, or NULL */
+    struct iperf_crr *crr;			/* --crr server: connections in progress */
+    struct iperf_tcpsample_config *tcpsample;	/* --tcpinfo-sample (client only), or NULL */
+    int       perf_counters;			/* --perf-counters */
+    struct iperf_perf *perf;			/* its counters while a test runs */
+    struct iperf_perf_counts perf_total;	/* counts over the test */
+    int       json_stream;			/* --json-stream */
+    int       json_stream_started;		/* its start record is out */
+    char     *binlog_name;			/* --binlog file */
+    struct iperf_binlog *binlog;		/* it, open while a test runs */
+    int       metrics_port;			/* --metrics (server only), or 0 */
+    struct iperf_metrics *metrics;		/* its endpoint and counters */
+    struct iperf_live *live;			/* --live-stats, or NULL */
+    struct iperf_sample_config *sample;	/* --sample-interval, or NULL */
 
     int	      multisend;
 
@@ -248,6 +383,10 @@ struct iperf_test
 
     double cpu_util[3];                            /* cpu utilization of the test - total, user, system */
     double remote_cpu_util[3];                     /* cpu utilization for the remote host/client - total, user, system */
+    double thread_cpu[2];                          /* CPU seconds of the I/O thread over the test - user, system */
+    double thread_cpu_mark[2];                     /* its CPU time at the last stats interval */
+    double remote_thread_cpu[2];                   /* the remote's, from the results exchange */
+    double remote_cpu_per_gb;                      /* remote CPU seconds per 10^9 bytes, -1 if unknown */
 
     int       num_streams;                      /* total streams in the test (-P) */
 
@@ -306,4 +445,13 @@ struct iperf_test
 #define MAX_MSS (9 * 1024)
 #define MAX_STREAMS 128
 
+/* --txtime departure scheduling modes */
+#define TXTIME_NONE 0
+#define TXTIME_FQ 1		/* SO_TXTIME, CLOCK_MONOTONIC, fq qdisc */
+#define TXTIME_ETF 2		/* SO_TXTIME, CLOCK_TAI, etf qdisc */
+#define TXTIME_SW 3		/* userspace schedule, late packets dropped */
+#define TXTIME_HORIZON_NS (10 * 1000000LL) /* how far ahead the kernel modes queue */
+#define TXTIME_SW_MIN_PERIOD 100	/* usec, shortest sw send timer period */
+#define UDP_TXTIME_MIN_BLKSIZE 24	/* sec, usec, 64-bit count, departure time */
+
 #endif /* !__IPERF_H */
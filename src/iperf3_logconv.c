@@ -0,0 +1,187 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf3_logconv.c
+ *
+ * Turn an iperf3 --binlog file into JSON (one object per line) or CSV.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf_binlog.h"
+
+/* Every field name of every type, for the CSV header. */
+#define MAX_COLUMNS 32
+
+static const struct iperf_binlog_field *columns[MAX_COLUMNS];
+static int ncolumns;
+
+static void
+usage(void)
+{
+    fprintf(stderr, "Usage: iperf3_logconv [-f json|csv] [-t type] [file]\n"
+	    "  -f json    one JSON object per record (default)\n"
+	    "  -f csv     one CSV row per record, with a header row\n"
+	    "  -t type    only records of this type: test, stream_interval, interval,\n"
+	    "             stream_summary or summary\n"
+	    "Reads standard input when no file is given.\n");
+    exit(1);
+}
+
+static void
+add_columns(int type)
+{
+    const struct iperf_binlog_field *f;
+    int i;
+
+    for (f = iperf_binlog_fields(type); f->name != NULL; ++f) {
+	for (i = 0; i < ncolumns; ++i)
+	    if (strcmp(columns[i]->name, f->name) == 0)
+		break;
+	if (i == ncolumns && ncolumns < MAX_COLUMNS)
+	    columns[ncolumns++] = f;
+    }
+}
+
+static uint64_t
+field_value(const struct iperf_binlog_record *r, const struct iperf_binlog_field *f)
+{
+    uint64_t v;
+
+    memcpy(&v, (const char *) r + f->offset, sizeof(v));
+    return v;
+}
+
+static int
+has_field(int type, const char *name)
+{
+    const struct iperf_binlog_field *f;
+
+    for (f = iperf_binlog_fields(type); f->name != NULL; ++f)
+	if (strcmp(f->name, name) == 0)
+	    return 1;
+    return 0;
+}
+
+static void
+print_json(const struct iperf_binlog_record *r)
+{
+    const struct iperf_binlog_field *f;
+
+    printf("{\"type\":\"%s\"", iperf_binlog_type_name(r->type));
+    for (f = iperf_binlog_fields(r->type); f->name != NULL; ++f)
+	printf(",\"%s\":%llu", f->name, (unsigned long long) field_value(r, f));
+    printf("}\n");
+}
+
+static void
+print_csv(const struct iperf_binlog_record *r)
+{
+    int i;
+
+    printf("%s", iperf_binlog_type_name(r->type));
+    for (i = 0; i < ncolumns; ++i) {
+	if (has_field(r->type, columns[i]->name))
+	    printf(",%llu", (unsigned long long) field_value(r, columns[i]));
+	else
+	    printf(",");
+    }
+    printf("\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    struct iperf_binlog_record r;
+    FILE *f = stdin;
+    int csv = 0, only = 0;
+    int ch, i, n;
+
+    while ((ch = getopt(argc, argv, "f:t:h")) != -1) {
+	switch (ch) {
+	    case 'f':
+		if (strcmp(optarg, "csv") == 0)
+		    csv = 1;
+		else if (strcmp(optarg, "json") == 0)
+		    csv = 0;
+		else
+		    usage();
+		break;
+	    case 't':
+		for (only = 1; only < BINLOG_TYPES; ++only)
+		    if (strcmp(optarg, iperf_binlog_type_name(only)) == 0)
+			break;
+		if (only == BINLOG_TYPES)
+		    usage();
+		break;
+	    default:
+		usage();
+	}
+    }
+    if (optind < argc - 1)
+	usage();
+    if (optind == argc - 1 && (f = fopen(argv[optind], "r")) == NULL) {
+	perror(argv[optind]);
+	return 1;
+    }
+    if (iperf_binlog_read_header(f) < 0) {
+	fprintf(stderr, "iperf3_logconv: not an iperf3 --binlog file\n");
+	return 1;
+    }
+
+    if (csv) {
+	if (only)
+	    add_columns(only);
+	else
+	    for (i = 1; i < BINLOG_TYPES; ++i)
+		add_columns(i);
+	printf("type");
+	for (i = 0; i < ncolumns; ++i)
+	    printf(",%s", columns[i]->name);
+	printf("\n");
+    }
+
+    while ((n = iperf_binlog_read(f, &r)) > 0) {
+	if (iperf_binlog_fields(r.type) == NULL || (only && r.type != only))
+	    continue;
+	if (csv)
+	    print_csv(&r);
+	else
+	    print_json(&r);
+    }
+    if (n < 0) {
+	fprintf(stderr, "iperf3_logconv: truncated or damaged record\n");
+	return 1;
+    }
+    return 0;
+}
@@ -76,6 +76,15 @@
 #include "tcp_window_size.h"
 #include "iperf_util.h"
 #include "iperf_locale.h"
+#include "iperf_profile.h"
+#include "iperf_search.h"
+#include "iperf_rr.h"
+#include "iperf_tcpsample.h"
+#include "iperf_binlog.h"
+#include "iperf_metrics.h"
+#include "iperf_live.h"
+#include "iperf_sample.h"
+#include "iperf_fairness.h"
 #include "version.h"
 
 /* Forwards. */
@@ -87,6 +96,8 @@ static int diskfile_send(struct iperf_stream *sp);
 static int diskfile_recv(struct iperf_stream *sp);
 static int JSON_write(int fd, cJSON *json);
 static void print_interval_results(struct iperf_test *test, struct iperf_stream *sp, cJSON *json_interval_streams);
+static int iperf_json_stream_start(struct iperf_test *test);
+static int iperf_json_stream_event(struct iperf_test *test, const char *event, cJSON *data);
 static cJSON *JSON_read(int fd);
 
 
@@ -458,16 +469,59 @@ set_protocol(struct iperf_test *test, int prot_id)
 void
 iperf_on_new_stream(struct iperf_stream *sp)
 {
+    /* Each --search trial connects its streams anew; report them once. */
+    if (sp->test->trial > 0)
+	return;
     connect_msg(sp);
 }
 
 void
 iperf_on_test_start(struct iperf_test *test)
 {
+    /*
+     * --search trials share one start section; with --json-stream each
+     * gets a start record of its own.
+     */
+    if (test->json_output && !test->json_stream && test->trial > 0)
+	return;
     if (test->json_output) {
 	cJSON_AddItemToObject(test->json_start, "test_start", iperf_json_printf("protocol: %s  num_streams: %d  blksize: %d  omit: %d  duration: %d  bytes: %d  blocks: %d  reverse: %d", test->protocol->name, (int64_t) test->num_streams, (int64_t) test->settings->blksize, (int64_t) test->omit, (int64_t) test->duration, (int64_t) test->settings->bytes, (int64_t) test->settings->blocks, test->reverse?(int64_t)1:(int64_t)0));
+	if (test->json_stream && test->search != NULL)
+	    cJSON_AddItemToObject(test->json_start, "search_trial", iperf_json_printf("trial: %d  bits_per_second: %d", (int64_t) test->trial, (int64_t) test->settings->rate));
+	if (test->profile) {
+	    cJSON *jp = iperf_json_printf("spec: %s  burst: %d", test->profile->spec, (int64_t) test->profile->burst);
+	    if (jp != NULL && test->profile->nsizes > 0) {
+		cJSON_AddStringToObject(jp, "size_mix", test->profile->size_spec);
+		cJSON_AddFloatToObject(jp, "mean_size", test->profile->mean_size);
+	    }
+	    cJSON_AddItemToObject(test->json_start, "profile", jp);
+	}
+	if (test->rate_schedule)
+	    cJSON_AddStringToObject(test->json_start, "rate_schedule", test->rate_schedule->spec);
+	if (test->rr && test->rr->connect)
+	    cJSON_AddItemToObject(test->json_start, "crr", iperf_json_printf("request: %d  response: %d  connections: %d", (int64_t) test->rr->request, (int64_t) test->rr->response, (int64_t) test->rr->depth));
+	else if (test->rr)
+	    cJSON_AddItemToObject(test->json_start, "rr", iperf_json_printf("request: %d  response: %d  depth: %d", (int64_t) test->rr->request, (int64_t) test->rr->response, (int64_t) test->rr->depth));
+	if (test->tcpsample)
+	    cJSON_AddStringToObject(test->json_start, "tcpinfo_sample", test->tcpsample->spec);
+	if (test->sample)
+	    cJSON_AddFloatToObject(test->json_start, "sample_interval_ms", test->sample->period / 1000.0);
+	if (test->json_stream)
+	    iperf_json_stream_start(test);
     } else {
 	if (test->verbose) {
+	    if (test->profile)
+		iprintf(test, test_start_profile, iperf_profile_describe(test->profile));
+	    if (test->rate_schedule)
+		iprintf(test, test_start_rate_schedule, test->rate_schedule->spec);
+	    if (test->rr && test->rr->connect)
+		iprintf(test, test_start_crr, test->rr->request, test->rr->response, test->rr->depth);
+	    else if (test->rr)
+		iprintf(test, test_start_rr, test->rr->request, test->rr->response, test->rr->depth);
+	    if (test->tcpsample)
+		iprintf(test, test_start_tcpsample, test->tcpsample->period / 1000.0, test->tcpsample->file_name);
+	    if (test->sample)
+		iprintf(test, test_start_sample, test->sample->period / 1000.0);
 	    if (test->settings->bytes)
 		iprintf(test, test_start_bytes, test->protocol->name, test->num_streams, test->settings->blksize, test->omit, test->settings->bytes);
 	    else if (test->settings->blocks)
@@ -577,6 +631,33 @@ iperf_on_test_finish(struct iperf_test *test)
 
 /******************************************************************************/
 
+/* Map --txtime mode names to TXTIME_* values and back. */
+static int
+txtime_mode(const char *name)
+{
+    if (strcmp(name, "fq") == 0)
+	return TXTIME_FQ;
+    if (strcmp(name, "etf") == 0)
+	return TXTIME_ETF;
+    if (strcmp(name, "sw") == 0)
+	return TXTIME_SW;
+    return TXTIME_NONE;
+}
+
+static const char *
+txtime_name(int mode)
+{
+    switch (mode) {
+	case TXTIME_FQ:
+	return "fq";
+	case TXTIME_ETF:
+	return "etf";
+	case TXTIME_SW:
+	return "sw";
+    }
+    return "none";
+}
+
 int
 iperf_parse_arguments(struct iperf_test *test, int argc, char **argv)
 {
@@ -628,6 +709,21 @@ iperf_parse_arguments(struct iperf_test *test, int argc, char **argv)
 	{"logfile", required_argument, NULL, OPT_LOGFILE},
 	{"get-server-output", no_argument, NULL, OPT_GET_SERVER_OUTPUT},
 	{"udp-counters-64bit", no_argument, NULL, OPT_UDP_COUNTERS_64BIT},
+	{"txtime", required_argument, NULL, OPT_TXTIME},
+	{"profile", required_argument, NULL, OPT_PROFILE},
+	{"size-mix", required_argument, NULL, OPT_SIZE_MIX},
+	{"trace", required_argument, NULL, OPT_TRACE},
+	{"rate-schedule", required_argument, NULL, OPT_RATE_SCHEDULE},
+	{"search", required_argument, NULL, OPT_SEARCH},
+	{"rr", required_argument, NULL, OPT_RR},
+	{"crr", required_argument, NULL, OPT_CRR},
+	{"tcpinfo-sample", required_argument, NULL, OPT_TCPINFO_SAMPLE},
+	{"perf-counters", no_argument, NULL, OPT_PERF_COUNTERS},
+	{"json-stream", no_argument, NULL, OPT_JSON_STREAM},
+	{"binlog", required_argument, NULL, OPT_BINLOG},
+	{"metrics", required_argument, NULL, OPT_METRICS},
+	{"live-stats", required_argument, NULL, OPT_LIVE_STATS},
+	{"sample-interval", required_argument, NULL, OPT_SAMPLE_INTERVAL},
         {"debug", no_argument, NULL, 'd'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}
@@ -639,6 +735,8 @@ iperf_parse_arguments(struct iperf_test *test, int argc, char **argv)
     char* comma;
 #endif /* HAVE_CPU_AFFINITY */
     char* slash;
+    char* endptr;
+    double ms;
 
     blksize = 0;
     server_flag = client_flag = rate_flag = duration_flag = 0;
@@ -871,6 +969,132 @@ iperf_parse_arguments(struct iperf_test *test, int argc, char **argv)
 	    case OPT_UDP_COUNTERS_64BIT:
 		test->udp_counters_64bit = 1;
 		break;
+	    case OPT_TXTIME:
+		test->txtime = txtime_mode(optarg);
+		if (test->txtime == TXTIME_NONE) {
+		    i_errno = IETXTIME;
+		    return -1;
+		}
+#if !defined(HAVE_SO_TXTIME)
+		if (test->txtime != TXTIME_SW) {
+		    i_errno = IEUNIMP;
+		    return -1;
+		}
+#endif /* HAVE_SO_TXTIME */
+		client_flag = 1;
+		break;
+	    case OPT_PROFILE:
+	    case OPT_SIZE_MIX:
+	    case OPT_TRACE:
+		if (test->profile == NULL &&
+		    (test->profile = iperf_profile_new()) == NULL) {
+		    i_errno = IENEWTEST;
+		    return -1;
+		}
+		if (flag == OPT_PROFILE) {
+		    /* A trace is its own profile. */
+		    if (test->profile->trace_map != NULL) {
+			i_errno = IEPROFILE;
+			return -1;
+		    }
+		    if (iperf_profile_parse(test->profile, optarg) < 0)
+			return -1;
+		} else if (flag == OPT_SIZE_MIX) {
+		    if (iperf_profile_parse_sizes(test->profile, optarg) < 0)
+			return -1;
+		} else {
+		    if (test->profile->type != PROFILE_CBR) {
+			i_errno = IEPROFILE;
+			return -1;
+		    }
+		    if (iperf_profile_load_trace(test->profile, optarg) < 0)
+			return -1;
+		}
+		client_flag = 1;
+		break;
+	    case OPT_RATE_SCHEDULE:
+		if (test->rate_schedule != NULL)
+		    free(test->rate_schedule);
+		if ((test->rate_schedule = iperf_rate_schedule_parse(optarg)) == NULL)
+		    return -1;
+		client_flag = 1;
+		break;
+	    case OPT_SEARCH:
+		if (test->search != NULL)
+		    free(test->search);
+		if ((test->search = iperf_search_parse(optarg)) == NULL)
+		    return -1;
+		client_flag = 1;
+		break;
+	    case OPT_RR:
+		if (test->rr != NULL)
+		    free(test->rr);
+		if ((test->rr = iperf_rr_parse(optarg)) == NULL)
+		    return -1;
+		client_flag = 1;
+		break;
+	    case OPT_CRR:
+		if (test->rr != NULL)
+		    free(test->rr);
+		if ((test->rr = iperf_rr_parse(optarg)) == NULL) {
+		    i_errno = IECRR;
+		    return -1;
+		}
+		test->rr->connect = 1;
+		client_flag = 1;
+		break;
+	    case OPT_TCPINFO_SAMPLE:
+#if defined(linux)
+		iperf_tcpsample_free(test->tcpsample);
+		if ((test->tcpsample = iperf_tcpsample_parse(optarg)) == NULL)
+		    return -1;
+		client_flag = 1;
+#else
+		i_errno = IEUNIMP;
+		return -1;
+#endif /* linux */
+		break;
+	    case OPT_JSON_STREAM:
+		test->json_output = 1;
+		test->json_stream = 1;
+		break;
+	    case OPT_BINLOG:
+		free(test->binlog_name);
+		test->binlog_name = strdup(optarg);
+		break;
+	    case OPT_LIVE_STATS:
+		iperf_live_free(test);
+		if ((test->live = iperf_live_parse(optarg)) == NULL)
+		    return -1;
+		break;
+	    case OPT_SAMPLE_INTERVAL:
+		ms = strtod(optarg, &endptr);
+		if (endptr == optarg || *endptr != '\0' ||
+		    ms * 1000 < SAMPLE_MIN_PERIOD || ms * 1000 > SAMPLE_MAX_PERIOD) {
+		    i_errno = IESAMPLE;
+		    return -1;
+		}
+		iperf_sample_free(test->sample);
+		if ((test->sample = iperf_sample_new(ms * 1000)) == NULL)
+		    return -1;
+		break;
+	    case OPT_METRICS:
+		test->metrics_port = atoi(optarg);
+		if (test->metrics_port <= 0 || test->metrics_port > 65535) {
+		    errno = EINVAL;
+		    i_errno = IEMETRICS;
+		    return -1;
+		}
+		server_flag = 1;
+		break;
+	    case OPT_PERF_COUNTERS:
+#if defined(HAVE_PERF_EVENT)
+		test->perf_counters = 1;
+#else
+		i_errno = IEUNIMP;
+		return -1;
+#endif /* HAVE_PERF_EVENT */
+		break;
             case 'h':
             default:
                 usage_long();
@@ -901,6 +1125,37 @@ iperf_parse_arguments(struct iperf_test *test, int argc, char **argv)
         i_errno = IEBIND;
         return -1;
     }
+    if (test->profile != NULL && test->profile->type == PROFILE_TRACE) {
+	/* The trace brings its own sizes; larger records get trimmed. */
+	if (test->profile->trace_map == NULL || test->reverse) {
+	    i_errno = IETRACE;
+	    errno = EINVAL;
+	    return -1;
+	}
+	if (test->profile->nsizes > 0) {
+	    i_errno = IESIZEMIX;
+	    return -1;
+	}
+	if (blksize == 0) {
+	    blksize = test->profile->trace_max_size;
+	    if (test->protocol->id == Pudp && blksize > MAX_UDP_BLOCKSIZE)
+		blksize = MAX_UDP_BLOCKSIZE;
+	    else if (blksize > MAX_BLOCKSIZE)
+		blksize = MAX_BLOCKSIZE;
+	}
+    }
+    if (test->profile != NULL && test->profile->nsizes > 0) {
+	/* All sizes in the mix are sent out of one blksize buffer. */
+	if (blksize == 0)
+	    blksize = test->profile->max_size;
+	if (test->profile->max_size > blksize ||
+	    (test->protocol->id == Pudp &&
+	     test->profile->min_size < (test->udp_counters_64bit ? 16 : 12)) ||
+	    test->txtime != TXTIME_NONE || test->diskfile_name != NULL) {
+	    i_errno = IESIZEMIX;
+	    return -1;
+	}
+    }
     if (blksize == 0) {
 	if (test->protocol->id == Pudp)
 	    blksize = DEFAULT_UDP_BLKSIZE;
@@ -923,9 +1178,73 @@ iperf_parse_arguments(struct iperf_test *test, int argc, char **argv)
     if (!rate_flag)
 	test->settings->rate = test->protocol->id == Pudp ? UDP_RATE : 0;
 
+    /* The departure schedule is derived from the rate and needs room in the packet. */
+    if (test->txtime != TXTIME_NONE &&
+	(test->protocol->id != Pudp || test->settings->rate == 0 ||
+	 blksize < UDP_TXTIME_MIN_BLKSIZE)) {
+	i_errno = IETXTIME;
+	return -1;
+    }
+
+    /* A profile shapes the -b rate (a trace ignores it); it brings its own bursts. */
+    if (iperf_profile_scheduled(test) &&
+	((test->settings->rate == 0 && test->profile->type != PROFILE_TRACE) ||
+	 test->settings->burst != 0 ||
+	 test->txtime != TXTIME_NONE || test->diskfile_name != NULL)) {
+	i_errno = IEPROFILE;
+	return -1;
+    }
+
     if ((test->settings->bytes != 0 || test->settings->blocks != 0) && ! duration_flag)
         test->duration = 0;
 
+    /* A schedule sets the rate itself; -b may only add a burst. */
+    if (test->rate_schedule != NULL) {
+	if (iperf_profile_scheduled(test) || test->txtime != TXTIME_NONE ||
+	    iperf_rate_schedule_resolve(test->rate_schedule, test->duration) < 0) {
+	    i_errno = IERATESCHEDULE;
+	    return -1;
+	}
+	test->settings->rate = iperf_rate_schedule_peak(test->rate_schedule);
+    }
+
+    /* A search sets the rate of each trial, starting at the upper bound. */
+    if (test->search != NULL) {
+	if (test->protocol->id != Pudp || test->rate_schedule != NULL ||
+	    (test->profile != NULL && test->profile->type == PROFILE_TRACE)) {
+	    i_errno = IESEARCH;
+	    return -1;
+	}
+	test->settings->rate = test->search->max_rate;
+    }
+
+    /* Transactions are closed-loop, one connection per stream in each direction. */
+    if (test->rr != NULL) {
+	if (test->protocol->id != Ptcp || test->reverse || rate_flag ||
+	    test->diskfile_name != NULL || test->zerocopy ||
+	    test->profile != NULL || test->rate_schedule != NULL || test->search != NULL ||
+	    test->rr->request > blksize || test->rr->response > blksize) {
+	    i_errno = test->rr->connect ? IECRR : IERR;
+	    return -1;
+	}
+	/* --crr keeps a select()able descriptor per connection. */
+	if (test->rr->connect &&
+	    (test->settings->bytes != 0 || test->settings->blocks != 0 ||
+	     test->num_streams * test->rr->depth > CRR_MAX_CONNS)) {
+	    i_errno = IECRR;
+	    return -1;
+	}
+    }
+
+    /* Samples go to the JSON output unless there is a file for them. */
+    if (test->tcpsample != NULL &&
+	(test->protocol->id != Ptcp || (test->rr != NULL && test->rr->connect) ||
+	 (test->tcpsample->file_name == NULL && !test->json_output))) {
+	errno = EINVAL;
+	i_errno = IETCPSAMPLE;
+	return -1;
+    }
+
     /* Disallow specifying multiple test end conditions. The code actually
     ** works just fine without this prohibition. As soon as any one of the
     ** three possible end conditions is met, the test ends. So this check
@@ -968,12 +1287,23 @@ iperf_check_throttle(struct iperf_stream *sp, struct timeval *nowP)
 {
     double seconds;
     uint64_t bits_per_second;
+    int green_light;
 
     if (sp->test->done)
         return;
-    seconds = timeval_diff(&sp->result->start_time, nowP);
-    bits_per_second = sp->result->bytes_sent * 8 / seconds;
-    if (bits_per_second < sp->test->settings->rate) {
+    if (sp->test->txtime)
+	green_light = iperf_udp_txtime_ready(sp);
+    else if (iperf_profile_scheduled(sp->test))
+	green_light = iperf_profile_check(sp, nowP);
+    else if (sp->test->rate_schedule != NULL) {
+	seconds = timeval_diff(&sp->result->start_time, nowP);
+	green_light = sp->result->bytes_sent * 8.0 < iperf_rate_schedule_bits(sp->test->rate_schedule, seconds);
+    } else {
+	seconds = timeval_diff(&sp->result->start_time, nowP);
+	bits_per_second = sp->result->bytes_sent * 8 / seconds;
+	green_light = bits_per_second < sp->test->settings->rate;
+    }
+    if (green_light) {
         sp->green_light = 1;
         FD_SET(sp->socket, &sp->test->write_set);
     } else {
@@ -988,17 +1318,22 @@ iperf_send(struct iperf_test *test, fd_set *write_setP)
     register int multisend, r;
     register struct iperf_stream *sp;
     struct timeval now;
+    int throttle_each;
 
     /* Can we do multisend mode? */
-    if (test->settings->burst != 0)
+    if (test->txtime)
+        multisend = 1;	/* bursts are laid out by the departure schedule */
+    else if (test->settings->burst != 0)
         multisend = test->settings->burst;
-    else if (test->settings->rate == 0)
+    else if (test->settings->rate == 0 && !iperf_profile_scheduled(test))
         multisend = test->multisend;
     else
         multisend = 1;	/* nope */
+    throttle_each = (test->settings->rate != 0 && (test->settings->burst == 0 || test->txtime)) ||
+	iperf_profile_scheduled(test);
 
     for (; multisend > 0; --multisend) {
-	if (test->settings->rate != 0 && test->settings->burst == 0)
+	if (throttle_each)
 	    gettimeofday(&now, NULL);
 	SLIST_FOREACH(sp, &test->streams, streams) {
 	    if (sp->green_light &&
@@ -1010,8 +1345,10 @@ iperf_send(struct iperf_test *test, fd_set *write_setP)
 		    return r;
 		}
 		test->bytes_sent += r;
-		++test->blocks_sent;
-		if (test->settings->rate != 0 && test->settings->burst == 0)
+		/* A --txtime sw datagram that missed its slot sent nothing. */
+		if (r > 0)
+		    ++test->blocks_sent;
+		if (throttle_each)
 		    iperf_check_throttle(sp, &now);
 		if (multisend > 1 && test->settings->bytes != 0 && test->bytes_sent >= test->settings->bytes)
 		    break;
@@ -1020,7 +1357,7 @@ iperf_send(struct iperf_test *test, fd_set *write_setP)
 	    }
 	}
     }
-    if (test->settings->burst != 0) {
+    if (!throttle_each && test->settings->burst != 0) {
 	gettimeofday(&now, NULL);
 	SLIST_FOREACH(sp, &test->streams, streams)
 	    iperf_check_throttle(sp, &now);
@@ -1073,6 +1410,22 @@ iperf_init_test(struct iperf_test *test)
     SLIST_FOREACH(sp, &test->streams, streams) {
 	sp->result->start_time = now;
     }
+    thread_cpu(test->thread_cpu_mark);
+    test->thread_cpu[0] = test->thread_cpu[1] = 0;
+    if (test->perf_counters) {
+	iperf_perf_close(test->perf);
+	if ((test->perf = iperf_perf_open()) == NULL) {
+	    i_errno = IEPERFEVENT;
+	    return -1;
+	}
+	memset(&test->perf_total, 0, sizeof(test->perf_total));
+    }
+    if (test->binlog_name != NULL && iperf_binlog_open(test, &now) < 0)
+	return -1;
+    if (test->live != NULL && iperf_live_start(test) < 0)
+	return -1;
+    if (test->sample != NULL && iperf_sample_start(test) < 0)
+	return -1;
 
     if (test->on_test_start)
         test->on_test_start(test);
@@ -1105,10 +1458,13 @@ iperf_create_send_timers(struct iperf_test * test)
     }
     SLIST_FOREACH(sp, &test->streams, streams) {
         sp->green_light = 1;
-	if (test->settings->rate != 0) {
+	if (iperf_profile_scheduled(test))
+	    iperf_check_throttle(sp, &now);	/* schedules its own wakeups */
+	else if (test->settings->rate != 0) {
 	    cd.p = sp;
-	    sp->send_timer = tmr_create((struct timeval*) 0, send_timer_proc, cd, 100000L, 1);
-	    /* (Repeat every tenth second - arbitrary often value.) */
+	    sp->send_timer = tmr_create((struct timeval*) 0, send_timer_proc, cd, test->txtime ? iperf_udp_txtime_period(test) : 100000L, 1);
+	    /* (Repeat every tenth second - arbitrary often value - or as
+	    ** often as the --txtime schedule needs.) */
 	    if (sp->send_timer == NULL) {
 		i_errno = IEINITTEST;
 		return -1;
@@ -1245,6 +1601,17 @@ send_parameters(struct iperf_test *test)
 	    cJSON_AddIntToObject(j, "get_server_output", iperf_get_test_get_server_output(test));
 	if (test->udp_counters_64bit)
 	    cJSON_AddIntToObject(j, "udp_counters_64bit", iperf_get_test_udp_counters_64bit(test));
+	if (test->txtime)
+	    cJSON_AddStringToObject(j, "txtime", txtime_name(test->txtime));
+	if (test->profile) {
+	    cJSON_AddStringToObject(j, "profile", test->profile->spec);
+	    if (test->profile->nsizes > 0)
+		cJSON_AddStringToObject(j, "size_mix", test->profile->size_spec);
+	}
+	if (test->rate_schedule)
+	    cJSON_AddStringToObject(j, "rate_schedule", test->rate_schedule->spec);
+	if (test->rr)
+	    cJSON_AddStringToObject(j, test->rr->connect ? "crr" : "rr", test->rr->spec);
 
 	cJSON_AddStringToObject(j, "client_version", IPERF_VERSION);
 
@@ -1315,14 +1682,60 @@ get_parameters(struct iperf_test *test)
 	    test->settings->tos = j_p->valueint;
 	if ((j_p = cJSON_GetObjectItem(j, "flowlabel")) != NULL)
 	    test->settings->flowlabel = j_p->valueint;
-	if ((j_p = cJSON_GetObjectItem(j, "title")) != NULL)
+	/* Parameters are sent again for every --search trial. */
+	if ((j_p = cJSON_GetObjectItem(j, "title")) != NULL) {
+	    if (test->title)
+		free(test->title);
 	    test->title = strdup(j_p->valuestring);
-	if ((j_p = cJSON_GetObjectItem(j, "congestion")) != NULL)
+	}
+	if ((j_p = cJSON_GetObjectItem(j, "congestion")) != NULL) {
+	    if (test->congestion)
+		free(test->congestion);
 	    test->congestion = strdup(j_p->valuestring);
+	}
 	if ((j_p = cJSON_GetObjectItem(j, "get_server_output")) != NULL)
 	    iperf_set_test_get_server_output(test, 1);
 	if ((j_p = cJSON_GetObjectItem(j, "udp_counters_64bit")) != NULL)
 	    iperf_set_test_udp_counters_64bit(test, 1);
+	if ((j_p = cJSON_GetObjectItem(j, "txtime")) != NULL)
+	    test->txtime = txtime_mode(j_p->valuestring);
+	if ((j_p = cJSON_GetObjectItem(j, "profile")) != NULL) {
+	    if (test->profile == NULL)
+		test->profile = iperf_profile_new();
+	    if (test->profile == NULL ||
+		iperf_profile_parse(test->profile, j_p->valuestring) < 0)
+		r = -1;
+	    else if (test->profile->type == PROFILE_TRACE && test->sender) {
+		/* The trace file lives on the client. */
+		i_errno = IETRACE;
+		r = -1;
+	    }
+	    else if ((j_p = cJSON_GetObjectItem(j, "size_mix")) != NULL &&
+		     iperf_profile_parse_sizes(test->profile, j_p->valuestring) < 0)
+		r = -1;
+	}
+	if ((j_p = cJSON_GetObjectItem(j, "rate_schedule")) != NULL) {
+	    if (test->rate_schedule != NULL)
+		free(test->rate_schedule);
+	    if ((test->rate_schedule = iperf_rate_schedule_parse(j_p->valuestring)) == NULL ||
+		iperf_rate_schedule_resolve(test->rate_schedule, test->duration) < 0)
+		r = -1;
+	}
+	if ((j_p = cJSON_GetObjectItem(j, "rr")) != NULL) {
+	    if (test->rr != NULL)
+		free(test->rr);
+	    if ((test->rr = iperf_rr_parse(j_p->valuestring)) == NULL)
+		r = -1;
+	}
+	if ((j_p = cJSON_GetObjectItem(j, "crr")) != NULL) {
+	    if (test->rr != NULL)
+		free(test->rr);
+	    if ((test->rr = iperf_rr_parse(j_p->valuestring)) == NULL) {
+		i_errno = IECRR;
+		r = -1;
+	    } else
+		test->rr->connect = 1;
+	}
 	if (test->sender && test->protocol->id == Ptcp && has_tcpinfo_retransmits())
 	    test->sender_has_retransmits = 1;
 	cJSON_Delete(j);
@@ -1332,6 +1745,129 @@ get_parameters(struct iperf_test *test)
 
 /*************************************************************/
 
+static void
+tcp_limits_unknown(struct iperf_tcp_limits *l)
+{
+    l->busy = l->rwnd = l->sndbuf = l->bytes_retrans = l->delivery_rate = -1;
+}
+
+/* The part of the connection's totals that falls in this interval. */
+static void
+tcp_limits_delta(struct iperf_tcp_limits *d, const struct iperf_tcp_limits *now, const struct iperf_tcp_limits *prev)
+{
+    d->busy = now->busy < 0 ? -1 : now->busy - prev->busy;
+    d->rwnd = now->rwnd < 0 ? -1 : now->rwnd - prev->rwnd;
+    d->sndbuf = now->sndbuf < 0 ? -1 : now->sndbuf - prev->sndbuf;
+    d->bytes_retrans = now->bytes_retrans < 0 ? -1 : now->bytes_retrans - prev->bytes_retrans;
+    d->delivery_rate = now->delivery_rate;
+}
+
+static void
+tcp_limits_add(struct iperf_tcp_limits *to, const struct iperf_tcp_limits *from)
+{
+    to->busy = (to->busy < 0 || from->busy < 0) ? -1 : to->busy + from->busy;
+    to->rwnd = (to->rwnd < 0 || from->rwnd < 0) ? -1 : to->rwnd + from->rwnd;
+    to->sndbuf = (to->sndbuf < 0 || from->sndbuf < 0) ? -1 : to->sndbuf + from->sndbuf;
+    to->bytes_retrans = (to->bytes_retrans < 0 || from->bytes_retrans < 0) ? -1 : to->bytes_retrans + from->bytes_retrans;
+    to->delivery_rate = from->delivery_rate;
+}
+
+static void
+tcp_limits_from_json(struct iperf_tcp_limits *l, cJSON *j)
+{
+    cJSON *j_p;
+
+    tcp_limits_unknown(l);
+    if (j == NULL)
+	return;
+    if ((j_p = cJSON_GetObjectItem(j, "busy")) != NULL)
+	l->busy = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "rwnd")) != NULL)
+	l->rwnd = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "sndbuf")) != NULL)
+	l->sndbuf = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "bytes_retrans")) != NULL)
+	l->bytes_retrans = j_p->valueint;
+}
+
+static void
+tcp_rcv_unknown(struct iperf_tcp_rcv *r)
+{
+    r->rcv_rtt = r->rcv_space = r->rcv_ssthresh = r->ooopack = r->inq = -1;
+}
+
+/*
+ * Turn a fresh sample of the receiving socket into this interval's
+ * view (ooopack becomes a delta) and fold it into the stream's.
+ */
+static void
+tcp_rcv_update(struct iperf_stream_result *rp, struct iperf_tcp_rcv *r)
+{
+    int64_t total;
+
+    if (r->ooopack >= 0) {
+	total = r->ooopack;
+	r->ooopack = total - rp->stream_prev_ooopack;
+	rp->stream_prev_ooopack = total;
+	rp->stream_rcv.ooopack = (rp->stream_rcv.ooopack < 0 ? 0 : rp->stream_rcv.ooopack) + r->ooopack;
+    }
+    rp->stream_rcv.rcv_rtt = r->rcv_rtt;
+    rp->stream_rcv.rcv_space = r->rcv_space;
+    rp->stream_rcv.rcv_ssthresh = r->rcv_ssthresh;
+    if (r->inq > rp->stream_rcv.inq)
+	rp->stream_rcv.inq = r->inq;
+}
+
+static void
+tcp_rcv_from_json(struct iperf_tcp_rcv *r, cJSON *j)
+{
+    cJSON *j_p;
+
+    tcp_rcv_unknown(r);
+    if (j == NULL)
+	return;
+    if ((j_p = cJSON_GetObjectItem(j, "rcv_rtt")) != NULL)
+	r->rcv_rtt = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "rcv_space")) != NULL)
+	r->rcv_space = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "rcv_ssthresh")) != NULL)
+	r->rcv_ssthresh = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "ooopack")) != NULL)
+	r->ooopack = j_p->valueint;
+    if ((j_p = cJSON_GetObjectItem(j, "inq")) != NULL)
+	r->inq = j_p->valueint;
+}
+
+/* CPU seconds per 10^9 bytes, or 0 if nothing was moved. */
+static double
+cpu_per_gb(double seconds, iperf_size_t bytes)
+{
+    return bytes > 0 ? seconds * 1e9 / bytes : 0;
+}
+
+/* The bytes this side moved, sent or received, over all streams. */
+static iperf_size_t
+local_bytes(struct iperf_test *test)
+{
+    struct iperf_stream *sp;
+    iperf_size_t bytes = 0;
+
+    SLIST_FOREACH(sp, &test->streams, streams)
+	bytes += test->sender ? sp->result->bytes_sent : sp->result->bytes_received;
+    return bytes;
+}
+
+/* Datagrams the receiving socket dropped since --omit ended, or -1. */
+static int64_t
+stream_socket_drops(struct iperf_stream *sp)
+{
+    if (sp->socket_drops < 0)
+	return -1;
+    return sp->socket_drops - sp->omitted_socket_drops;
+}
+
+/*************************************************************/
+
 static int
 send_results(struct iperf_test *test)
 {
@@ -1352,6 +1888,9 @@ send_results(struct iperf_test *test)
 	cJSON_AddFloatToObject(j, "cpu_util_total", test->cpu_util[0]);
 	cJSON_AddFloatToObject(j, "cpu_util_user", test->cpu_util[1]);
 	cJSON_AddFloatToObject(j, "cpu_util_system", test->cpu_util[2]);
+	cJSON_AddFloatToObject(j, "cpu_thread_user", test->thread_cpu[0]);
+	cJSON_AddFloatToObject(j, "cpu_thread_system", test->thread_cpu[1]);
+	cJSON_AddFloatToObject(j, "cpu_seconds_per_gb", cpu_per_gb(test->thread_cpu[0] + test->thread_cpu[1], local_bytes(test)));
 	if ( ! test->sender )
 	    sender_has_retransmits = -1;
 	else
@@ -1406,6 +1945,22 @@ send_results(struct iperf_test *test)
 		    cJSON_AddFloatToObject(j_stream, "jitter", sp->jitter);
 		    cJSON_AddIntToObject(j_stream, "errors", sp->cnt_error);
 		    cJSON_AddIntToObject(j_stream, "packets", sp->packet_count);
+		    if (!test->sender && sp->socket_drops >= 0)
+			cJSON_AddIntToObject(j_stream, "socket_drops", stream_socket_drops(sp));
+		    if (test->sender && test->protocol->id == Ptcp)
+			cJSON_AddItemToObject(j_stream, "limits", iperf_json_printf("busy: %d  rwnd: %d  sndbuf: %d  bytes_retrans: %d", sp->result->stream_limits.busy, sp->result->stream_limits.rwnd, sp->result->stream_limits.sndbuf, sp->result->stream_limits.bytes_retrans));
+		    if (!test->sender && test->protocol->id == Ptcp)
+			cJSON_AddItemToObject(j_stream, "receiver_tcp", iperf_json_printf("rcv_rtt: %d  rcv_space: %d  rcv_ssthresh: %d  ooopack: %d  inq: %d", sp->result->stream_rcv.rcv_rtt, sp->result->stream_rcv.rcv_space, sp->result->stream_rcv.rcv_ssthresh, sp->result->stream_rcv.ooopack, sp->result->stream_rcv.inq));
+		    if (test->txtime && !test->sender) {
+			cJSON_AddFloatToObject(j_stream, "txtime_error_sum", sp->txtime_error_sum);
+			cJSON_AddFloatToObject(j_stream, "txtime_error_max", sp->txtime_error_max);
+			cJSON_AddIntToObject(j_stream, "txtime_error_count", sp->txtime_error_count);
+		    }
+		    if (sp->owd_hist != NULL && !test->sender) {
+			cJSON_AddItemToObject(j_stream, "owd_histogram", iperf_histogram_to_json(sp->owd_hist));
+			cJSON_AddItemToObject(j_stream, "ipdv_histogram", iperf_histogram_to_json(sp->ipdv_hist));
+			cJSON_AddItemToObject(j_stream, "sequence", iperf_seqwin_to_json(&sp->seqwin->total));
+		    }
 		}
 	    }
 	    if (r == 0 && test->debug) {
@@ -1443,6 +1998,7 @@ get_results(struct iperf_test *test)
     cJSON *j_errors;
     cJSON *j_packets;
     cJSON *j_server_output;
+    cJSON *j_p;
     int sid, cerror, pcount;
     double jitter;
     iperf_size_t bytes_transferred;
@@ -1469,6 +2025,15 @@ get_results(struct iperf_test *test)
 	    test->remote_cpu_util[0] = j_cpu_util_total->valuefloat;
 	    test->remote_cpu_util[1] = j_cpu_util_user->valuefloat;
 	    test->remote_cpu_util[2] = j_cpu_util_system->valuefloat;
+	    test->remote_cpu_per_gb = -1;
+	    test->remote_thread_cpu[0] = test->remote_thread_cpu[1] = 0;
+	    if ((j_p = cJSON_GetObjectItem(j, "cpu_seconds_per_gb")) != NULL) {
+		test->remote_cpu_per_gb = j_p->valuefloat;
+		if ((j_p = cJSON_GetObjectItem(j, "cpu_thread_user")) != NULL)
+		    test->remote_thread_cpu[0] = j_p->valuefloat;
+		if ((j_p = cJSON_GetObjectItem(j, "cpu_thread_system")) != NULL)
+		    test->remote_thread_cpu[1] = j_p->valuefloat;
+	    }
 	    result_has_retransmits = j_sender_has_retransmits->valueint;
 	    if (! test->sender)
 		test->sender_has_retransmits = result_has_retransmits;
@@ -1511,9 +2076,30 @@ get_results(struct iperf_test *test)
 				    sp->cnt_error = cerror;
 				    sp->packet_count = pcount;
 				    sp->result->bytes_received = bytes_transferred;
+				    if ((j_p = cJSON_GetObjectItem(j_stream, "socket_drops")) != NULL) {
+					sp->socket_drops = j_p->valueint;
+					sp->omitted_socket_drops = 0;
+				    }
+				    tcp_rcv_from_json(&sp->result->stream_rcv, cJSON_GetObjectItem(j_stream, "receiver_tcp"));
+				    if ((j_p = cJSON_GetObjectItem(j_stream, "txtime_error_count")) != NULL) {
+					sp->txtime_error_count = j_p->valueint;
+					if ((j_p = cJSON_GetObjectItem(j_stream, "txtime_error_sum")) != NULL)
+					    sp->txtime_error_sum = j_p->valuefloat;
+					if ((j_p = cJSON_GetObjectItem(j_stream, "txtime_error_max")) != NULL)
+					    sp->txtime_error_max = j_p->valuefloat;
+				    }
+				    if (sp->owd_hist != NULL) {
+					if ((j_p = cJSON_GetObjectItem(j_stream, "owd_histogram")) != NULL)
+					    iperf_histogram_from_json(sp->owd_hist, j_p);
+					if ((j_p = cJSON_GetObjectItem(j_stream, "ipdv_histogram")) != NULL)
+					    iperf_histogram_from_json(sp->ipdv_hist, j_p);
+					if ((j_p = cJSON_GetObjectItem(j_stream, "sequence")) != NULL)
+					    iperf_seqwin_from_json(&sp->seqwin->total, j_p);
+				    }
 				} else {
 				    sp->result->bytes_sent = bytes_transferred;
 				    sp->result->stream_retrans = retransmits;
+				    tcp_limits_from_json(&sp->result->stream_limits, cJSON_GetObjectItem(j_stream, "limits"));
 				}
 			    }
 			}
@@ -1595,17 +2181,27 @@ JSON_read(int fd)
 
 /*************************************************************/
 /**
- * add_to_interval_list -- adds new interval to the interval_list
+ * add_to_interval_list -- adds new interval to the interval_list,
+ * overwriting the oldest once the ring is full
  */
 
 void
 add_to_interval_list(struct iperf_stream_result * rp, struct iperf_interval_results * new)
 {
-    struct iperf_interval_results *irp;
+    memcpy(&rp->interval_ring[rp->interval_count % IPERF_INTERVAL_RING], new, sizeof(struct iperf_interval_results));
+    ++rp->interval_count;
+}
+
+/**
+ * iperf_last_interval_results -- the latest interval added, or NULL
+ */
 
-    irp = (struct iperf_interval_results *) malloc(sizeof(struct iperf_interval_results));
-    memcpy(irp, new, sizeof(struct iperf_interval_results));
-    TAILQ_INSERT_TAIL(&rp->interval_results, irp, irlistentries);
+struct iperf_interval_results *
+iperf_last_interval_results(struct iperf_stream_result * rp)
+{
+    if (rp->interval_count == 0)
+	return NULL;
+    return &rp->interval_ring[(rp->interval_count - 1) % IPERF_INTERVAL_RING];
 }
 
 
@@ -1639,9 +2235,12 @@ connect_msg(struct iperf_stream *sp)
         rport = ntohs(((struct sockaddr_in6 *) &sp->remote_addr)->sin6_port);
     }
 
-    if (sp->test->json_output)
+    if (sp->test->json_output) {
         cJSON_AddItemToArray(sp->test->json_connected, iperf_json_printf("socket: %d  local_host: %s  local_port: %d  remote_host: %s  remote_port: %d", (int64_t) sp->socket, ipl, (int64_t) lport, ipr, (int64_t) rport));
-    else
+	/* Before the start record they go out with it. */
+	if (sp->test->json_stream && sp->test->json_stream_started)
+	    iperf_json_stream_event(sp->test, "connected", cJSON_DetachItemFromArray(sp->test->json_connected, 0));
+    } else
 	iprintf(sp->test, report_connected, sp->socket, ipl, lport, ipr, rport);
 }
 
@@ -1725,6 +2324,7 @@ iperf_defaults(struct iperf_test *testp)
 
     testp->stats_interval = testp->reporter_interval = 1;
     testp->num_streams = 1;
+    testp->remote_cpu_per_gb = -1;
 
     testp->settings->domain = AF_UNSPEC;
     testp->settings->unit_format = 'a';
@@ -1813,6 +2413,8 @@ iperf_free_test(struct iperf_test *test)
     struct protocol *prot;
     struct iperf_stream *sp;
 
+    iperf_live_stop(test);
+
     /* Free streams */
     while (!SLIST_EMPTY(&test->streams)) {
         sp = SLIST_FIRST(&test->streams);
@@ -1829,6 +2431,23 @@ iperf_free_test(struct iperf_test *test)
 	free(test->title);
     if (test->congestion)
 	free(test->congestion);
+    if (test->profile)
+	iperf_profile_free(test->profile);
+    if (test->rate_schedule)
+	free(test->rate_schedule);
+    if (test->search)
+	free(test->search);
+    if (test->rr) {
+	iperf_crr_stop(test);
+	free(test->rr);
+    }
+    iperf_tcpsample_free(test->tcpsample);
+    iperf_perf_close(test->perf);
+    iperf_binlog_close(test);
+    free(test->binlog_name);
+    iperf_metrics_close(test);
+    iperf_live_free(test);
+    iperf_sample_free(test->sample);
     if (test->omit_timer != NULL)
 	tmr_cancel(test->omit_timer);
     if (test->timer != NULL)
@@ -1877,6 +2496,10 @@ iperf_reset_test(struct iperf_test *test)
 {
     struct iperf_stream *sp;
 
+    /* The last numbers of the test stay in the file. */
+    iperf_live_stop(test);
+    iperf_sample_stop(test);
+
     /* Free streams */
     while (!SLIST_EMPTY(&test->streams)) {
         sp = SLIST_FIRST(&test->streams);
@@ -1936,6 +2559,30 @@ iperf_reset_test(struct iperf_test *test)
     memset(test->cookie, 0, COOKIE_SIZE);
     test->multisend = 10;	/* arbitrary */
     test->udp_counters_64bit = 0;
+    test->txtime = TXTIME_NONE;
+    if (test->profile) {
+	iperf_profile_free(test->profile);
+	test->profile = NULL;
+    }
+    if (test->rate_schedule) {
+	free(test->rate_schedule);
+	test->rate_schedule = NULL;
+    }
+    if (test->search) {
+	free(test->search);
+	test->search = NULL;
+    }
+    test->trial = 0;
+    if (test->rr) {
+	iperf_crr_stop(test);
+	free(test->rr);
+	test->rr = NULL;
+    }
+    iperf_tcpsample_free(test->tcpsample);
+    test->tcpsample = NULL;
+    iperf_perf_close(test->perf);
+    test->perf = NULL;
+    iperf_binlog_close(test);
 
     /* Free output line buffers, if any (on the server only) */
     struct iperf_textline *t;
@@ -1948,6 +2595,68 @@ iperf_reset_test(struct iperf_test *test)
 }
 
 
+/*
+ * Get ready for the next --search trial on the same control connection:
+ * drop the streams, timers and counters of the last one.  The stream
+ * sockets have already been closed.
+ */
+void
+iperf_reset_trial(struct iperf_test *test)
+{
+    struct iperf_stream *sp;
+
+    iperf_metrics_fold(test);
+    while (!SLIST_EMPTY(&test->streams)) {
+        sp = SLIST_FIRST(&test->streams);
+        SLIST_REMOVE_HEAD(&test->streams, streams);
+        iperf_free_stream(sp);
+    }
+    if (test->omit_timer != NULL) {
+	tmr_cancel(test->omit_timer);
+	test->omit_timer = NULL;
+    }
+    if (test->timer != NULL) {
+	tmr_cancel(test->timer);
+	test->timer = NULL;
+    }
+    if (test->stats_timer != NULL) {
+	tmr_cancel(test->stats_timer);
+	test->stats_timer = NULL;
+    }
+    if (test->reporter_timer != NULL) {
+	tmr_cancel(test->reporter_timer);
+	test->reporter_timer = NULL;
+    }
+    test->done = 0;
+    test->bytes_sent = 0;
+    test->blocks_sent = 0;
+
+    FD_ZERO(&test->read_set);
+    FD_ZERO(&test->write_set);
+    FD_SET(test->ctrl_sck, &test->read_set);
+    test->max_fd = test->ctrl_sck;
+    if (test->role == 's') {
+	FD_SET(test->listener, &test->read_set);
+	if (test->listener > test->max_fd) test->max_fd = test->listener;
+	if (test->metrics != NULL)
+	    iperf_metrics_fdset(test);
+    }
+
+    /* The JSON output describes the last trial.  A stream starts anew. */
+    test->json_stream_started = 0;
+    if (test->json_output) {
+	cJSON_DeleteItemFromObject(test->json_top, "intervals");
+	test->json_intervals = cJSON_CreateArray();
+	if (test->json_intervals != NULL)
+	    cJSON_AddItemToObject(test->json_top, "intervals", test->json_intervals);
+	cJSON_DeleteItemFromObject(test->json_top, "end");
+	test->json_end = cJSON_CreateObject();
+	if (test->json_end != NULL)
+	    cJSON_AddItemToObject(test->json_top, "end", test->json_end);
+    }
+    ++test->trial;
+}
+
 /* Reset all of a test's stats back to zero.  Called when the omitting
 ** period is over.
 */
@@ -1958,14 +2667,38 @@ iperf_reset_stats(struct iperf_test *test)
     struct iperf_stream *sp;
     struct iperf_stream_result *rp;
 
+    /* The omitted bytes still count towards the server's totals. */
+    iperf_metrics_fold(test);
     test->bytes_sent = 0;
     test->blocks_sent = 0;
+    thread_cpu(test->thread_cpu_mark);
+    test->thread_cpu[0] = test->thread_cpu[1] = 0;
+    if (test->perf != NULL) {
+	iperf_perf_read(test->perf, &test->perf_total);
+	memset(&test->perf_total, 0, sizeof(test->perf_total));
+    }
     gettimeofday(&now, NULL);
     SLIST_FOREACH(sp, &test->streams, streams) {
 	sp->omitted_packet_count = sp->packet_count;
 	sp->jitter = 0;
 	sp->outoforder_packets = 0;
 	sp->cnt_error = 0;
+	if (sp->socket_drops >= 0)
+	    sp->omitted_socket_drops = sp->socket_drops;
+	sp->txtime_late = 0;
+	sp->txtime_error_sum = sp->txtime_error_max = 0;
+	sp->txtime_error_count = 0;
+	memset(&sp->io, 0, sizeof(sp->io));
+	memset(&sp->io_mark, 0, sizeof(sp->io_mark));
+	if (sp->owd_hist != NULL) {
+	    iperf_histogram_reset(sp->owd_hist);
+	    iperf_histogram_reset(sp->ipdv_hist);
+	    iperf_histogram_reset(sp->owd_hist_interval);
+	    iperf_histogram_reset(sp->ipdv_hist_interval);
+	    iperf_seqwin_reset(sp->seqwin);
+	}
+	if (test->rr != NULL)
+	    iperf_rr_reset(sp);
 	rp = sp->result;
         rp->bytes_sent = rp->bytes_received = 0;
         rp->bytes_sent_this_interval = rp->bytes_received_this_interval = 0;
@@ -1974,6 +2707,18 @@ iperf_reset_stats(struct iperf_test *test)
 	    save_tcpinfo(sp, &ir);
 	    rp->stream_prev_total_retrans = get_total_retransmits(&ir);
 	}
+	if (test->sender && test->protocol->id == Ptcp && has_tcpinfo()) {
+	    save_tcpinfo_limits(sp, &rp->stream_prev_limits);
+	    memset(&rp->stream_limits, 0, sizeof(rp->stream_limits));
+	} else
+	    tcp_limits_unknown(&rp->stream_limits);
+	tcp_rcv_unknown(&rp->stream_rcv);
+	if (!test->sender && test->protocol->id == Ptcp && has_tcpinfo()) {
+	    struct iperf_tcp_rcv r;
+
+	    save_tcpinfo_rcv(sp, &r);
+	    rp->stream_prev_ooopack = r.ooopack;
+	}
 	rp->stream_retrans = 0;
 	rp->start_time = now;
     }
@@ -1982,6 +2727,25 @@ iperf_reset_stats(struct iperf_test *test)
 
 /**************************************************************************/
 
+/*
+ * Label an interval with the scheduled rate: the mean target over the
+ * interval, and the step in effect at its midpoint (so that timer
+ * jitter at a step boundary does not shift the label).
+ */
+static void
+rate_schedule_interval(struct iperf_rate_schedule *rs, struct iperf_stream_result *rp, struct iperf_interval_results *irp)
+{
+    double st, et;
+
+    st = timeval_diff(&rp->start_time, &irp->interval_start_time);
+    et = timeval_diff(&rp->start_time, &irp->interval_end_time);
+    if (et > st)
+	irp->target_rate = (iperf_rate_schedule_bits(rs, et) - iperf_rate_schedule_bits(rs, st)) / (et - st);
+    else
+	irp->target_rate = 0;
+    irp->rate_step = iperf_rate_schedule_step(rs, (st + et) / 2);
+}
+
 /**
  * Gather statistics during a test.
  * This function works for both the client and server side.
@@ -1992,14 +2756,42 @@ iperf_stats_callback(struct iperf_test *test)
     struct iperf_stream *sp;
     struct iperf_stream_result *rp = NULL;
     struct iperf_interval_results *irp, temp;
+    double cpu[2];
 
     temp.omitted = test->omitting;
+    /* All streams share the one I/O thread. */
+    thread_cpu(cpu);
+    temp.cpu_user = cpu[0] - test->thread_cpu_mark[0];
+    temp.cpu_system = cpu[1] - test->thread_cpu_mark[1];
+    test->thread_cpu_mark[0] = cpu[0];
+    test->thread_cpu_mark[1] = cpu[1];
+    if (test->perf != NULL)
+	iperf_perf_read(test->perf, &temp.perf);
+    else
+	iperf_perf_unknown(&temp.perf);
+    if (!test->omitting) {
+	test->thread_cpu[0] += temp.cpu_user;
+	test->thread_cpu[1] += temp.cpu_system;
+	if (test->perf != NULL)
+	    iperf_perf_add(&test->perf_total, &temp.perf);
+    }
     SLIST_FOREACH(sp, &test->streams, streams) {
         rp = sp->result;
 
 	temp.bytes_transferred = test->sender ? rp->bytes_sent_this_interval : rp->bytes_received_this_interval;
+	temp.io.calls = sp->io.calls - sp->io_mark.calls;
+	temp.io.bytes = sp->io.bytes - sp->io_mark.bytes;
+	temp.io.eagain = sp->io.eagain - sp->io_mark.eagain;
+	temp.io.short_io = sp->io.short_io - sp->io_mark.short_io;
+	temp.io.soft_errors = sp->io.soft_errors - sp->io_mark.soft_errors;
+	sp->io_mark = sp->io;
+	/* Only reported with -J or -V; spare the syscalls otherwise. */
+	if (test->json_output || test->verbose)
+	    getsockmem(sp->socket, &temp.sockmem);
+	else
+	    temp.sockmem.rcvbuf = -1;
      
-	irp = TAILQ_LAST(&rp->interval_results, irlisthead);
+	irp = iperf_last_interval_results(rp);
         /* result->end_time contains timestamp of previous interval */
         if ( irp != NULL ) /* not the 1st interval */
             memcpy(&temp.interval_start_time, &rp->end_time, sizeof(struct timeval));
@@ -2010,9 +2802,40 @@ iperf_stats_callback(struct iperf_test *test)
         memcpy(&temp.interval_end_time, &rp->end_time, sizeof(struct timeval));
         temp.interval_duration = timeval_diff(&temp.interval_start_time, &temp.interval_end_time);
         //temp.interval_duration = timeval_diff(&temp.interval_start_time, &temp.interval_end_time);
+	if (test->rate_schedule != NULL)
+	    rate_schedule_interval(test->rate_schedule, rp, &temp);
 	if (test->protocol->id == Ptcp) {
+	    tcp_limits_unknown(&temp.limits);
+	    tcp_rcv_unknown(&temp.rcv);
+	    if (test->rr != NULL) {
+		temp.interval_transactions = sp->rr_transactions_this_interval;
+		sp->rr_transactions_this_interval = 0;
+		if (sp->rr_hist_interval != NULL) {
+		    iperf_histogram_summarize(sp->rr_hist_interval, &temp.rr_rtt);
+		    iperf_histogram_reset(sp->rr_hist_interval);
+		} else
+		    memset(&temp.rr_rtt, 0, sizeof(temp.rr_rtt));
+		temp.interval_failures = sp->crr_failures_this_interval;
+		sp->crr_failures_this_interval = 0;
+		if (sp->crr_connect_hist_interval != NULL) {
+		    iperf_histogram_summarize(sp->crr_connect_hist_interval, &temp.crr_connect);
+		    iperf_histogram_reset(sp->crr_connect_hist_interval);
+		} else
+		    memset(&temp.crr_connect, 0, sizeof(temp.crr_connect));
+	    }
 	    if ( has_tcpinfo()) {
 		save_tcpinfo(sp, &temp);
+		if (test->sender) {
+		    struct iperf_tcp_limits now;
+
+		    save_tcpinfo_limits(sp, &now);
+		    tcp_limits_delta(&temp.limits, &now, &rp->stream_prev_limits);
+		    tcp_limits_add(&rp->stream_limits, &temp.limits);
+		    rp->stream_prev_limits = now;
+		} else {
+		    save_tcpinfo_rcv(sp, &temp.rcv);
+		    tcp_rcv_update(rp, &temp.rcv);
+		}
 		if (test->sender && test->sender_has_retransmits) {
 		    long total_retrans = get_total_retransmits(&temp);
 		    temp.interval_retrans = total_retrans - rp->stream_prev_total_retrans;
@@ -2045,30 +2868,494 @@ iperf_stats_callback(struct iperf_test *test)
 		temp.interval_packet_count = sp->packet_count - irp->packet_count;
 		temp.interval_outoforder_packets = sp->outoforder_packets - irp->outoforder_packets;
 		temp.interval_cnt_error = sp->cnt_error - irp->cnt_error;
+		/*
+		 * A late datagram can fill a gap counted in an earlier
+		 * interval; that loss is only taken back from the total.
+		 */
+		if (temp.interval_cnt_error < 0)
+		    temp.interval_cnt_error = 0;
 	    }
 	    temp.packet_count = sp->packet_count;
 	    temp.jitter = sp->jitter;
+	    iperf_histogram_summarize(sp->owd_hist_interval, &temp.owd);
+	    iperf_histogram_summarize(sp->ipdv_hist_interval, &temp.ipdv);
+	    iperf_histogram_reset(sp->owd_hist_interval);
+	    iperf_histogram_reset(sp->ipdv_hist_interval);
+	    /* Gaps still in the window at the end are losses. */
+	    if (test->done)
+		iperf_seqwin_flush(sp->seqwin);
+	    temp.seqwin = sp->seqwin->interval;
+	    memset(&sp->seqwin->interval, 0, sizeof(sp->seqwin->interval));
 	    temp.outoforder_packets = sp->outoforder_packets;
 	    temp.cnt_error = sp->cnt_error;
+	    temp.socket_drops = stream_socket_drops(sp);
+	    if (temp.socket_drops < 0)
+		temp.interval_socket_drops = -1;
+	    else if (irp == NULL || irp->socket_drops < 0)
+		temp.interval_socket_drops = temp.socket_drops;
+	    else
+		temp.interval_socket_drops = temp.socket_drops - irp->socket_drops;
 	}
         add_to_interval_list(rp, &temp);
+	if (test->binlog != NULL)
+	    iperf_binlog_stream_interval(test, sp, &temp);
+	/* Omitted intervals are not part of the test. */
+	if (test->num_streams > 1 && !temp.omitted && temp.interval_duration > 0) {
+	    if (rp->rate_series == NULL) {
+		rp->rate_series = (struct iperf_fairness_series *) malloc(sizeof(struct iperf_fairness_series));
+		if (rp->rate_series != NULL)
+		    iperf_fairness_series_reset(rp->rate_series);
+	    }
+	    if (rp->rate_series != NULL)
+		iperf_fairness_series_add(rp->rate_series, temp.interval_start_time.tv_sec + temp.interval_start_time.tv_usec / 1e6, temp.bytes_transferred, temp.interval_duration);
+	}
         rp->bytes_sent_this_interval = rp->bytes_received_this_interval = 0;
     }
+    if (test->binlog != NULL)
+	iperf_binlog_interval(test);
+}
+
+/* Add the --rate-schedule target of an interval to its JSON object. */
+static void
+rate_schedule_json(struct iperf_test *test, cJSON *j, double target_rate, int step)
+{
+    if (j == NULL)
+	return;
+    cJSON_AddFloatToObject(j, "target_bits_per_second", target_rate);
+    if (test->rate_schedule->type == RATE_SCHEDULE_STEP)
+	cJSON_AddIntToObject(j, "step", step);
 }
 
 /**
- * Print intermediate results during a test (interval report).
- * Uses print_interval_results to print the results for each stream,
- * then prints an interval summary for all streams in this
- * interval.
+ * Print the percentiles of one latency distribution, either into the
+ * JSON object j under key or as a text line with label.  sock < 0
+ * means the [SUM] line.  Nothing is printed for an empty distribution.
  */
 static void
-iperf_print_intermediate(struct iperf_test *test)
+print_latency_results(struct iperf_test *test, int sock, const char *label, const char *key, cJSON *j, struct iperf_histogram_summary *sum)
 {
-    char ubuf[UNIT_LEN];
-    char nbuf[UNIT_LEN];
-    struct iperf_stream *sp = NULL;
-    struct iperf_interval_results *irp;
+    if (sum->count == 0)
+	return;
+    if (test->json_output) {
+	if (j != NULL)
+	    cJSON_AddItemToObject(j, key, iperf_histogram_summary_json(sum));
+    } else if (sock < 0)
+	iprintf(test, report_sum_delay_format, label, sum->p50 * 1000.0, sum->p90 * 1000.0, sum->p99 * 1000.0, sum->p999 * 1000.0, sum->max * 1000.0);
+    else
+	iprintf(test, report_delay_format, sock, label, sum->p50 * 1000.0, sum->p90 * 1000.0, sum->p99 * 1000.0, sum->p999 * 1000.0, sum->max * 1000.0);
+}
+
+/**
+ * Print how a TCP sender's time over seconds (times nstreams for the
+ * [SUM] line, sock < 0) divides between being limited by the receive
+ * window, the send buffer, cwnd and the application, with the bytes
+ * retransmitted and, for intervals, the latest delivery rate.  The
+ * text lines are only printed with -V.  Nothing is printed if the
+ * kernel does not report the limits.
+ */
+static void
+print_limits_results(struct iperf_test *test, int sock, cJSON *j, struct iperf_tcp_limits *l, double seconds, int nstreams)
+{
+    double total, rwnd, sndbuf, cwnd, app;
+    cJSON *jl;
+
+    if (l->busy < 0 || seconds <= 0)
+	return;
+    total = seconds * nstreams * SEC_TO_US;
+    /* busy is counted in jiffies, so it can overshoot a little. */
+    if (l->busy > total)
+	total = l->busy;
+    rwnd = 100.0 * l->rwnd / total;
+    sndbuf = 100.0 * l->sndbuf / total;
+    cwnd = 100.0 * (l->busy - l->rwnd - l->sndbuf) / total;
+    app = 100.0 - rwnd - sndbuf - cwnd;
+    if (app < 0)
+	app = 0;
+    if (test->json_output) {
+	if (j == NULL)
+	    return;
+	jl = iperf_json_printf("rwnd: %f  sndbuf: %f  cwnd: %f  application: %f", rwnd, sndbuf, cwnd, app);
+	cJSON_AddItemToObject(j, "limited_percent", jl);
+	if (l->bytes_retrans >= 0)
+	    cJSON_AddIntToObject(j, "bytes_retransmitted", l->bytes_retrans);
+	if (l->delivery_rate >= 0)
+	    cJSON_AddFloatToObject(j, "delivery_bits_per_second", l->delivery_rate * 8.0);
+    } else if (test->verbose) {
+	if (sock < 0)
+	    iprintf(test, report_sum_limits_format, rwnd, sndbuf, cwnd, app);
+	else
+	    iprintf(test, report_limits_format, sock, rwnd, sndbuf, cwnd, app);
+    }
+}
+
+/**
+ * Print what a TCP receiver saw of its socket.  The text line is only
+ * printed with -V.  Nothing is printed if the kernel does not report it.
+ */
+static void
+print_rcv_results(struct iperf_test *test, int sock, cJSON *j, struct iperf_tcp_rcv *r)
+{
+    char space[UNIT_LEN], ssthresh[UNIT_LEN], inq[UNIT_LEN], ooo[UNIT_LEN];
+    cJSON *jr;
+
+    if (r->rcv_space < 0)
+	return;
+    if (test->json_output) {
+	if (j == NULL)
+	    return;
+	jr = iperf_json_printf("rcv_rtt_us: %d  rcv_space: %d  rcv_ssthresh: %d", r->rcv_rtt, r->rcv_space, r->rcv_ssthresh);
+	if (r->ooopack >= 0)
+	    cJSON_AddIntToObject(jr, "out_of_order_packets", r->ooopack);
+	if (r->inq >= 0)
+	    cJSON_AddIntToObject(jr, "queued_bytes", r->inq);
+	cJSON_AddItemToObject(j, "receiver_tcp", jr);
+	return;
+    }
+    if (!test->verbose)
+	return;
+    unit_snprintf(space, UNIT_LEN, (double) r->rcv_space, 'A');
+    unit_snprintf(ssthresh, UNIT_LEN, (double) r->rcv_ssthresh, 'A');
+    if (r->inq >= 0)
+	unit_snprintf(inq, UNIT_LEN, (double) r->inq, 'A');
+    else
+	snprintf(inq, UNIT_LEN, "-");
+    if (r->ooopack >= 0)
+	snprintf(ooo, UNIT_LEN, "%lld", (long long) r->ooopack);
+    else
+	snprintf(ooo, UNIT_LEN, "-");
+    iprintf(test, report_rcv_format, sock, r->rcv_rtt / 1000.0, space, ssthresh, ooo, inq);
+}
+
+/**
+ * Print Jain's index and the spread of the n per-stream rates (bytes
+ * per second), into the JSON object j under "fairness" or as a [SUM]
+ * text line.  Returns the JSON object, or NULL.
+ */
+static cJSON *
+print_fairness_results(struct iperf_test *test, cJSON *j, double *rates, int n)
+{
+    struct iperf_fairness f;
+    char minbuf[UNIT_LEN], maxbuf[UNIT_LEN], sdbuf[UNIT_LEN];
+    cJSON *jf;
+
+    iperf_fairness_compute(rates, n, &f);
+    if (test->json_output) {
+	if (j == NULL)
+	    return NULL;
+	jf = iperf_json_printf("jain_index: %f  min_bits_per_second: %f  max_bits_per_second: %f  mean_bits_per_second: %f  stddev_bits_per_second: %f", f.jain, f.min * 8, f.max * 8, f.mean * 8, f.stddev * 8);
+	cJSON_AddItemToObject(j, "fairness", jf);
+	return jf;
+    }
+    unit_snprintf(minbuf, UNIT_LEN, f.min, test->settings->unit_format);
+    unit_snprintf(maxbuf, UNIT_LEN, f.max, test->settings->unit_format);
+    unit_snprintf(sdbuf, UNIT_LEN, f.stddev, test->settings->unit_format);
+    iprintf(test, report_sum_fairness_format, f.jain, minbuf, maxbuf, sdbuf);
+    return NULL;
+}
+
+/*
+ * Fairness over the whole test, and for each stream the time from
+ * which its interval rates stayed within FAIRNESS_STEADY_TOLERANCE of
+ * its steady share.  Only for parallel streams.
+ */
+static void
+print_fairness_summary(struct iperf_test *test, double seconds)
+{
+    struct iperf_stream *sp;
+    double *rates, share, start;
+    int n, i, index;
+    cJSON *jf, *jstreams = NULL;
+    char nbuf[UNIT_LEN];
+
+    if (test->num_streams <= 1 || SLIST_FIRST(&test->streams) == NULL || seconds <= 0)
+	return;
+    n = 0;
+    SLIST_FOREACH(sp, &test->streams, streams)
+	++n;
+    rates = (double *) malloc(n * sizeof(double));
+    if (rates == NULL)
+	return;
+    i = 0;
+    SLIST_FOREACH(sp, &test->streams, streams)
+	rates[i++] = (test->sender ? sp->result->bytes_sent : sp->result->bytes_received) / seconds;
+    jf = print_fairness_results(test, test->json_end, rates, n);
+    if (jf != NULL) {
+	jstreams = cJSON_CreateArray();
+	if (jstreams != NULL)
+	    cJSON_AddItemToObject(jf, "streams", jstreams);
+    }
+
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	share = 0;
+	start = -1;
+	if (sp->result->rate_series != NULL)
+	    share = iperf_fairness_series_steady(sp->result->rate_series, FAIRNESS_STEADY_TOLERANCE, &index);
+	else
+	    index = -1;
+	/*
+	 * Counted from the start, like the reported intervals.  With
+	 * --omit the start is reset just after the first interval began.
+	 */
+	if (index >= 0) {
+	    start = sp->result->rate_series->start[index] - (sp->result->start_time.tv_sec + sp->result->start_time.tv_usec / 1e6);
+	    if (start < 0)
+		start = 0;
+	}
+	if (test->json_output) {
+	    if (jstreams != NULL)
+		cJSON_AddItemToArray(jstreams, iperf_json_printf("socket: %d  share_bits_per_second: %f  steady_state_seconds: %f", (int64_t) sp->socket, share * 8, start));
+	} else {
+	    unit_snprintf(nbuf, UNIT_LEN, share, test->settings->unit_format);
+	    if (start < 0)
+		iprintf(test, report_steady_none_format, sp->socket, nbuf);
+	    else
+		iprintf(test, report_steady_format, sp->socket, nbuf, start);
+	}
+    }
+    free(rates);
+}
+
+/**
+ * Split a UDP receiver's lost datagrams into those its socket dropped
+ * for want of buffer space and those lost on the way.  The text line
+ * is only printed with -V, and only if the socket dropped any.
+ */
+static void
+print_socket_drops(struct iperf_test *test, int sock, cJSON *j, double st, double et, int64_t drops, int64_t lost)
+{
+    if (drops < 0)
+	return;
+    if (test->json_output) {
+	if (j != NULL) {
+	    cJSON_AddIntToObject(j, "socket_drops", drops);
+	    cJSON_AddIntToObject(j, "network_lost_packets", lost > drops ? lost - drops : 0);
+	}
+	return;
+    }
+    if (drops == 0 || !test->verbose)
+	return;
+    if (sock < 0)
+	iprintf(test, report_sum_socket_drops_format, st, et, (long long) drops, (long long) (lost > drops ? lost - drops : 0));
+    else
+	iprintf(test, report_socket_drops_format, sock, st, et, (long long) drops, (long long) (lost > drops ? lost - drops : 0));
+}
+
+/**
+ * Print what the stream's data path system calls did: how many, the
+ * bytes moved per call that moved any, and how many found nothing to
+ * do (EAGAIN), moved less than asked or hit a soft error.
+ */
+static void
+print_io_results(struct iperf_test *test, int sock, cJSON *j, struct net_stats *io)
+{
+    char nbuf[UNIT_LEN];
+    uint64_t moved;
+    double per_call, eagain_percent;
+
+    if (io->calls == 0)
+	return;
+    moved = io->calls - io->eagain - io->soft_errors;
+    per_call = moved > 0 ? (double) io->bytes / moved : 0;
+    eagain_percent = 100.0 * io->eagain / io->calls;
+    if (test->json_output) {
+	if (j != NULL)
+	    cJSON_AddItemToObject(j, "syscalls", iperf_json_printf("calls: %d  bytes_per_call: %f  eagain: %d  eagain_percent: %f  short: %d  soft_errors: %d", (int64_t) io->calls, per_call, (int64_t) io->eagain, eagain_percent, (int64_t) io->short_io, (int64_t) io->soft_errors));
+	return;
+    }
+    unit_snprintf(nbuf, UNIT_LEN, per_call, 'A');
+    iprintf(test, report_io_format, sock, (unsigned long long) io->calls, nbuf, (unsigned long long) io->eagain, eagain_percent, (unsigned long long) io->short_io, (unsigned long long) io->soft_errors);
+}
+
+/* One socket memory figure for text output, or "-" if unknown. */
+static void
+sockmem_snprintf(char *buf, int64_t v)
+{
+    if (v < 0)
+	snprintf(buf, UNIT_LEN, "-");
+    else
+	unit_snprintf(buf, UNIT_LEN, (double) v, 'A');
+}
+
+/**
+ * Print the socket's kernel memory and queues at the end of an
+ * interval, with the -w size asked for, to show whether the buffer is
+ * being used and whether the receive queue is backing up.
+ */
+static void
+print_sockmem_results(struct iperf_test *test, int sock, cJSON *j, struct net_sockmem *m)
+{
+    char rmem[UNIT_LEN], rcvbuf[UNIT_LEN], wmem[UNIT_LEN], sndbuf[UNIT_LEN];
+    char backlog[UNIT_LEN], inq[UNIT_LEN], outq[UNIT_LEN], drops[UNIT_LEN];
+    cJSON *jm;
+
+    if (m->rcvbuf < 0)
+	return;
+    if (test->json_output) {
+	if (j == NULL)
+	    return;
+	jm = iperf_json_printf("rcvbuf: %d  sndbuf: %d", m->rcvbuf, m->sndbuf);
+	if (test->settings->socket_bufsize > 0)
+	    cJSON_AddIntToObject(jm, "requested_bufsize", test->settings->socket_bufsize);
+	if (m->rmem_alloc >= 0) {
+	    cJSON_AddIntToObject(jm, "rmem_alloc", m->rmem_alloc);
+	    cJSON_AddIntToObject(jm, "wmem_alloc", m->wmem_alloc);
+	    cJSON_AddIntToObject(jm, "wmem_queued", m->wmem_queued);
+	}
+	if (m->backlog >= 0)
+	    cJSON_AddIntToObject(jm, "backlog", m->backlog);
+	if (m->drops >= 0)
+	    cJSON_AddIntToObject(jm, "drops", m->drops);
+	if (m->inq >= 0)
+	    cJSON_AddIntToObject(jm, "inq", m->inq);
+	if (m->outq >= 0)
+	    cJSON_AddIntToObject(jm, "outq", m->outq);
+	cJSON_AddItemToObject(j, "socket_memory", jm);
+	return;
+    }
+    sockmem_snprintf(rmem, m->rmem_alloc);
+    sockmem_snprintf(rcvbuf, m->rcvbuf);
+    sockmem_snprintf(wmem, m->wmem_queued > m->wmem_alloc ? m->wmem_queued : m->wmem_alloc);
+    sockmem_snprintf(sndbuf, m->sndbuf);
+    sockmem_snprintf(backlog, m->backlog);
+    sockmem_snprintf(inq, m->inq);
+    sockmem_snprintf(outq, m->outq);
+    if (m->drops >= 0)
+	snprintf(drops, UNIT_LEN, "%lld", (long long) m->drops);
+    else
+	snprintf(drops, UNIT_LEN, "-");
+    iprintf(test, report_sockmem_format, sock, rmem, rcvbuf, wmem, sndbuf, backlog, drops, inq, outq);
+}
+
+/* Format a distribution of sequence window counts as " (1:n 2-3:n ...)". */
+static void
+seqwin_buckets_snprintf(char *buf, size_t len, const uint64_t *buckets)
+{
+    size_t n = 0;
+    int i;
+
+    buf[0] = '\0';
+    for (i = 0; i < SEQWIN_BUCKETS && n < len; ++i)
+	if (buckets[i] > 0)
+	    n += snprintf(buf + n, len - n, "%s%s:%llu", n > 0 ? " " : " (", iperf_seqwin_label(i), (unsigned long long) buckets[i]);
+    if (n > 0 && n < len)
+	snprintf(buf + n, len - n, ")");
+}
+
+/**
+ * Print UDP reordering, duplicates and loss bursts, either as a
+ * "sequence" object in j or, with -V and if there were any, as a text
+ * line.  sock < 0 means the [SUM] line.
+ */
+static void
+print_seqwin_results(struct iperf_test *test, int sock, cJSON *j, struct iperf_seqwin_counts *c)
+{
+    uint64_t reordered, bursts;
+    char rbuf[128], bbuf[128];
+
+    if (test->json_output) {
+	if (j != NULL)
+	    cJSON_AddItemToObject(j, "sequence", iperf_seqwin_to_json(c));
+	return;
+    }
+    if (!test->verbose)
+	return;
+    reordered = iperf_seqwin_total(c->reorder);
+    bursts = iperf_seqwin_total(c->bursts);
+    if (reordered == 0 && bursts == 0 && c->duplicates == 0)
+	return;
+    seqwin_buckets_snprintf(rbuf, sizeof(rbuf), c->reorder);
+    seqwin_buckets_snprintf(bbuf, sizeof(bbuf), c->bursts);
+    if (sock < 0)
+	iprintf(test, report_sum_seqwin_format, (unsigned long long) reordered, rbuf, (unsigned long long) c->duplicates, (unsigned long long) bursts, bbuf);
+    else
+	iprintf(test, report_seqwin_format, sock, (unsigned long long) reordered, rbuf, (unsigned long long) c->duplicates, (unsigned long long) bursts, bbuf);
+}
+
+/**
+ * Print the --sample-interval rates and stalls after --omit, either as
+ * an object named name in j, along with the samples, or as a text
+ * line.  sock < 0 means the [SUM] line.
+ */
+static void
+print_sample_results(struct iperf_test *test, int sock, cJSON *j, const char *name, struct iperf_sample_ring *r)
+{
+    struct iperf_sample_stats st;
+    char minbuf[UNIT_LEN], medbuf[UNIT_LEN], maxbuf[UNIT_LEN];
+    cJSON *js;
+
+    if (iperf_sample_summarize(r, (uint64_t) test->omit * SEC_TO_US, &st) < 0)
+	return;
+    if (test->json_output) {
+	if (j == NULL || (js = iperf_sample_to_json(r)) == NULL)
+	    return;
+	cJSON_AddFloatToObject(js, "period_ms", test->sample->period / 1000.0);
+	cJSON_AddFloatToObject(js, "min_bits_per_second", st.min * 8);
+	cJSON_AddFloatToObject(js, "median_bits_per_second", st.median * 8);
+	cJSON_AddFloatToObject(js, "max_bits_per_second", st.max * 8);
+	cJSON_AddIntToObject(js, "stalls", st.stalls);
+	cJSON_AddFloatToObject(js, "longest_stall_ms", st.longest_stall * 1000);
+	cJSON_AddItemToObject(j, name, js);
+	return;
+    }
+    unit_snprintf(minbuf, UNIT_LEN, st.min, test->settings->unit_format);
+    unit_snprintf(medbuf, UNIT_LEN, st.median, test->settings->unit_format);
+    unit_snprintf(maxbuf, UNIT_LEN, st.max, test->settings->unit_format);
+    if (sock < 0)
+	iprintf(test, report_sum_sample_format, test->sample->period / 1000.0, minbuf, medbuf, maxbuf, (unsigned long long) st.stalls, st.longest_stall * 1000);
+    else
+	iprintf(test, report_sample_format, sock, test->sample->period / 1000.0, minbuf, medbuf, maxbuf, (unsigned long long) st.stalls, st.longest_stall * 1000);
+}
+
+/**
+ * Print --rr transactions and, on the client, their round-trip times,
+ * either into the JSON object j or as text.  sock < 0 means the [SUM]
+ * line.  For --crr a transaction is a connection, and the failed
+ * connections and the connect times are printed as well.
+ */
+static void
+print_rr_results(struct iperf_test *test, int sock, cJSON *j, double start_time, double end_time, double seconds, iperf_size_t transactions, struct iperf_histogram_summary *rtt, iperf_size_t failures, struct iperf_histogram_summary *connect, int omitted)
+{
+    double rate;
+
+    rate = seconds > 0 ? transactions / seconds : 0.0;
+    if (test->json_output) {
+	if (j == NULL)
+	    return;
+	if (test->rr->connect) {
+	    cJSON_AddIntToObject(j, "connections", transactions);
+	    cJSON_AddFloatToObject(j, "connections_per_second", rate);
+	    cJSON_AddIntToObject(j, "failed", failures);
+	} else {
+	    cJSON_AddIntToObject(j, "transactions", transactions);
+	    cJSON_AddFloatToObject(j, "transactions_per_second", rate);
+	}
+    } else if (test->rr->connect) {
+	if (sock < 0)
+	    iprintf(test, report_sum_crr_format, start_time, end_time, (unsigned long long) transactions, rate, (unsigned long long) failures, omitted?report_omitted:"");
+	else
+	    iprintf(test, report_crr_format, sock, start_time, end_time, (unsigned long long) transactions, rate, (unsigned long long) failures, omitted?report_omitted:"");
+    } else if (sock < 0)
+	iprintf(test, report_sum_rr_format, start_time, end_time, (unsigned long long) transactions, rate, omitted?report_omitted:"");
+    else
+	iprintf(test, report_rr_format, sock, start_time, end_time, (unsigned long long) transactions, rate, omitted?report_omitted:"");
+    if (test->rr->connect)
+	print_latency_results(test, sock, report_connect, "connect_ms", j, connect);
+    print_latency_results(test, sock, report_rtt, "rtt_ms", j, rtt);
+}
+
+/**
+ * Print intermediate results during a test (interval report).
+ * Uses print_interval_results to print the results for each stream,
+ * then prints an interval summary for all streams in this
+ * interval.
+ */
+static void
+iperf_print_intermediate(struct iperf_test *test)
+{
+    char ubuf[UNIT_LEN];
+    char nbuf[UNIT_LEN];
+    struct iperf_stream *sp = NULL;
+    struct iperf_interval_results *irp;
     iperf_size_t bytes = 0;
     double bandwidth;
     int retransmits = 0;
@@ -2077,6 +3364,10 @@ iperf_print_intermediate(struct iperf_test *test)
     cJSON *json_interval_streams;
     int total_packets = 0, lost_packets = 0;
     double avg_jitter = 0.0, lost_percent;
+    double target_rate = 0.0;
+    iperf_size_t transactions = 0, failures = 0;
+    struct iperf_histogram_summary no_rtt;
+    char pbuf[512];
 
     if (test->json_output) {
         json_interval = cJSON_CreateObject();
@@ -2095,12 +3386,15 @@ iperf_print_intermediate(struct iperf_test *test)
     SLIST_FOREACH(sp, &test->streams, streams) {
         print_interval_results(test, sp, json_interval_streams);
 	/* sum up all streams */
-	irp = TAILQ_LAST(&sp->result->interval_results, irlisthead);
+	irp = iperf_last_interval_results(sp->result);
 	if (irp == NULL) {
 	    iperf_err(test, "iperf_print_intermediate error: interval_results is NULL");
 	    return;
 	}
         bytes += irp->bytes_transferred;
+	target_rate += irp->target_rate;
+	transactions += irp->interval_transactions;
+	failures += irp->interval_failures;
 	if (test->protocol->id == Ptcp) {
 	    if (test->sender && test->sender_has_retransmits) {
 		retransmits += irp->interval_retrans;
@@ -2117,7 +3411,7 @@ iperf_print_intermediate(struct iperf_test *test)
         sp = SLIST_FIRST(&test->streams); /* reset back to 1st stream */
 	/* Only do this of course if there was a first stream */
 	if (sp) {
-        irp = TAILQ_LAST(&sp->result->interval_results, irlisthead);    /* use 1st stream for timing info */
+        irp = iperf_last_interval_results(sp->result);    /* use 1st stream for timing info */
 
         unit_snprintf(ubuf, UNIT_LEN, (double) bytes, 'A');
 	bandwidth = (double) bytes / (double) irp->interval_duration;
@@ -2139,6 +3433,11 @@ iperf_print_intermediate(struct iperf_test *test)
 		else
 		    iprintf(test, report_sum_bw_format, start_time, end_time, ubuf, nbuf, test->omitting?report_omitted:"");
 	    }
+	    if (test->rr != NULL) {
+		/* The round-trip times are only summarized per stream. */
+		memset(&no_rtt, 0, sizeof(no_rtt));
+		print_rr_results(test, -1, test->json_output ? cJSON_GetObjectItem(json_interval, "sum") : NULL, start_time, end_time, irp->interval_duration, transactions, &no_rtt, failures, &no_rtt, test->omitting);
+	    }
 	} else {
 	    /* Interval sum, UDP. */
 	    if (test->sender) {
@@ -2148,15 +3447,125 @@ iperf_print_intermediate(struct iperf_test *test)
 		    iprintf(test, report_sum_bw_udp_sender_format, start_time, end_time, ubuf, nbuf, total_packets, test->omitting?report_omitted:"");
 	    } else {
 		avg_jitter /= test->num_streams;
-		lost_percent = 100.0 * lost_packets / total_packets;
+		/* An interval can pass without a datagram. */
+		lost_percent = total_packets > 0 ? 100.0 * lost_packets / total_packets : 0.0;
 		if (test->json_output)
 		    cJSON_AddItemToObject(json_interval, "sum", iperf_json_printf("start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f  jitter_ms: %f  lost_packets: %d  packets: %d  lost_percent: %f  omitted: %b", (double) start_time, (double) end_time, (double) irp->interval_duration, (int64_t) bytes, bandwidth * 8, (double) avg_jitter * 1000.0, (int64_t) lost_packets, (int64_t) total_packets, (double) lost_percent, test->omitting));
 		else
 		    iprintf(test, report_sum_bw_udp_format, start_time, end_time, ubuf, nbuf, avg_jitter * 1000.0, lost_packets, total_packets, lost_percent, test->omitting?report_omitted:"");
 	    }
 	}
+	if (test->num_streams > 1) {
+	    double *rates = (double *) malloc(test->num_streams * sizeof(double));
+	    int n = 0;
+
+	    if (rates != NULL) {
+		SLIST_FOREACH(sp, &test->streams, streams) {
+		    irp = iperf_last_interval_results(sp->result);
+		    if (n < test->num_streams && irp->interval_duration > 0)
+			rates[n++] = irp->bytes_transferred / irp->interval_duration;
+		}
+		if (test->json_output)
+		    print_fairness_results(test, cJSON_GetObjectItem(json_interval, "sum"), rates, n);
+		else if (test->verbose)
+		    print_fairness_results(test, NULL, rates, n);
+		free(rates);
+	    }
+	}
 	}
     }
+
+    /* Label the interval with the scheduled rate, summed over the streams. */
+    if (test->rate_schedule != NULL) {
+	sp = SLIST_FIRST(&test->streams);
+	if (sp) {
+	    irp = iperf_last_interval_results(sp->result);
+	    if (test->json_output)
+		rate_schedule_json(test, cJSON_GetObjectItem(json_interval, "sum"), target_rate, irp->rate_step);
+	    else {
+		start_time = timeval_diff(&sp->result->start_time,&irp->interval_start_time);
+		end_time = timeval_diff(&sp->result->start_time,&irp->interval_end_time);
+		unit_snprintf(nbuf, UNIT_LEN, target_rate / 8, test->settings->unit_format);
+		if (test->rate_schedule->type == RATE_SCHEDULE_STEP)
+		    iprintf(test, report_rate_step_format, start_time, end_time, nbuf, irp->rate_step);
+		else
+		    iprintf(test, report_rate_target_format, start_time, end_time, nbuf);
+	    }
+	}
+    }
+
+    /* What moving this interval's bytes cost the I/O thread. */
+    sp = SLIST_FIRST(&test->streams);
+    if (sp) {
+	irp = iperf_last_interval_results(sp->result);
+	start_time = timeval_diff(&sp->result->start_time,&irp->interval_start_time);
+	end_time = timeval_diff(&sp->result->start_time,&irp->interval_end_time);
+	if (test->json_output)
+	    cJSON_AddItemToObject(json_interval, "cpu", iperf_json_printf("user_seconds: %f  system_seconds: %f  cpu_seconds_per_gb: %f", irp->cpu_user, irp->cpu_system, cpu_per_gb(irp->cpu_user + irp->cpu_system, bytes)));
+	else if (test->verbose) {
+	    iprintf(test, report_cpu_interval_format, start_time, end_time, irp->cpu_user, irp->cpu_system, cpu_per_gb(irp->cpu_user + irp->cpu_system, bytes));
+	}
+	if (test->perf != NULL) {
+	    if (test->json_output)
+		cJSON_AddItemToObject(json_interval, "perf_counters", iperf_perf_to_json(&irp->perf, bytes));
+	    else if (test->verbose) {
+		iperf_perf_snprintf(pbuf, sizeof(pbuf), &irp->perf, bytes);
+		iprintf(test, report_perf_interval_format, start_time, end_time, pbuf);
+	    }
+	}
+    }
+
+    if (test->json_stream) {
+	iperf_json_stream_start(test);
+	iperf_json_stream_event(test, "interval", cJSON_DetachItemFromArray(test->json_intervals, cJSON_GetArraySize(test->json_intervals) - 1));
+    }
+}
+
+/**
+ * Print UDP one-way delay and delay variation percentiles, either into
+ * the JSON object j or, with -V, as text.  sock < 0 means the [SUM]
+ * line.
+ */
+static void
+print_delay_results(struct iperf_test *test, int sock, cJSON *j, struct iperf_histogram_summary *owd, struct iperf_histogram_summary *ipdv)
+{
+    if (owd->count == 0)
+	return;
+    if (test->json_output) {
+	if (j == NULL)
+	    return;
+	cJSON_AddItemToObject(j, "owd_ms", iperf_histogram_summary_json(owd));
+	cJSON_AddItemToObject(j, "ipdv_ms", iperf_histogram_summary_json(ipdv));
+    } else if (!test->verbose) {
+	return;
+    } else if (sock < 0) {
+	iprintf(test, report_sum_delay_format, report_owd, owd->p50 * 1000.0, owd->p90 * 1000.0, owd->p99 * 1000.0, owd->p999 * 1000.0, owd->max * 1000.0);
+	iprintf(test, report_sum_delay_format, report_ipdv, ipdv->p50 * 1000.0, ipdv->p90 * 1000.0, ipdv->p99 * 1000.0, ipdv->p999 * 1000.0, ipdv->max * 1000.0);
+    } else {
+	iprintf(test, report_delay_format, sock, report_owd, owd->p50 * 1000.0, owd->p90 * 1000.0, owd->p99 * 1000.0, owd->p999 * 1000.0, owd->max * 1000.0);
+	iprintf(test, report_delay_format, sock, report_ipdv, ipdv->p50 * 1000.0, ipdv->p90 * 1000.0, ipdv->p99 * 1000.0, ipdv->p999 * 1000.0, ipdv->max * 1000.0);
+    }
+}
+
+/**
+ * Print the --txtime pacing results for one stream: packets the
+ * sender dropped for missing their slot, and how far the receiver's
+ * inter-arrival spacing strayed from the intended departure spacing.
+ */
+static void
+print_txtime_results(struct iperf_test *test, struct iperf_stream *sp, cJSON *json_summary_stream)
+{
+    double avg_error;
+
+    avg_error = sp->txtime_error_count ? sp->txtime_error_sum / sp->txtime_error_count : 0.0;
+    if (test->json_output)
+	cJSON_AddItemToObject(json_summary_stream, "txtime", iperf_json_printf("mode: %s  late_drops: %d  spacing_error_avg_us: %f  spacing_error_max_us: %f  spacing_samples: %d", txtime_name(test->txtime), (int64_t) sp->txtime_late, avg_error / 1000.0, sp->txtime_error_max / 1000.0, (int64_t) sp->txtime_error_count));
+    else {
+	if (test->sender && test->txtime == TXTIME_SW)
+	    iprintf(test, report_txtime_late, sp->socket, (unsigned long long) sp->txtime_late);
+	if (sp->txtime_error_count > 0)
+	    iprintf(test, report_txtime_error, sp->socket, avg_error / 1000.0, sp->txtime_error_max / 1000.0, (unsigned long long) sp->txtime_error_count);
+    }
 }
 
 /**
@@ -2170,6 +3579,7 @@ iperf_print_results(struct iperf_test *test)
     cJSON *json_summary_stream = NULL;
     int total_retransmits = 0;
     int total_packets = 0, lost_packets = 0;
+    int64_t total_socket_drops = -1;
     char ubuf[UNIT_LEN];
     char nbuf[UNIT_LEN];
     struct stat sb;
@@ -2179,6 +3589,20 @@ iperf_print_results(struct iperf_test *test)
     iperf_size_t bytes_received, total_received = 0;
     double start_time, end_time, avg_jitter = 0.0, lost_percent;
     double bandwidth;
+    cJSON *json_udp;
+    struct iperf_histogram *owd_sum = NULL, *ipdv_sum = NULL;
+    struct iperf_histogram_summary owd, ipdv;
+    struct iperf_seqwin_counts seqwin_sum;
+    struct iperf_tcp_limits limits, limits_sum;
+    cJSON *json_cpu;
+    char pbuf[512];
+    struct iperf_histogram *rtt_sum = NULL, *connect_sum = NULL;
+    struct iperf_histogram_summary rtt, connect;
+    cJSON *json_rr;
+    iperf_size_t total_transactions = 0, total_failures = 0;
+
+    if (test->binlog != NULL)
+	iperf_binlog_summary(test);
 
     /* print final summary for all intervals */
 
@@ -2200,6 +3624,17 @@ iperf_print_results(struct iperf_test *test)
 	    iprintf(test, "%s", report_bw_udp_header);
     }
 
+    if (test->protocol->id == Pudp) {
+	owd_sum = iperf_histogram_new();
+	ipdv_sum = iperf_histogram_new();
+    }
+    if (test->rr != NULL) {
+	rtt_sum = iperf_histogram_new();
+	connect_sum = iperf_histogram_new();
+    }
+
+    memset(&seqwin_sum, 0, sizeof(seqwin_sum));
+    memset(&limits_sum, 0, sizeof(limits_sum));
     start_time = 0.;
     sp = SLIST_FIRST(&test->streams);
     /* 
@@ -2214,7 +3649,7 @@ iperf_print_results(struct iperf_test *test)
 	if (test->json_output) {
 	    json_summary_stream = cJSON_CreateObject();
 	    if (json_summary_stream == NULL)
-		return;
+		goto done;
 	    cJSON_AddItemToArray(json_summary_streams, json_summary_stream);
 	}
 
@@ -2250,18 +3685,47 @@ iperf_print_results(struct iperf_test *test)
 		else
 		    iprintf(test, report_bw_format, sp->socket, start_time, end_time, ubuf, nbuf, report_sender);
 	    }
+	    if (test->protocol->id == Ptcp) {
+		limits = sp->result->stream_limits;
+		limits.delivery_rate = -1;
+		tcp_limits_add(&limits_sum, &limits);
+		print_limits_results(test, sp->socket, test->json_output ? cJSON_GetObjectItem(json_summary_stream, "sender") : NULL, &limits, end_time, 1);
+	    }
 	} else {
 	    /* Summary, UDP. */
-	    lost_percent = 100.0 * sp->cnt_error / (sp->packet_count - sp->omitted_packet_count);
-	    if (test->json_output)
-		cJSON_AddItemToObject(json_summary_stream, "udp", iperf_json_printf("socket: %d  start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f  jitter_ms: %f  lost_packets: %d  packets: %d  lost_percent: %f", (int64_t) sp->socket, (double) start_time, (double) end_time, (double) end_time, (int64_t) bytes_sent, bandwidth * 8, (double) sp->jitter * 1000.0, (int64_t) sp->cnt_error, (int64_t) (sp->packet_count - sp->omitted_packet_count), (double) lost_percent));
-	    else {
+	    /* Nothing counted is nothing lost, rather than 0/0. */
+	    if (sp->packet_count - sp->omitted_packet_count > 0)
+		lost_percent = 100.0 * sp->cnt_error / (sp->packet_count - sp->omitted_packet_count);
+	    else
+		lost_percent = 0.0;
+	    json_udp = NULL;
+	    if (test->json_output) {
+		json_udp = iperf_json_printf("socket: %d  start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f  jitter_ms: %f  lost_packets: %d  packets: %d  lost_percent: %f", (int64_t) sp->socket, (double) start_time, (double) end_time, (double) end_time, (int64_t) bytes_sent, bandwidth * 8, (double) sp->jitter * 1000.0, (int64_t) sp->cnt_error, (int64_t) (sp->packet_count - sp->omitted_packet_count), (double) lost_percent);
+		cJSON_AddItemToObject(json_summary_stream, "udp", json_udp);
+	    } else {
 		iprintf(test, report_bw_udp_format, sp->socket, start_time, end_time, ubuf, nbuf, sp->jitter * 1000.0, sp->cnt_error, (sp->packet_count - sp->omitted_packet_count), lost_percent, "");
 		if (test->role == 'c')
 		    iprintf(test, report_datagrams, sp->socket, (sp->packet_count - sp->omitted_packet_count));
 		if (sp->outoforder_packets > 0)
-		    iprintf(test, report_sum_outoforder, start_time, end_time, sp->cnt_error);
+		    iprintf(test, report_outoforder, sp->socket, start_time, end_time, sp->outoforder_packets);
+	    }
+	    if (stream_socket_drops(sp) >= 0) {
+		print_socket_drops(test, sp->socket, json_udp, start_time, end_time, stream_socket_drops(sp), sp->cnt_error);
+		total_socket_drops = (total_socket_drops < 0 ? 0 : total_socket_drops) + stream_socket_drops(sp);
+	    }
+	    if (sp->owd_hist != NULL) {
+		iperf_histogram_summarize(sp->owd_hist, &owd);
+		iperf_histogram_summarize(sp->ipdv_hist, &ipdv);
+		print_delay_results(test, sp->socket, json_udp, &owd, &ipdv);
+		if (owd_sum != NULL && ipdv_sum != NULL) {
+		    iperf_histogram_merge(owd_sum, sp->owd_hist);
+		    iperf_histogram_merge(ipdv_sum, sp->ipdv_hist);
+		}
+		print_seqwin_results(test, sp->socket, json_udp, &sp->seqwin->total);
+		iperf_seqwin_merge(&seqwin_sum, &sp->seqwin->total);
 	    }
+	    if (test->txtime)
+		print_txtime_results(test, sp, json_summary_stream);
 	}
 
 	if (sp->diskfile_fd >= 0) {
@@ -2283,7 +3747,41 @@ iperf_print_results(struct iperf_test *test)
 		cJSON_AddItemToObject(json_summary_stream, "receiver", iperf_json_printf("socket: %d  start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f", (int64_t) sp->socket, (double) start_time, (double) end_time, (double) end_time, (int64_t) bytes_received, bandwidth * 8));
 	    else
 		iprintf(test, report_bw_format, sp->socket, start_time, end_time, ubuf, nbuf, report_receiver);
+	    if (test->protocol->id == Ptcp)
+		print_rcv_results(test, sp->socket, test->json_output ? cJSON_GetObjectItem(json_summary_stream, "receiver") : NULL, &sp->result->stream_rcv);
 	}
+
+	if (test->rr != NULL) {
+	    json_rr = NULL;
+	    if (test->json_output) {
+		json_rr = cJSON_CreateObject();
+		if (json_rr == NULL)
+		    goto done;
+		cJSON_AddItemToObject(json_summary_stream, test->rr->connect ? "crr" : "rr", json_rr);
+	    }
+	    memset(&rtt, 0, sizeof(rtt));
+	    if (sp->rr_hist != NULL) {
+		iperf_histogram_summarize(sp->rr_hist, &rtt);
+		if (rtt_sum != NULL)
+		    iperf_histogram_merge(rtt_sum, sp->rr_hist);
+	    }
+	    memset(&connect, 0, sizeof(connect));
+	    if (sp->crr_connect_hist != NULL) {
+		iperf_histogram_summarize(sp->crr_connect_hist, &connect);
+		if (connect_sum != NULL)
+		    iperf_histogram_merge(connect_sum, sp->crr_connect_hist);
+	    }
+	    total_transactions += sp->rr_transactions;
+	    total_failures += sp->crr_failures;
+	    print_rr_results(test, sp->socket, json_rr, start_time, end_time, end_time, sp->rr_transactions, &rtt, sp->crr_failures, &connect, 0);
+	}
+
+	if (sp->tcpsample != NULL && test->json_output)
+	    cJSON_AddItemToObject(json_summary_stream, "tcpinfo_samples", iperf_tcpsample_to_json(test, sp));
+	if (sp->sample != NULL)
+	    print_sample_results(test, sp->socket, json_summary_stream, "samples", sp->sample);
+	if (test->json_output || test->verbose)
+	    print_io_results(test, sp->socket, json_summary_stream, &sp->io);
     }
     }
 
@@ -2311,6 +3809,8 @@ iperf_print_results(struct iperf_test *test)
 		else
 		    iprintf(test, report_sum_bw_format, start_time, end_time, ubuf, nbuf, report_sender);
 	    }
+	    if (test->protocol->id == Ptcp)
+		print_limits_results(test, -1, test->json_output ? cJSON_GetObjectItem(test->json_end, "sum_sent") : NULL, &limits_sum, end_time, test->num_streams);
             unit_snprintf(ubuf, UNIT_LEN, (double) total_received, 'A');
 	    /* If no tests were run, set received bandwidth to 0 */
 	    if (end_time > 0.0) {
@@ -2324,6 +3824,21 @@ iperf_print_results(struct iperf_test *test)
 		cJSON_AddItemToObject(test->json_end, "sum_received", iperf_json_printf("start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f", (double) start_time, (double) end_time, (double) end_time, (int64_t) total_received, bandwidth * 8));
 	    else
 		iprintf(test, report_sum_bw_format, start_time, end_time, ubuf, nbuf, report_receiver);
+	    if (test->rr != NULL) {
+		json_rr = NULL;
+		if (test->json_output) {
+		    json_rr = cJSON_CreateObject();
+		    if (json_rr != NULL)
+			cJSON_AddItemToObject(test->json_end, test->rr->connect ? "sum_crr" : "sum_rr", json_rr);
+		}
+		memset(&rtt, 0, sizeof(rtt));
+		if (rtt_sum != NULL)
+		    iperf_histogram_summarize(rtt_sum, &rtt);
+		memset(&connect, 0, sizeof(connect));
+		if (connect_sum != NULL)
+		    iperf_histogram_summarize(connect_sum, &connect);
+		print_rr_results(test, -1, json_rr, start_time, end_time, end_time, total_transactions, &rtt, total_failures, &connect, 0);
+	    }
         } else {
 	    /* Summary sum, UDP. */
             avg_jitter /= test->num_streams;
@@ -2334,18 +3849,50 @@ iperf_print_results(struct iperf_test *test)
 	    else {
 		lost_percent = 100.0;
 	    }
-	    if (test->json_output)
-		cJSON_AddItemToObject(test->json_end, "sum", iperf_json_printf("start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f  jitter_ms: %f  lost_packets: %d  packets: %d  lost_percent: %f", (double) start_time, (double) end_time, (double) end_time, (int64_t) total_sent, bandwidth * 8, (double) avg_jitter * 1000.0, (int64_t) lost_packets, (int64_t) total_packets, (double) lost_percent));
-	    else
+	    json_udp = NULL;
+	    if (test->json_output) {
+		json_udp = iperf_json_printf("start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f  jitter_ms: %f  lost_packets: %d  packets: %d  lost_percent: %f", (double) start_time, (double) end_time, (double) end_time, (int64_t) total_sent, bandwidth * 8, (double) avg_jitter * 1000.0, (int64_t) lost_packets, (int64_t) total_packets, (double) lost_percent);
+		cJSON_AddItemToObject(test->json_end, "sum", json_udp);
+	    } else
 		iprintf(test, report_sum_bw_udp_format, start_time, end_time, ubuf, nbuf, avg_jitter * 1000.0, lost_packets, total_packets, lost_percent, "");
+	    if (test->num_streams > 1)
+		print_socket_drops(test, -1, json_udp, start_time, end_time, total_socket_drops, lost_packets);
+	    if (owd_sum != NULL && ipdv_sum != NULL) {
+		iperf_histogram_summarize(owd_sum, &owd);
+		iperf_histogram_summarize(ipdv_sum, &ipdv);
+		print_delay_results(test, -1, json_udp, &owd, &ipdv);
+	    }
+	    print_seqwin_results(test, -1, json_udp, &seqwin_sum);
         }
     }
+    if (!test->json_output && test->verbose && total_socket_drops > 0 && 2 * total_socket_drops > lost_packets)
+	iprintf(test, "%s", report_socket_drops_hint);
+    if (test->sample != NULL && test->num_streams > 1)
+	print_sample_results(test, -1, test->json_end, "sum_samples", test->sample->sum);
+    print_fairness_summary(test, end_time);
 
-    if (test->json_output)
+    if (test->json_output) {
 	cJSON_AddItemToObject(test->json_end, "cpu_utilization_percent", iperf_json_printf("host_total: %f  host_user: %f  host_system: %f  remote_total: %f  remote_user: %f  remote_system: %f", (double) test->cpu_util[0], (double) test->cpu_util[1], (double) test->cpu_util[2], (double) test->remote_cpu_util[0], (double) test->remote_cpu_util[1], (double) test->remote_cpu_util[2]));
-    else {
+	json_cpu = iperf_json_printf("host_user_seconds: %f  host_system_seconds: %f  host_cpu_seconds_per_gb: %f", test->thread_cpu[0], test->thread_cpu[1], cpu_per_gb(test->thread_cpu[0] + test->thread_cpu[1], local_bytes(test)));
+	if (json_cpu != NULL && test->remote_cpu_per_gb >= 0) {
+	    cJSON_AddFloatToObject(json_cpu, "remote_user_seconds", test->remote_thread_cpu[0]);
+	    cJSON_AddFloatToObject(json_cpu, "remote_system_seconds", test->remote_thread_cpu[1]);
+	    cJSON_AddFloatToObject(json_cpu, "remote_cpu_seconds_per_gb", test->remote_cpu_per_gb);
+	}
+	cJSON_AddItemToObject(test->json_end, "cpu_cost", json_cpu);
+	if (test->perf != NULL)
+	    cJSON_AddItemToObject(test->json_end, "perf_counters", iperf_perf_to_json(&test->perf_total, local_bytes(test)));
+    } else {
 	if (test->verbose) {
 	    iprintf(test, report_cpu, report_local, test->sender?report_sender:report_receiver, test->cpu_util[0], test->cpu_util[1], test->cpu_util[2], report_remote, test->sender?report_receiver:report_sender, test->remote_cpu_util[0], test->remote_cpu_util[1], test->remote_cpu_util[2]);
+	    if (test->remote_cpu_per_gb >= 0)
+		iprintf(test, report_cpu_cost, report_local, test->sender?report_sender:report_receiver, cpu_per_gb(test->thread_cpu[0] + test->thread_cpu[1], local_bytes(test)), test->thread_cpu[0] + test->thread_cpu[1], report_remote, test->sender?report_receiver:report_sender, test->remote_cpu_per_gb, test->remote_thread_cpu[0] + test->remote_thread_cpu[1]);
+	    else
+		iprintf(test, report_cpu_cost_local, report_local, test->sender?report_sender:report_receiver, cpu_per_gb(test->thread_cpu[0] + test->thread_cpu[1], local_bytes(test)), test->thread_cpu[0] + test->thread_cpu[1]);
+	}
+	if (test->perf != NULL) {
+	    iperf_perf_snprintf(pbuf, sizeof(pbuf), &test->perf_total, local_bytes(test));
+	    iprintf(test, report_perf_format, pbuf);
 	}
 
 	/* Print server output if we're on the client and it was requested/provided */
@@ -2361,6 +3908,12 @@ iperf_print_results(struct iperf_test *test)
 	    }
 	}
     }
+
+  done:
+    iperf_histogram_free(owd_sum);
+    iperf_histogram_free(ipdv_sum);
+    iperf_histogram_free(rtt_sum);
+    iperf_histogram_free(connect_sum);
 }
 
 /**************************************************************************/
@@ -2403,7 +3956,7 @@ print_interval_results(struct iperf_test *test, struct iperf_stream *sp, cJSON *
     struct iperf_interval_results *irp = NULL;
     double bandwidth, lost_percent;
 
-    irp = TAILQ_LAST(&sp->result->interval_results, irlisthead); /* get last entry in linked list */
+    irp = iperf_last_interval_results(sp->result); /* newest entry in the interval ring */
     if (irp == NULL) {
 	iperf_err(test, "print_interval_results error: interval_results is NULL");
         return;
@@ -2455,6 +4008,12 @@ print_interval_results(struct iperf_test *test, struct iperf_stream *sp, cJSON *
 	    else
 		iprintf(test, report_bw_format, sp->socket, st, et, ubuf, nbuf, irp->omitted?report_omitted:"");
 	}
+	if (test->rr != NULL)
+	    print_rr_results(test, sp->socket, test->json_output ? cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1) : NULL, st, et, irp->interval_duration, irp->interval_transactions, &irp->rr_rtt, irp->interval_failures, &irp->crr_connect, irp->omitted);
+	if (test->protocol->id == Ptcp && test->sender)
+	    print_limits_results(test, sp->socket, test->json_output ? cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1) : NULL, &irp->limits, irp->interval_duration, 1);
+	if (test->protocol->id == Ptcp && !test->sender)
+	    print_rcv_results(test, sp->socket, test->json_output ? cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1) : NULL, &irp->rcv);
     } else {
 	/* Interval, UDP. */
 	if (test->sender) {
@@ -2463,33 +4022,55 @@ print_interval_results(struct iperf_test *test, struct iperf_stream *sp, cJSON *
 	    else
 		iprintf(test, report_bw_udp_sender_format, sp->socket, st, et, ubuf, nbuf, irp->interval_packet_count, irp->omitted?report_omitted:"");
 	} else {
-	    lost_percent = 100.0 * irp->interval_cnt_error / irp->interval_packet_count;
+	    lost_percent = irp->interval_packet_count > 0 ? 100.0 * irp->interval_cnt_error / irp->interval_packet_count : 0.0;
 	    if (test->json_output)
 		cJSON_AddItemToArray(json_interval_streams, iperf_json_printf("socket: %d  start: %f  end: %f  seconds: %f  bytes: %d  bits_per_second: %f  jitter_ms: %f  lost_packets: %d  packets: %d  lost_percent: %f  omitted: %b", (int64_t) sp->socket, (double) st, (double) et, (double) irp->interval_duration, (int64_t) irp->bytes_transferred, bandwidth * 8, (double) irp->jitter * 1000.0, (int64_t) irp->interval_cnt_error, (int64_t) irp->interval_packet_count, (double) lost_percent, irp->omitted));
 	    else
 		iprintf(test, report_bw_udp_format, sp->socket, st, et, ubuf, nbuf, irp->jitter * 1000.0, irp->interval_cnt_error, irp->interval_packet_count, lost_percent, irp->omitted?report_omitted:"");
+	    print_socket_drops(test, sp->socket, test->json_output ? cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1) : NULL, st, et, irp->interval_socket_drops, irp->interval_cnt_error);
+	    print_delay_results(test, sp->socket, test->json_output ? cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1) : NULL, &irp->owd, &irp->ipdv);
+	    print_seqwin_results(test, sp->socket, test->json_output ? cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1) : NULL, &irp->seqwin);
 	}
     }
+
+    if (test->rate_schedule != NULL && test->json_output)
+	rate_schedule_json(test, cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1), irp->target_rate, irp->rate_step);
+    if (test->json_output) {
+	print_io_results(test, sp->socket, cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1), &irp->io);
+	print_sockmem_results(test, sp->socket, cJSON_GetArrayItem(json_interval_streams, cJSON_GetArraySize(json_interval_streams) - 1), &irp->sockmem);
+    } else if (test->verbose) {
+	print_io_results(test, sp->socket, NULL, &irp->io);
+	print_sockmem_results(test, sp->socket, NULL, &irp->sockmem);
+    }
+}
+
+/**************************************************************************/
+static void
+iperf_free_stream_histograms(struct iperf_stream *sp)
+{
+    iperf_histogram_free(sp->owd_hist);
+    iperf_histogram_free(sp->ipdv_hist);
+    iperf_histogram_free(sp->owd_hist_interval);
+    iperf_histogram_free(sp->ipdv_hist_interval);
+    iperf_seqwin_free(sp->seqwin);
 }
 
 /**************************************************************************/
 void
 iperf_free_stream(struct iperf_stream *sp)
 {
-    struct iperf_interval_results *irp, *nirp;
-
-    /* XXX: need to free interval list too! */
     munmap(sp->buffer, sp->test->settings->blksize);
     close(sp->buffer_fd);
     if (sp->diskfile_fd >= 0)
 	close(sp->diskfile_fd);
-    for (irp = TAILQ_FIRST(&sp->result->interval_results); irp != TAILQ_END(sp->result->interval_results); irp = nirp) {
-        nirp = TAILQ_NEXT(irp, irlistentries);
-        free(irp);
-    }
+    free(sp->result->rate_series);
     free(sp->result);
     if (sp->send_timer != NULL)
 	tmr_cancel(sp->send_timer);
+    iperf_free_stream_histograms(sp);
+    iperf_rr_detach(sp);
+    iperf_tcpsample_detach(sp);
+    iperf_sample_detach(sp);
     free(sp);
 }
 
@@ -2521,7 +4102,9 @@ iperf_new_stream(struct iperf_test *test, int s)
     }
 
     memset(sp->result, 0, sizeof(struct iperf_stream_result));
-    TAILQ_INIT(&sp->result->interval_results);
+    if (!(test->sender && test->protocol->id == Ptcp && has_tcpinfo()))
+	tcp_limits_unknown(&sp->result->stream_limits);
+    tcp_rcv_unknown(&sp->result->stream_rcv);
     
     /* Create and randomize the buffer */
     sp->buffer_fd = mkstemp(template);
@@ -2556,9 +4139,13 @@ iperf_new_stream(struct iperf_test *test, int s)
 
     /* Set socket */
     sp->socket = s;
+    sp->socket_drops = -1;
+    if (test->protocol->id == Pudp && !test->sender && iperf_udp_rxq_ovfl(s))
+	sp->socket_drops = 0;
 
     sp->snd = test->protocol->send;
     sp->rcv = test->protocol->recv;
+    sp->send_size = test->settings->blksize;
 
     if (test->diskfile_name != (char*) 0) {
 	sp->diskfile_fd = open(test->diskfile_name, test->sender ? O_RDONLY : (O_WRONLY|O_CREAT|O_TRUNC), S_IRUSR|S_IWUSR);
@@ -2576,8 +4163,51 @@ iperf_new_stream(struct iperf_test *test, int s)
     } else
         sp->diskfile_fd = -1;
 
+    if (test->profile != NULL && test->sender)
+	iperf_profile_attach(sp);
+
+    /*
+     * Delay distributions and sequence number accounting, measured by
+     * the receiver and sent to the sender
+     */
+    if (test->protocol->id == Pudp) {
+	sp->owd_hist = iperf_histogram_new();
+	sp->ipdv_hist = iperf_histogram_new();
+	sp->owd_hist_interval = iperf_histogram_new();
+	sp->ipdv_hist_interval = iperf_histogram_new();
+	sp->seqwin = iperf_seqwin_new();
+	if (sp->owd_hist == NULL || sp->ipdv_hist == NULL ||
+	    sp->owd_hist_interval == NULL || sp->ipdv_hist_interval == NULL ||
+	    sp->seqwin == NULL) {
+	    i_errno = IECREATESTREAM;
+	    iperf_free_stream_histograms(sp);
+	    close(sp->buffer_fd);
+	    munmap(sp->buffer, sp->test->settings->blksize);
+	    free(sp->result);
+	    free(sp);
+	    return NULL;
+	}
+    }
+
+    if ((test->rr != NULL && iperf_rr_attach(sp) < 0) ||
+	(test->tcpsample != NULL && iperf_tcpsample_attach(sp) < 0) ||
+	(test->sample != NULL && iperf_sample_attach(sp) < 0)) {
+	iperf_free_stream_histograms(sp);
+	iperf_rr_detach(sp);
+	iperf_tcpsample_detach(sp);
+	close(sp->buffer_fd);
+	munmap(sp->buffer, sp->test->settings->blksize);
+	free(sp->result);
+	free(sp);
+	return NULL;
+    }
+
     /* Initialize stream */
     if (iperf_init_stream(sp, test) < 0) {
+        iperf_free_stream_histograms(sp);
+        iperf_rr_detach(sp);
+        iperf_tcpsample_detach(sp);
+        iperf_sample_detach(sp);
         close(sp->buffer_fd);
         munmap(sp->buffer, sp->test->settings->blksize);
         free(sp->result);
@@ -2789,9 +4419,105 @@ iperf_json_start(struct iperf_test *test)
     return 0;
 }
 
+/*
+ * --json-stream: write {"event": event, "data": data} on a line of its
+ * own and free data.  Returns the line, which the caller has to free,
+ * or NULL.
+ */
+static char *
+json_stream_record(struct iperf_test *test, const char *event, cJSON *data)
+{
+    cJSON *j;
+    char *s;
+
+    if (data == NULL)
+	return NULL;
+    j = cJSON_CreateObject();
+    if (j == NULL) {
+	cJSON_Delete(data);
+	return NULL;
+    }
+    cJSON_AddStringToObject(j, "event", event);
+    if (test->title)
+	cJSON_AddStringToObject(j, "title", test->title);
+    cJSON_AddItemToObject(j, "data", data);
+    s = cJSON_PrintUnformatted(j);
+    cJSON_Delete(j);
+    if (s == NULL)
+	return NULL;
+    fprintf(test->outfile, "%s\n", s);
+    iflush(test);
+    return s;
+}
+
+static int
+iperf_json_stream_event(struct iperf_test *test, const char *event, cJSON *data)
+{
+    char *s;
+
+    s = json_stream_record(test, event, data);
+    if (s == NULL)
+	return -1;
+    free(s);
+    return 0;
+}
+
+/*
+ * --json-stream: write the start record, then one connected record per
+ * stream connected so far.  Later streams get theirs as they connect.
+ */
+static int
+iperf_json_stream_start(struct iperf_test *test)
+{
+    cJSON *j;
+
+    if (test->json_stream_started)
+	return 0;
+    test->json_stream_started = 1;
+    cJSON_DetachItemFromObject(test->json_start, "connected");
+    j = cJSON_DetachItemFromObject(test->json_top, "start");
+    if (iperf_json_stream_event(test, "start", j) < 0)
+	return -1;
+    while (cJSON_GetArraySize(test->json_connected) > 0)
+	if (iperf_json_stream_event(test, "connected", cJSON_DetachItemFromArray(test->json_connected, 0)) < 0)
+	    return -1;
+    /* Anything added to the start section now goes out with the next trial's. */
+    test->json_start = cJSON_CreateObject();
+    if (test->json_start == NULL)
+	return -1;
+    cJSON_AddItemToObject(test->json_top, "start", test->json_start);
+    cJSON_AddItemToObject(test->json_start, "connected", test->json_connected);
+    return 0;
+}
+
+/*
+ * --json-stream: write an error record as soon as it happens, so that
+ * it is not lost if the process goes away before the end record.
+ */
+int
+iperf_json_stream_error(struct iperf_test *test, const char *str)
+{
+    return iperf_json_stream_event(test, "error", cJSON_CreateString(str));
+}
+
 int
 iperf_json_finish(struct iperf_test *test)
 {
+    if (test->json_stream) {
+	iperf_json_stream_start(test);
+	if (test->json_server_output) {
+	    cJSON_AddItemToObject(test->json_end, "server_output_json", test->json_server_output);
+	    test->json_server_output = NULL;
+	}
+	if (test->server_output_text)
+	    cJSON_AddStringToObject(test->json_end, "server_output_text", test->server_output_text);
+	test->json_output_string = json_stream_record(test, "end", cJSON_DetachItemFromObject(test->json_top, "end"));
+	cJSON_Delete(test->json_top);
+	test->json_top = test->json_start = test->json_connected = test->json_intervals = test->json_end = NULL;
+	test->json_stream_started = 0;
+	return test->json_output_string == NULL ? -1 : 0;
+    }
+
     /* Include server output */
     if (test->json_server_output) {
 	cJSON_AddItemToObject(test->json_top, "server_output_json", test->json_server_output);
@@ -48,6 +48,21 @@ struct iperf_stream;
 #define OPT_GET_SERVER_OUTPUT 3
 #define OPT_UDP_COUNTERS_64BIT 4
 #define OPT_CLIENT_PORT 5
+#define OPT_TXTIME 6
+#define OPT_PROFILE 7
+#define OPT_SIZE_MIX 8
+#define OPT_TRACE 9
+#define OPT_RATE_SCHEDULE 10
+#define OPT_SEARCH 11
+#define OPT_RR 12
+#define OPT_CRR 13
+#define OPT_TCPINFO_SAMPLE 14
+#define OPT_PERF_COUNTERS 15
+#define OPT_JSON_STREAM 16
+#define OPT_BINLOG 17
+#define OPT_METRICS 18
+#define OPT_LIVE_STATS 19
+#define OPT_SAMPLE_INTERVAL 20
 
 /* states */
 #define TEST_START 1
@@ -66,6 +81,7 @@ struct iperf_stream;
 #define DISPLAY_RESULTS 14
 #define IPERF_START 15
 #define IPERF_DONE 16
+#define NEXT_TRIAL 17
 #define ACCESS_DENIED (-1)
 #define SERVER_ERROR (-2)
 
@@ -130,6 +146,12 @@ int      iperf_exchange_parameters(struct iperf_test * test);
  */
 void      add_to_interval_list(struct iperf_stream_result * rp, struct iperf_interval_results *temp);
 
+/**
+ * iperf_last_interval_results -- the latest interval added, or NULL
+ *
+ */
+struct iperf_interval_results *iperf_last_interval_results(struct iperf_stream_result * rp);
+
 /**
  * connect_msg -- displays connection message
  * denoting senfer/receiver details
@@ -195,11 +217,15 @@ void      iperf_free_stream(struct iperf_stream * sp);
 int has_tcpinfo(void);
 int has_tcpinfo_retransmits(void);
 void save_tcpinfo(struct iperf_stream *sp, struct iperf_interval_results *irp);
+void save_tcpinfo_limits(struct iperf_stream *sp, struct iperf_tcp_limits *l);
+void save_tcpinfo_rcv(struct iperf_stream *sp, struct iperf_tcp_rcv *r);
 long get_total_retransmits(struct iperf_interval_results *irp);
 long get_snd_cwnd(struct iperf_interval_results *irp);
 long get_rtt(struct iperf_interval_results *irp);
 void print_tcpinfo(struct iperf_test *test);
 void build_tcpinfo_message(struct iperf_interval_results *r, char *message);
+struct iperf_tcp_info_ext;
+int get_tcpinfo_ext(int fd, struct iperf_tcp_info_ext *ti);
 
 int iperf_set_send_state(struct iperf_test *test, signed char state);
 void iperf_check_throttle(struct iperf_stream *sp, struct timeval *nowP);
@@ -215,6 +241,7 @@ int iperf_init_test(struct iperf_test *);
 int iperf_create_send_timers(struct iperf_test *);
 int iperf_parse_arguments(struct iperf_test *, int, char **);
 void iperf_reset_test(struct iperf_test *);
+void iperf_reset_trial(struct iperf_test *);
 void iperf_reset_stats(struct iperf_test * test);
 
 struct protocol *get_protocol(struct iperf_test *, int);
@@ -246,6 +273,7 @@ int iperf_delete_pidfile(struct iperf_test *);
 /* JSON output routines. */
 int iperf_json_start(struct iperf_test *);
 int iperf_json_finish(struct iperf_test *);
+int iperf_json_stream_error(struct iperf_test *, const char *);
 
 /* CPU affinity routines */
 int iperf_setaffinity(struct iperf_test *, int affinity);
@@ -283,6 +311,19 @@ enum {
     IENOSCTP = 18,	    // No SCTP support available
     IEBIND = 19,			// Local port specified with no local bind option
     IEUDPBLOCKSIZE = 20,    // Block size too large. Maximum value = %dMAX_UDP_BLOCKSIZE
+    IETXTIME = 21,          // --txtime needs a UDP test with a target bandwidth
+    IEPROFILE = 22,         // Bad --profile spec, or no -b rate to shape
+    IESIZEMIX = 23,         // Bad --size-mix spec, or sizes don't fit -l
+    IETRACE = 24,           // --trace file couldn't be loaded, or used with -R (check perror)
+    IERATESCHEDULE = 25,    // Bad --rate-schedule spec, or used with a profile or --txtime
+    IESEARCH = 26,          // Bad --search spec, or not a UDP test
+    IERR = 27,              // Bad --rr spec, or not a plain TCP test
+    IECRR = 28,             // Bad --crr spec, too many connections, or not a plain TCP test
+    IETCPSAMPLE = 29,       // Bad --tcpinfo-sample spec or file, or not a TCP test
+    IEPERFEVENT = 30,       // Unable to open any perf_event counter (check perror)
+    IEBINLOG = 31,          // Unable to write the --binlog file (check perror)
+    IELIVESTATS = 32,       // Bad --live-stats spec, or unable to map the file (check perror)
+    IESAMPLE = 33,          // Bad --sample-interval period
     /* Test errors */
     IENEWTEST = 100,        // Unable to create a new test (check perror)
     IEINITTEST = 101,       // Test initialization failed (check perror)
@@ -322,6 +363,8 @@ enum {
     IEPIDFILE = 135,	    // Unable to write PID file
     IEV6ONLY = 136,  	    // Unable to set/unset IPV6_V6ONLY (check perror)
     IESETSCTPDISABLEFRAG = 137, // Unable to set SCTP Fragmentation (check perror)
+    IESETTXTIME = 138,      // Unable to set SO_TXTIME (check perror)
+    IEMETRICS = 139,        // Bad --metrics port, or unable to listen on it (check perror)
     /* Stream errors */
     IECREATESTREAM = 200,   // Unable to create a new stream (check herror/perror)
     IEINITSTREAM = 201,     // Unable to initialize stream (check herror/perror)
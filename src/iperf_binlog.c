@@ -0,0 +1,410 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_binlog.c
+ *
+ * Binary result log and its reader.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_util.h"
+#include "iperf_binlog.h"
+#include "portable_endian.h"
+
+#define F(name, width) { #name, offsetof(struct iperf_binlog_record, name), width }
+
+static const struct iperf_binlog_field test_fields[] = {
+    F(start_us, 8), F(streams, 4), F(flags, 4), F(protocol, 4), F(interval_us, 4),
+    { NULL, 0, 0 }
+};
+
+static const struct iperf_binlog_field stream_interval_fields[] = {
+    F(start_us, 8), F(duration_us, 4), F(streams, 4), F(flags, 4), F(bytes, 8),
+    F(packets, 4), F(lost, 4), F(retrans, 4), F(snd_cwnd, 4), F(rtt_us, 4),
+    F(jitter_us, 4),
+    { NULL, 0, 0 }
+};
+
+static const struct iperf_binlog_field interval_fields[] = {
+    F(start_us, 8), F(duration_us, 4), F(streams, 4), F(flags, 4), F(bytes, 8),
+    F(packets, 4), F(lost, 4), F(retrans, 4),
+    { NULL, 0, 0 }
+};
+
+static const struct iperf_binlog_field stream_summary_fields[] = {
+    F(duration_us, 8), F(streams, 4), F(flags, 4), F(bytes, 8), F(bytes_received, 8),
+    F(packets, 4), F(lost, 4), F(retrans, 4), F(snd_cwnd, 4), F(rtt_us, 4),
+    F(min_rtt_us, 4), F(max_rtt_us, 4), F(jitter_us, 4),
+    { NULL, 0, 0 }
+};
+
+static const struct iperf_binlog_field summary_fields[] = {
+    F(duration_us, 8), F(streams, 4), F(flags, 4), F(bytes, 8), F(bytes_received, 8),
+    F(packets, 4), F(lost, 4), F(retrans, 4),
+    { NULL, 0, 0 }
+};
+
+#undef F
+
+static const struct {
+    const char *name;
+    const struct iperf_binlog_field *fields;
+} binlog_types[BINLOG_TYPES] = {
+    { NULL, NULL },
+    { "test", test_fields },
+    { "stream_interval", stream_interval_fields },
+    { "interval", interval_fields },
+    { "stream_summary", stream_summary_fields },
+    { "summary", summary_fields },
+};
+
+const struct iperf_binlog_field *
+iperf_binlog_fields(int type)
+{
+    if (type <= 0 || type >= BINLOG_TYPES)
+	return NULL;
+    return binlog_types[type].fields;
+}
+
+const char *
+iperf_binlog_type_name(int type)
+{
+    if (type <= 0 || type >= BINLOG_TYPES)
+	return "unknown";
+    return binlog_types[type].name;
+}
+
+int
+iperf_binlog_encode(const struct iperf_binlog_record *r, unsigned char *buf)
+{
+    const struct iperf_binlog_field *f;
+    uint64_t v, q;
+    uint32_t w;
+    uint16_t h[2];
+    int len = 4;
+
+    if ((f = iperf_binlog_fields(r->type)) == NULL)
+	return -1;
+    for (; f->name != NULL; ++f) {
+	memcpy(&v, (const char *) r + f->offset, sizeof(v));
+	if (f->width == 8) {
+	    q = htobe64(v);
+	    memcpy(buf + len, &q, 8);
+	} else {
+	    w = htonl((uint32_t) v);
+	    memcpy(buf + len, &w, 4);
+	}
+	len += f->width;
+    }
+    h[0] = htons(r->type);
+    h[1] = htons(len);
+    memcpy(buf, h, 4);
+    return len;
+}
+
+int
+iperf_binlog_read_header(FILE *f)
+{
+    unsigned char hdr[16];
+    uint32_t version;
+
+    if (fread(hdr, sizeof(hdr), 1, f) != 1 || memcmp(hdr, BINLOG_MAGIC, 8) != 0)
+	return -1;
+    memcpy(&version, hdr + 8, 4);
+    return ntohl(version);
+}
+
+int
+iperf_binlog_read(FILE *f, struct iperf_binlog_record *r)
+{
+    const struct iperf_binlog_field *fp;
+    unsigned char buf[65536];
+    uint16_t h[2];
+    uint32_t w;
+    uint64_t v;
+    size_t n;
+    int len, off;
+
+    for (;;) {
+	n = fread(h, 1, 4, f);
+	if (n == 0)
+	    return 0;
+	if (n != 4)
+	    return -1;
+	/* Logs joined with cat carry the file header again. */
+	if (memcmp(h, BINLOG_MAGIC, 4) == 0) {
+	    if (fread(buf, 12, 1, f) != 1 || memcmp(buf, BINLOG_MAGIC + 4, 4) != 0)
+		return -1;
+	    continue;
+	}
+	break;
+    }
+    len = ntohs(h[1]);
+    if (len < 4 || (len > 4 && fread(buf, len - 4, 1, f) != 1))
+	return -1;
+    len -= 4;
+
+    memset(r, 0, sizeof(*r));
+    r->type = ntohs(h[0]);
+    if ((fp = iperf_binlog_fields(r->type)) == NULL)
+	return 1;
+    /* Fields missing from a shorter record stay 0. */
+    for (off = 0; fp->name != NULL && off + fp->width <= len; off += fp->width, ++fp) {
+	if (fp->width == 8) {
+	    memcpy(&v, buf + off, 8);
+	    v = be64toh(v);
+	} else {
+	    memcpy(&w, buf + off, 4);
+	    v = ntohl(w);
+	}
+	memcpy((char *) r + fp->offset, &v, sizeof(v));
+    }
+    return 1;
+}
+
+static uint64_t
+tv_to_us(const struct timeval *tv)
+{
+    return (uint64_t) tv->tv_sec * SEC_TO_US + tv->tv_usec;
+}
+
+static uint64_t
+test_flags(struct iperf_test *test)
+{
+    uint64_t flags = 0;
+
+    if (test->sender)
+	flags |= BINLOG_F_SENDER;
+    if (test->reverse)
+	flags |= BINLOG_F_REVERSE;
+    if (test->role == 's')
+	flags |= BINLOG_F_SERVER;
+    return flags;
+}
+
+static void
+binlog_write(struct iperf_test *test, struct iperf_binlog_record *r)
+{
+    unsigned char buf[BINLOG_MAX_RECORD];
+    int len;
+
+    if (test->binlog == NULL)
+	return;
+    len = iperf_binlog_encode(r, buf);
+    if (fwrite(buf, len, 1, test->binlog->file) != 1) {
+	iperf_err(test, "--binlog file write failed: %s", strerror(errno));
+	iperf_binlog_close(test);
+    }
+}
+
+int
+iperf_binlog_open(struct iperf_test *test, struct timeval *start)
+{
+    struct iperf_binlog *bl;
+    struct iperf_binlog_record r;
+    uint32_t words[2];
+
+    iperf_binlog_close(test);
+    bl = (struct iperf_binlog *) calloc(1, sizeof(struct iperf_binlog));
+    if (bl == NULL)
+	goto bad;
+    if ((bl->buf = malloc(BINLOG_BUFSIZE)) == NULL ||
+	(bl->file = fopen(test->binlog_name, "a")) == NULL ||
+	setvbuf(bl->file, bl->buf, _IOFBF, BINLOG_BUFSIZE) != 0)
+	goto bad;
+    test->binlog = bl;
+
+    /* Only a new file gets the file header. */
+    if (fseek(bl->file, 0, SEEK_END) < 0)
+	goto bad;
+    if (ftell(bl->file) == 0) {
+	words[0] = htonl(BINLOG_VERSION);
+	words[1] = 0;
+	if (fwrite(BINLOG_MAGIC, 8, 1, bl->file) != 1 ||
+	    fwrite(words, sizeof(words), 1, bl->file) != 1)
+	    goto bad;
+    }
+
+    bl->start_us = tv_to_us(start);
+    memset(&r, 0, sizeof(r));
+    r.type = BINLOG_TEST;
+    r.start_us = bl->start_us;
+    r.streams = test->num_streams;
+    r.flags = test_flags(test);
+    switch (test->protocol->id) {
+	case Ptcp: r.protocol = BINLOG_TCP; break;
+	case Pudp: r.protocol = BINLOG_UDP; break;
+	case Psctp: r.protocol = BINLOG_SCTP; break;
+    }
+    r.interval_us = test->stats_interval * SEC_TO_US;
+    binlog_write(test, &r);
+    /* A failed write has closed and freed it already. */
+    if (test->binlog == NULL) {
+	i_errno = IEBINLOG;
+	return -1;
+    }
+    bl->sum.type = BINLOG_INTERVAL;
+    return 0;
+
+  bad:
+    test->binlog = NULL;
+    if (bl != NULL) {
+	if (bl->file != NULL)
+	    fclose(bl->file);
+	free(bl->buf);
+	free(bl);
+    }
+    i_errno = IEBINLOG;
+    return -1;
+}
+
+void
+iperf_binlog_close(struct iperf_test *test)
+{
+    struct iperf_binlog *bl = test->binlog;
+
+    if (bl == NULL)
+	return;
+    test->binlog = NULL;
+    fclose(bl->file);
+    free(bl->buf);
+    free(bl);
+}
+
+void
+iperf_binlog_stream_interval(struct iperf_test *test, struct iperf_stream *sp, struct iperf_interval_results *irp)
+{
+    struct iperf_binlog *bl = test->binlog;
+    struct iperf_binlog_record r;
+
+    memset(&r, 0, sizeof(r));
+    r.type = BINLOG_STREAM_INTERVAL;
+    r.start_us = tv_to_us(&irp->interval_start_time) - bl->start_us;
+    r.duration_us = irp->interval_duration * SEC_TO_US;
+    r.streams = sp->id;
+    r.flags = test_flags(test) | (irp->omitted ? BINLOG_F_OMITTED : 0);
+    r.bytes = irp->bytes_transferred;
+    if (test->protocol->id == Pudp) {
+	r.packets = irp->interval_packet_count;
+	r.lost = irp->interval_cnt_error;
+	r.jitter_us = irp->jitter * SEC_TO_US;
+    } else if (test->protocol->id == Ptcp && test->sender && test->sender_has_retransmits) {
+	r.retrans = irp->interval_retrans;
+	r.snd_cwnd = irp->snd_cwnd;
+	r.rtt_us = irp->rtt;
+    }
+    binlog_write(test, &r);
+    /* The write may have given up on the file, and freed bl with it. */
+    if (test->binlog == NULL)
+	return;
+
+    if (bl->sum.streams++ == 0) {
+	bl->sum.start_us = r.start_us;
+	bl->sum.duration_us = r.duration_us;
+	bl->sum.flags = r.flags;
+    }
+    bl->sum.bytes += r.bytes;
+    bl->sum.packets += r.packets;
+    bl->sum.lost += r.lost;
+    bl->sum.retrans += r.retrans;
+}
+
+void
+iperf_binlog_interval(struct iperf_test *test)
+{
+    struct iperf_binlog *bl = test->binlog;
+
+    if (bl->sum.streams == 0)
+	return;
+    binlog_write(test, &bl->sum);
+    /* The write may have given up on the file. */
+    if (test->binlog != NULL) {
+	memset(&bl->sum, 0, sizeof(bl->sum));
+	bl->sum.type = BINLOG_INTERVAL;
+    }
+}
+
+void
+iperf_binlog_summary(struct iperf_test *test)
+{
+    struct iperf_stream *sp;
+    struct iperf_stream_result *rp;
+    struct iperf_binlog_record r, sum;
+
+    memset(&sum, 0, sizeof(sum));
+    sum.type = BINLOG_SUMMARY;
+    sum.flags = test_flags(test);
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	rp = sp->result;
+	memset(&r, 0, sizeof(r));
+	r.type = BINLOG_STREAM_SUMMARY;
+	r.duration_us = timeval_diff(&rp->start_time, &rp->end_time) * SEC_TO_US;
+	r.streams = sp->id;
+	r.flags = sum.flags;
+	r.bytes = rp->bytes_sent;
+	r.bytes_received = rp->bytes_received;
+	if (test->protocol->id == Pudp) {
+	    r.packets = sp->packet_count - sp->omitted_packet_count;
+	    r.lost = sp->cnt_error;
+	    r.jitter_us = sp->jitter * SEC_TO_US;
+	} else if (test->sender_has_retransmits) {
+	    r.retrans = rp->stream_retrans;
+	    r.snd_cwnd = rp->stream_max_snd_cwnd;
+	    r.rtt_us = rp->stream_count_rtt == 0 ? 0 : rp->stream_sum_rtt / rp->stream_count_rtt;
+	    r.min_rtt_us = rp->stream_min_rtt;
+	    r.max_rtt_us = rp->stream_max_rtt;
+	}
+	binlog_write(test, &r);
+
+	if (r.duration_us > sum.duration_us)
+	    sum.duration_us = r.duration_us;
+	++sum.streams;
+	sum.bytes += r.bytes;
+	sum.bytes_received += r.bytes_received;
+	sum.packets += r.packets;
+	sum.lost += r.lost;
+	sum.retrans += r.retrans;
+    }
+    binlog_write(test, &sum);
+    if (test->binlog != NULL && fflush(test->binlog->file) != 0) {
+	iperf_err(test, "--binlog file write failed: %s", strerror(errno));
+	iperf_binlog_close(test);
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_BINLOG_H
+#define __IPERF_BINLOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <sys/time.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+/*
+ * Binary result log (--binlog).
+ *
+ * Each interval's per-stream results and their sum, and at the end
+ * the per-stream and total summaries, are appended to a file as
+ * fixed-layout records, through a large stdio buffer so that the
+ * stats path costs a few stores per stream.  A server appends one test
+ * after another to the same file.  iperf3_logconv turns a log into
+ * JSON or CSV.
+ *
+ *   file:    "iperf3bl", version (32 bits), 0 (32 bits), then records
+ *   record:  type, length in bytes including these 4 (16 bits each),
+ *            then the fields of the type, 32 or 64 bits each
+ *
+ * all in network byte order.  A reader skips the rest of a record
+ * longer than it knows (a later version added fields at the end) and
+ * whole records of unknown types.  The fields of each type, in file
+ * order, are in binlog_fields[] in iperf_binlog.c; times are in us,
+ * start_us of a TEST record since the epoch and of the others since
+ * the test started.
+ */
+
+#define BINLOG_MAGIC "iperf3bl"
+#define BINLOG_VERSION 1
+#define BINLOG_BUFSIZE (256 * 1024)
+#define BINLOG_MAX_RECORD 256
+
+/* Record types. */
+#define BINLOG_TEST 1			/* a test started */
+#define BINLOG_STREAM_INTERVAL 2	/* one stream, one interval */
+#define BINLOG_INTERVAL 3		/* all streams, one interval */
+#define BINLOG_STREAM_SUMMARY 4		/* one stream, whole test */
+#define BINLOG_SUMMARY 5		/* all streams, whole test */
+#define BINLOG_TYPES 6
+
+/* protocol */
+#define BINLOG_TCP 1
+#define BINLOG_UDP 2
+#define BINLOG_SCTP 3
+
+/* flags */
+#define BINLOG_F_SENDER 0x1		/* this side sent the data */
+#define BINLOG_F_REVERSE 0x2		/* -R */
+#define BINLOG_F_SERVER 0x4		/* logged by the server */
+#define BINLOG_F_OMITTED 0x8		/* interval within --omit */
+
+/*
+ * A decoded record.  Each type uses some of the fields; the rest are 0.
+ */
+struct iperf_binlog_record
+{
+    int       type;
+    uint64_t  start_us;
+    uint64_t  duration_us;
+    uint64_t  streams;			/* stream id, or number of streams */
+    uint64_t  flags;
+    uint64_t  protocol;			/* BINLOG_TCP, BINLOG_UDP, BINLOG_SCTP */
+    uint64_t  interval_us;		/* -i */
+    uint64_t  bytes;			/* sent or received this interval, or sent */
+    uint64_t  bytes_received;		/* summaries only */
+    uint64_t  packets;			/* UDP */
+    uint64_t  lost;			/* UDP */
+    uint64_t  retrans;			/* TCP sender */
+    uint64_t  snd_cwnd;			/* bytes; the most in a summary */
+    uint64_t  rtt_us;			/* the mean in a summary */
+    uint64_t  min_rtt_us;
+    uint64_t  max_rtt_us;
+    uint64_t  jitter_us;		/* UDP */
+};
+
+struct iperf_binlog_field
+{
+    const char *name;
+    size_t    offset;			/* in struct iperf_binlog_record */
+    int       width;			/* bytes on file, 4 or 8 */
+};
+
+/* Per test. */
+struct iperf_binlog
+{
+    FILE     *file;
+    char     *buf;			/* its stdio buffer */
+    uint64_t  start_us;			/* test start, since the epoch */
+    struct iperf_binlog_record sum;	/* the interval being summed */
+};
+
+struct iperf_test;
+struct iperf_stream;
+struct iperf_interval_results;
+
+/**
+ * iperf_binlog_fields -- the fields of a record type, in file order
+ *
+ * returns NULL-name terminated array, or NULL for an unknown type
+ *
+ */
+const struct iperf_binlog_field *iperf_binlog_fields(int type);
+
+const char *iperf_binlog_type_name(int type);
+
+/**
+ * iperf_binlog_encode -- lay out a record as on file
+ *
+ * returns its length, at most BINLOG_MAX_RECORD, or -1 for an unknown type
+ *
+ */
+int iperf_binlog_encode(const struct iperf_binlog_record *r, unsigned char *buf);
+
+/**
+ * iperf_binlog_read_header / iperf_binlog_read -- read the file
+ * header, then one record at a time
+ *
+ * iperf_binlog_read_header returns the version, or -1 if f is not a
+ * log.  iperf_binlog_read returns 1 for a record, 0 at the end of the
+ * file and -1 for a truncated or garbled one.  Records of unknown types
+ * come back with only the type set.
+ *
+ */
+int iperf_binlog_read_header(FILE *f);
+int iperf_binlog_read(FILE *f, struct iperf_binlog_record *r);
+
+/**
+ * iperf_binlog_open -- append a TEST record for a test that started
+ * at start to test->binlog_name, starting the file if it is new
+ *
+ * returns 0, or -1 and sets i_errno to IEBINLOG
+ *
+ */
+int iperf_binlog_open(struct iperf_test *test, struct timeval *start);
+
+void iperf_binlog_close(struct iperf_test *test);
+
+/**
+ * iperf_binlog_stream_interval -- log a stream's new interval and add
+ * it to the sum; iperf_binlog_interval logs the sum once all streams
+ * are in
+ *
+ */
+void iperf_binlog_stream_interval(struct iperf_test *test, struct iperf_stream *sp, struct iperf_interval_results *irp);
+void iperf_binlog_interval(struct iperf_test *test);
+
+/**
+ * iperf_binlog_summary -- log the per-stream and total summaries and
+ * flush the file
+ *
+ */
+void iperf_binlog_summary(struct iperf_test *test);
+
+#endif
@@ -40,6 +40,9 @@
 #include "iperf_api.h"
 #include "iperf_util.h"
 #include "iperf_locale.h"
+#include "iperf_search.h"
+#include "iperf_rr.h"
+#include "iperf_tcpsample.h"
 #include "net.h"
 #include "timer.h"
 
@@ -57,10 +60,16 @@ iperf_create_streams(struct iperf_test *test)
         if ((s = test->protocol->connect(test)) < 0)
             return -1;
 
-	if (test->sender)
+	/* --crr: the stream stays idle; each transaction has its own connection. */
+	if (test->rr != NULL && test->rr->connect)
+	    ;
+	else if (test->sender)
 	    FD_SET(s, &test->write_set);
 	else
 	    FD_SET(s, &test->read_set);
+	/* --rr: the responses come back on the same stream. */
+	if (test->rr != NULL && !test->rr->connect)
+	    FD_SET(s, &test->read_set);
 	if (s > test->max_fd) test->max_fd = s;
 
         sp = iperf_new_stream(test, s);
@@ -140,6 +149,8 @@ create_client_timers(struct iperf_test * test)
             return -1;
 	}
     }
+    if (test->tcpsample != NULL && iperf_tcpsample_start(test) < 0)
+        return -1;
     return 0;
 }
 
@@ -186,6 +197,25 @@ create_client_omit_timer(struct iperf_test * test)
     return 0;
 }
 
+/*
+ * Start another --search trial: close this trial's streams and ask the
+ * server to go through the parameter exchange again.  The new -b rate
+ * has already been set.
+ */
+static int
+iperf_client_next_trial(struct iperf_test *test)
+{
+    struct iperf_stream *sp;
+
+    SLIST_FOREACH(sp, &test->streams, streams) {
+        close(sp->socket);
+    }
+    iperf_reset_trial(test);
+    if (iperf_set_send_state(test, NEXT_TRIAL) != 0)
+        return -1;
+    return 0;
+}
+
 int
 iperf_handle_message_client(struct iperf_test *test)
 {
@@ -207,7 +237,7 @@ iperf_handle_message_client(struct iperf_test *test)
         case PARAM_EXCHANGE:
             if (iperf_exchange_parameters(test) < 0)
                 return -1;
-            if (test->on_connect)
+            if (test->on_connect && test->trial == 0)
                 test->on_connect(test);
             break;
         case CREATE_STREAMS:
@@ -232,9 +262,16 @@ iperf_handle_message_client(struct iperf_test *test)
                 return -1;
             break;
         case DISPLAY_RESULTS:
+            if (test->search != NULL && iperf_search_next(test)) {
+                if (iperf_client_next_trial(test) < 0)
+                    return -1;
+                break;
+            }
             if (test->on_test_finish)
                 test->on_test_finish(test);
             iperf_client_end(test);
+            if (test->search != NULL)
+                iperf_search_report(test);
             break;
         case IPERF_DONE:
             break;
@@ -392,6 +429,9 @@ iperf_run_client(struct iperf_test * test)
 		    return -1;
 		}
 		FD_CLR(test->ctrl_sck, &read_set);
+		/* Each --search trial brings new streams. */
+		if (test->state == TEST_START)
+		    startup = 1;
 	    }
 	}
 
@@ -417,6 +457,10 @@ iperf_run_client(struct iperf_test * test)
 		// Regular mode. Client sends.
 		if (iperf_send(test, &write_set) < 0)
 		    return -1;
+		if (test->rr != NULL && test->rr->connect)
+		    iperf_crr_run(test, &read_set, &write_set);
+		else if (test->rr != NULL && iperf_rr_recv(test, &read_set) < 0)
+		    return -1;
 	    }
 
             /* Run the timers. */
@@ -433,9 +477,17 @@ iperf_run_client(struct iperf_test * test)
 		if (test->protocol->id != Pudp) {
 		    SLIST_FOREACH(sp, &test->streams, streams) {
 			setnonblocking(sp->socket, 0);
+			/* Leave any late --rr responses unread. */
+			if (test->rr != NULL)
+			    FD_CLR(sp->socket, &test->read_set);
 		    }
 		}
 
+		if (test->rr != NULL && test->rr->connect)
+		    iperf_crr_stop(test);
+		if (test->tcpsample != NULL)
+		    iperf_tcpsample_stop(test);
+
 		/* Yes, done!  Send TEST_END. */
 		test->done = 1;
 		cpu_util(test->cpu_util);
@@ -32,6 +32,10 @@
 #include <stdarg.h>
 #include "iperf.h"
 #include "iperf_api.h"
+#include "iperf_rr.h"
+#include "iperf_tcpsample.h"
+#include "iperf_live.h"
+#include "iperf_sample.h"
 
 /* Do a printf to stderr. */
 void
@@ -42,7 +46,9 @@ iperf_err(struct iperf_test *test, const char *format, ...)
 
     va_start(argp, format);
     vsnprintf(str, sizeof(str), format, argp);
-    if (test != NULL && test->json_output && test->json_top != NULL)
+    if (test != NULL && test->json_stream && test->json_top != NULL)
+	iperf_json_stream_error(test, str);
+    else if (test != NULL && test->json_output && test->json_top != NULL)
 	cJSON_AddStringToObject(test->json_top, "error", str);
     else
 	if (test && test->outfile) {
@@ -64,7 +70,10 @@ iperf_errexit(struct iperf_test *test, const char *format, ...)
     va_start(argp, format);
     vsnprintf(str, sizeof(str), format, argp);
     if (test != NULL && test->json_output && test->json_top != NULL) {
-	cJSON_AddStringToObject(test->json_top, "error", str);
+	if (test->json_stream)
+	    iperf_json_stream_error(test, str);
+	else
+	    cJSON_AddStringToObject(test->json_top, "error", str);
 	iperf_json_finish(test);
     } else
 	if (test && test->outfile) {
@@ -127,6 +136,50 @@ iperf_strerror(int i_errno)
         case IEUDPBLOCKSIZE:
             snprintf(errstr, len, "block size too large (maximum = %d bytes)", MAX_UDP_BLOCKSIZE);
             break;
+        case IETXTIME:
+            snprintf(errstr, len, "--txtime requires a UDP test with a non-zero target bandwidth and a block size of at least %d bytes", UDP_TXTIME_MIN_BLKSIZE);
+            break;
+        case IEPROFILE:
+            snprintf(errstr, len, "invalid --profile (expected cbr, poisson[:burst] or onoff:period_ms:duty[:burst]); a profile needs a non-zero -b rate without a -b burst, and cannot be combined with --txtime or -F");
+            break;
+        case IESIZEMIX:
+            snprintf(errstr, len, "invalid --size-mix (expected imix or size:weight[,size:weight...]); sizes must fit the block size and the UDP header, and cannot be combined with --txtime or -F");
+            break;
+        case IETRACE:
+            snprintf(errstr, len, "unable to replay --trace file (it must be a CSV, binary or pcap trace sent by the client, without -R)");
+            perr = 1;
+            break;
+        case IERATESCHEDULE:
+            snprintf(errstr, len, "invalid --rate-schedule (expected step:start:stop:incr:secs or ramp:start:stop[:secs], and a -t duration for a ramp without secs); a schedule replaces -b and cannot be combined with --profile, --trace or --txtime");
+            break;
+        case IESEARCH:
+            snprintf(errstr, len, "invalid --search (expected min:max[:loss_percent[:resolution]]); a search needs a UDP test and cannot be combined with --rate-schedule or --trace");
+            break;
+        case IERR:
+            snprintf(errstr, len, "invalid --rr (expected request[:response[:depth]], sizes up to the block size, depth up to %d); transactions need a TCP test and cannot be combined with -R, -b, -F, -Z, --profile, --rate-schedule or --search", RR_MAX_DEPTH);
+            break;
+        case IECRR:
+            snprintf(errstr, len, "invalid --crr (expected request[:response[:connections]], sizes up to the block size, at most %d connections in all); needs a timed TCP test without -R, -b, -F, -Z, --profile, --rate-schedule or --search", CRR_MAX_CONNS);
+            break;
+        case IETCPSAMPLE:
+            snprintf(errstr, len, "invalid --tcpinfo-sample (expected period_ms[,file], %g to %g ms) or unable to write the file; sampling needs a TCP test other than --crr, and a file unless -J is given", TCPSAMPLE_MIN_PERIOD / 1000.0, TCPSAMPLE_MAX_PERIOD / 1000.0);
+            perr = 1;
+            break;
+        case IEBINLOG:
+            snprintf(errstr, len, "unable to write the --binlog file");
+            perr = 1;
+            break;
+        case IESAMPLE:
+            snprintf(errstr, len, "invalid --sample-interval (min = %g, max = %g ms)", SAMPLE_MIN_PERIOD / 1000.0, SAMPLE_MAX_PERIOD / 1000.0);
+            break;
+        case IELIVESTATS:
+            snprintf(errstr, len, "invalid --live-stats (expected file[,period_ms], %g to %g ms) or unable to map the file", LIVE_MIN_PERIOD / 1000.0, LIVE_MAX_PERIOD / 1000.0);
+            perr = 1;
+            break;
+        case IEPERFEVENT:
+            snprintf(errstr, len, "unable to open perf_event counters for --perf-counters (see /proc/sys/kernel/perf_event_paranoid)");
+            perr = 1;
+            break;
         case IEMSS:
             snprintf(errstr, len, "TCP MSS too large (maximum = %d bytes)", MAX_MSS);
             break;
@@ -347,6 +400,14 @@ iperf_strerror(int i_errno)
             snprintf(errstr, len, "unable to set SCTP_DISABLE_FRAGMENTS");
             perr = 1;
             break;
+        case IESETTXTIME:
+            snprintf(errstr, len, "unable to set SO_TXTIME");
+            perr = 1;
+            break;
+        case IEMETRICS:
+            snprintf(errstr, len, "invalid --metrics port, or unable to listen on it");
+            perr = 1;
+            break;
     }
 
     if (herr || perr)
@@ -0,0 +1,129 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_fairness.c
+ *
+ * Fairness and skew statistics for parallel streams.
+ */
+#include "iperf_config.h"
+
+#include <math.h>
+
+#include "iperf_fairness.h"
+
+void
+iperf_fairness_compute(const double *x, int n, struct iperf_fairness *f)
+{
+    double sum = 0, sum2 = 0, var;
+    int i;
+
+    f->n = n;
+    f->jain = f->min = f->max = f->mean = f->stddev = 0;
+    if (n <= 0)
+	return;
+    f->min = f->max = x[0];
+    for (i = 0; i < n; ++i) {
+	sum += x[i];
+	sum2 += x[i] * x[i];
+	if (x[i] < f->min)
+	    f->min = x[i];
+	if (x[i] > f->max)
+	    f->max = x[i];
+    }
+    f->mean = sum / n;
+    if (sum2 > 0)
+	f->jain = sum * sum / (n * sum2);
+    var = sum2 / n - f->mean * f->mean;
+    f->stddev = var > 0 ? sqrt(var) : 0;
+}
+
+double
+iperf_fairness_steady(const double *rates, int n, double tolerance, int *index)
+{
+    double share = 0;
+    int i;
+
+    *index = -1;
+    if (n <= 0)
+	return 0;
+    for (i = n / 2; i < n; ++i)
+	share += rates[i];
+    share /= n - n / 2;
+    if (share <= 0)
+	return 0;
+    for (i = n; i > 0; --i)
+	if (fabs(rates[i - 1] - share) > tolerance * share)
+	    break;
+    if (i < n)
+	*index = i;
+    return share;
+}
+
+void
+iperf_fairness_series_reset(struct iperf_fairness_series *s)
+{
+    s->n = 0;
+    s->span = 1;
+    s->pending = 0;
+}
+
+void
+iperf_fairness_series_add(struct iperf_fairness_series *s, double start, double bytes, double seconds)
+{
+    int i;
+
+    if (s->pending == 0) {
+	s->bytes[s->n] = s->seconds[s->n] = 0;
+	s->start[s->n] = start;
+    }
+    s->bytes[s->n] += bytes;
+    s->seconds[s->n] += seconds;
+    if (++s->pending < s->span)
+	return;
+    s->pending = 0;
+    if (++s->n < FAIRNESS_SERIES_MAX)
+	return;
+    for (i = 0; i < FAIRNESS_SERIES_MAX / 2; ++i) {
+	s->bytes[i] = s->bytes[2 * i] + s->bytes[2 * i + 1];
+	s->seconds[i] = s->seconds[2 * i] + s->seconds[2 * i + 1];
+	s->start[i] = s->start[2 * i];
+    }
+    s->n = FAIRNESS_SERIES_MAX / 2;
+    s->span *= 2;
+}
+
+double
+iperf_fairness_series_steady(const struct iperf_fairness_series *s, double tolerance, int *index)
+{
+    double rates[FAIRNESS_SERIES_MAX + 1];
+    int i, n;
+
+    /* A partly filled last bucket still counts. */
+    n = s->n + (s->pending > 0);
+    for (i = 0; i < n; ++i)
+	rates[i] = s->seconds[i] > 0 ? s->bytes[i] / s->seconds[i] : 0;
+    return iperf_fairness_steady(rates, n, tolerance, index);
+}
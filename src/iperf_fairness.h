@@ -0,0 +1,110 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_FAIRNESS_H
+#define __IPERF_FAIRNESS_H
+
+/*
+ * How evenly parallel streams share the path.
+ *
+ * Jain's fairness index is (sum x)^2 / (n * sum x^2): 1 when all n
+ * streams get the same throughput, 1/n when one stream gets all of it.
+ */
+
+/* A stream is in its steady state while within 20% of its share. */
+#define FAIRNESS_STEADY_TOLERANCE 0.2
+
+/* Most buckets an interval rate series keeps. */
+#define FAIRNESS_SERIES_MAX 512
+
+struct iperf_fairness
+{
+    int       n;
+    double    jain;			/* 0 if nothing was transferred */
+    double    min;
+    double    max;
+    double    mean;
+    double    stddev;			/* population standard deviation */
+};
+
+/**
+ * iperf_fairness_compute -- Jain's index and the spread of the n
+ * values in x
+ *
+ */
+void iperf_fairness_compute(const double *x, int n, struct iperf_fairness *f);
+
+/**
+ * iperf_fairness_steady -- when a stream settled into its share
+ *
+ * The share is the mean of the second half of the n interval rates.
+ * *index is set to the first interval from which every rate stays
+ * within tolerance of the share, or -1 if even the last one does not.
+ * Returns the share.
+ *
+ */
+double iperf_fairness_steady(const double *rates, int n, double tolerance, int *index);
+
+/*
+ * A stream's interval rates, for finding its steady state at the end
+ * of the test, in bounded memory.  Each bucket holds span consecutive
+ * intervals; when all FAIRNESS_SERIES_MAX buckets are full, adjacent
+ * pairs are merged and span doubles.
+ */
+struct iperf_fairness_series
+{
+    int       n;			/* buckets filled */
+    int       span;			/* intervals per bucket */
+    int       pending;			/* intervals in bucket n so far */
+    double    bytes[FAIRNESS_SERIES_MAX + 1];
+    double    seconds[FAIRNESS_SERIES_MAX + 1];
+    double    start[FAIRNESS_SERIES_MAX + 1];	/* of the first interval */
+};
+
+/**
+ * iperf_fairness_series_reset -- empty a series
+ *
+ */
+void iperf_fairness_series_reset(struct iperf_fairness_series *s);
+
+/**
+ * iperf_fairness_series_add -- add an interval that started at start
+ * and moved bytes in seconds
+ *
+ */
+void iperf_fairness_series_add(struct iperf_fairness_series *s, double start, double bytes, double seconds);
+
+/**
+ * iperf_fairness_series_steady -- iperf_fairness_steady over the
+ * buckets of a series
+ *
+ * *index is set to the first bucket of the steady state, or -1.
+ * Returns the share.
+ *
+ */
+double iperf_fairness_series_steady(const struct iperf_fairness_series *s, double tolerance, int *index);
+
+#endif
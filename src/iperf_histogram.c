@@ -0,0 +1,229 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_histogram.c
+ *
+ * Log-linear latency histograms for the UDP delay and delay variation
+ * distributions.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf_histogram.h"
+#include "iperf_util.h"
+
+/* Bucket index of a non-negative value. */
+static int
+hist_index(uint64_t v)
+{
+    int msb, shift;
+
+    if (v < HIST_SUB_COUNT)
+	return (int) v;
+#if defined(__GNUC__)
+    msb = 63 - __builtin_clzll(v);
+#else
+    for (msb = HIST_SUB_BITS; (v >> msb) > 1; ++msb)
+	;
+#endif
+    shift = msb - HIST_SUB_BITS;
+    if (shift > HIST_MAX_SHIFT)
+	return HIST_BUCKETS - 1;
+    return (shift + 1) * HIST_SUB_COUNT + (int) (v >> shift) - HIST_SUB_COUNT;
+}
+
+/* Lowest value that falls in a bucket, and the bucket's width. */
+static void
+hist_bucket_range(int i, int64_t *lo, int64_t *width)
+{
+    int shift;
+
+    if (i < HIST_SUB_COUNT) {
+	*lo = i;
+	*width = 1;
+	return;
+    }
+    shift = i / HIST_SUB_COUNT - 1;
+    *lo = (int64_t) (i % HIST_SUB_COUNT + HIST_SUB_COUNT) << shift;
+    *width = (int64_t) 1 << shift;
+}
+
+struct iperf_histogram *
+iperf_histogram_new(void)
+{
+    struct iperf_histogram *h;
+
+    h = (struct iperf_histogram *) malloc(sizeof(struct iperf_histogram));
+    if (h != NULL)
+	iperf_histogram_reset(h);
+    return h;
+}
+
+void
+iperf_histogram_free(struct iperf_histogram *h)
+{
+    free(h);
+}
+
+void
+iperf_histogram_reset(struct iperf_histogram *h)
+{
+    memset(h, 0, sizeof(struct iperf_histogram));
+}
+
+void
+iperf_histogram_record(struct iperf_histogram *h, int64_t ns)
+{
+    if (ns < 0)
+	ns = 0;
+    if (h->count == 0 || ns < h->min)
+	h->min = ns;
+    if (h->count == 0 || ns > h->max)
+	h->max = ns;
+    ++h->count;
+    ++h->buckets[hist_index((uint64_t) ns)];
+}
+
+void
+iperf_histogram_merge(struct iperf_histogram *dst, struct iperf_histogram *src)
+{
+    int i;
+
+    if (src->count == 0)
+	return;
+    if (dst->count == 0 || src->min < dst->min)
+	dst->min = src->min;
+    if (dst->count == 0 || src->max > dst->max)
+	dst->max = src->max;
+    dst->count += src->count;
+    for (i = 0; i < HIST_BUCKETS; ++i)
+	dst->buckets[i] += src->buckets[i];
+}
+
+int64_t
+iperf_histogram_percentile(struct iperf_histogram *h, double p)
+{
+    uint64_t rank, seen;
+    int64_t lo, width, v;
+    int i;
+
+    if (h->count == 0)
+	return 0;
+    if (p >= 100)
+	return h->max;
+    rank = (uint64_t) ceil(p / 100 * h->count - 1e-9);
+    if (rank == 0)
+	rank = 1;
+    seen = 0;
+    for (i = 0; i < HIST_BUCKETS; ++i) {
+	seen += h->buckets[i];
+	if (seen >= rank)
+	    break;
+    }
+    /* Report the middle of the bucket, but never outside what was seen. */
+    hist_bucket_range(i, &lo, &width);
+    v = lo + (width - 1) / 2;
+    if (v < h->min)
+	v = h->min;
+    if (v > h->max)
+	v = h->max;
+    return v;
+}
+
+void
+iperf_histogram_summarize(struct iperf_histogram *h, struct iperf_histogram_summary *s)
+{
+    s->count = h->count;
+    s->p50 = iperf_histogram_percentile(h, 50) / 1e9;
+    s->p90 = iperf_histogram_percentile(h, 90) / 1e9;
+    s->p99 = iperf_histogram_percentile(h, 99) / 1e9;
+    s->p999 = iperf_histogram_percentile(h, 99.9) / 1e9;
+    s->max = h->max / 1e9;
+}
+
+cJSON *
+iperf_histogram_to_json(struct iperf_histogram *h)
+{
+    cJSON *j, *j_buckets;
+    int i;
+
+    j = iperf_json_printf("count: %d  min: %d  max: %d", (int64_t) h->count, h->min, h->max);
+    if (j == NULL)
+	return NULL;
+    j_buckets = cJSON_CreateArray();
+    if (j_buckets == NULL) {
+	cJSON_Delete(j);
+	return NULL;
+    }
+    for (i = 0; i < HIST_BUCKETS; ++i)
+	if (h->buckets[i] != 0) {
+	    cJSON_AddItemToArray(j_buckets, cJSON_CreateInt(i));
+	    cJSON_AddItemToArray(j_buckets, cJSON_CreateInt((int64_t) h->buckets[i]));
+	}
+    cJSON_AddItemToObject(j, "buckets", j_buckets);
+    return j;
+}
+
+int
+iperf_histogram_from_json(struct iperf_histogram *h, cJSON *j)
+{
+    cJSON *j_count, *j_min, *j_max, *j_buckets, *j_item;
+    int64_t i;
+
+    j_count = cJSON_GetObjectItem(j, "count");
+    j_min = cJSON_GetObjectItem(j, "min");
+    j_max = cJSON_GetObjectItem(j, "max");
+    j_buckets = cJSON_GetObjectItem(j, "buckets");
+    if (j_count == NULL || j_min == NULL || j_max == NULL || j_buckets == NULL)
+	return -1;
+
+    iperf_histogram_reset(h);
+    h->count = j_count->valueint;
+    h->min = j_min->valueint;
+    h->max = j_max->valueint;
+    for (j_item = j_buckets->child; j_item != NULL && j_item->next != NULL; j_item = j_item->next->next) {
+	i = j_item->valueint;
+	if (i < 0 || i >= HIST_BUCKETS) {
+	    iperf_histogram_reset(h);
+	    return -1;
+	}
+	h->buckets[i] = j_item->next->valueint;
+    }
+    return 0;
+}
+
+cJSON *
+iperf_histogram_summary_json(struct iperf_histogram_summary *s)
+{
+    return iperf_json_printf("count: %d  p50: %f  p90: %f  p99: %f  p99_9: %f  max: %f", (int64_t) s->count, s->p50 * 1000.0, s->p90 * 1000.0, s->p99 * 1000.0, s->p999 * 1000.0, s->max * 1000.0);
+}
@@ -0,0 +1,116 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_HISTOGRAM_H
+#define __IPERF_HISTOGRAM_H
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "cjson.h"
+
+/*
+ * Log-linear latency histograms, in the style of HdrHistogram.
+ *
+ * Values are nanoseconds.  Below 2^HIST_SUB_BITS every value has its
+ * own bucket; above that each power of two is split into
+ * 2^HIST_SUB_BITS equal buckets, so any value is known to within about
+ * 3% and a histogram has a fixed, small size however long the test
+ * runs.  Values past the top bucket are counted in it.
+ */
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_SHIFT 36		/* top bucket starts at about 36 minutes */
+#define HIST_BUCKETS ((HIST_MAX_SHIFT + 2) * HIST_SUB_COUNT)
+
+struct iperf_histogram
+{
+    uint64_t  count;
+    int64_t   min;			/* exact extremes, ns */
+    int64_t   max;
+    uint64_t  buckets[HIST_BUCKETS];
+};
+
+/* The percentiles that get reported, in seconds. */
+struct iperf_histogram_summary
+{
+    uint64_t  count;
+    double    p50;
+    double    p90;
+    double    p99;
+    double    p999;
+    double    max;
+};
+
+struct iperf_histogram *iperf_histogram_new(void);
+
+void iperf_histogram_free(struct iperf_histogram *);
+
+void iperf_histogram_reset(struct iperf_histogram *);
+
+/**
+ * iperf_histogram_record -- count one value; negative values count as 0
+ *
+ */
+void iperf_histogram_record(struct iperf_histogram *, int64_t ns);
+
+/**
+ * iperf_histogram_merge -- add the counts of src into dst
+ *
+ */
+void iperf_histogram_merge(struct iperf_histogram *dst, struct iperf_histogram *src);
+
+/**
+ * iperf_histogram_percentile -- the value below which p percent of
+ * the recorded values fall, in ns (0 if the histogram is empty)
+ *
+ */
+int64_t iperf_histogram_percentile(struct iperf_histogram *, double p);
+
+void iperf_histogram_summarize(struct iperf_histogram *, struct iperf_histogram_summary *);
+
+/**
+ * iperf_histogram_to_json / iperf_histogram_from_json -- sparse form
+ * for the results exchange:
+ *   {"count": n, "min": ns, "max": ns, "buckets": [index, count, ...]}
+ *
+ * iperf_histogram_from_json returns 0 on success, -1 if the object is
+ * malformed
+ *
+ */
+cJSON *iperf_histogram_to_json(struct iperf_histogram *);
+
+int iperf_histogram_from_json(struct iperf_histogram *, cJSON *);
+
+/**
+ * iperf_histogram_summary_json -- percentiles in milliseconds, for
+ * the JSON output
+ *
+ */
+cJSON *iperf_histogram_summary_json(struct iperf_histogram_summary *);
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_live.c
+ *
+ * Live counters in a shared memory-mapped file.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_live.h"
+#include "tcp_info_ext.h"
+
+#define LIVE_READ_TRIES 1000
+
+struct iperf_live *
+iperf_live_parse(const char *spec)
+{
+    struct iperf_live *lv;
+    char buf[LIVE_MAX_SPEC];
+    char *period, *end;
+    double ms;
+
+    lv = (struct iperf_live *) calloc(1, sizeof(struct iperf_live));
+    if (lv == NULL) {
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    lv->period = LIVE_DEFAULT_PERIOD;
+    period = strrchr(buf, ',');
+    if (period != NULL) {
+	*period++ = '\0';
+	ms = strtod(period, &end);
+	if (end == period || *end != '\0' ||
+	    ms * 1000 < LIVE_MIN_PERIOD || ms * 1000 > LIVE_MAX_PERIOD)
+	    goto bad;
+	lv->period = ms * 1000;
+    }
+    if (buf[0] == '\0')
+	goto bad;
+    if ((lv->file_name = strdup(buf)) == NULL) {
+	free(lv);
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    strcpy(lv->spec, spec);
+    return lv;
+
+  bad:
+    free(lv);
+    errno = EINVAL;
+    i_errno = IELIVESTATS;
+    return NULL;
+}
+
+static int
+live_map(struct iperf_live *lv)
+{
+    struct iperf_live_header *h;
+    void *p;
+    int fd;
+
+    fd = open(lv->file_name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+	return -1;
+    if (ftruncate(fd, LIVE_FILE_SIZE) < 0) {
+	close(fd);
+	return -1;
+    }
+    p = mmap(NULL, LIVE_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+	return -1;
+
+    /* Whatever an earlier run left behind goes; the magic goes in last. */
+    h = (struct iperf_live_header *) p;
+    memset(h->magic, 0, sizeof(h->magic));
+    __sync_synchronize();
+    memset((char *) p + sizeof(h->magic), 0, LIVE_FILE_SIZE - sizeof(h->magic));
+    h->version = LIVE_VERSION;
+    h->header_size = sizeof(struct iperf_live_header);
+    h->stream_size = sizeof(struct iperf_live_stream);
+    h->max_streams = LIVE_MAX_STREAMS;
+    h->pid = getpid();
+    __sync_synchronize();
+    memcpy(h->magic, LIVE_MAGIC, sizeof(h->magic));
+    lv->map = h;
+    return 0;
+}
+
+static uint64_t
+live_us(const struct timeval *tv)
+{
+    return (uint64_t) tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+static void
+live_timer_proc(TimerClientData client_data, struct timeval *nowP)
+{
+    iperf_live_publish((struct iperf_test *) client_data.p);
+}
+
+int
+iperf_live_start(struct iperf_test *test)
+{
+    struct iperf_live *lv = test->live;
+    struct iperf_live_header *h;
+    struct timeval now;
+    TimerClientData cd;
+
+    if (lv->map == NULL && live_map(lv) < 0) {
+	i_errno = IELIVESTATS;
+	return -1;
+    }
+    if (lv->timer != NULL) {
+	tmr_cancel(lv->timer);
+	lv->timer = NULL;
+    }
+    gettimeofday(&now, NULL);
+    h = lv->map;
+    iperf_live_write_begin(h);
+    h->generation++;
+    h->start_us = live_us(&now);
+    memset(h + 1, 0, LIVE_MAX_STREAMS * sizeof(struct iperf_live_stream));
+    iperf_live_write_end(h);
+
+    cd.p = test;
+    lv->timer = tmr_create(&now, live_timer_proc, cd, lv->period, 1);
+    if (lv->timer == NULL) {
+	i_errno = IEINITTEST;
+	return -1;
+    }
+    iperf_live_publish(test);
+    return 0;
+}
+
+void
+iperf_live_stop(struct iperf_test *test)
+{
+    struct iperf_live *lv = test->live;
+
+    if (lv == NULL)
+	return;
+    if (lv->timer != NULL) {
+	tmr_cancel(lv->timer);
+	lv->timer = NULL;
+    }
+    if (lv->map != NULL)
+	iperf_live_publish(test);
+}
+
+void
+iperf_live_free(struct iperf_test *test)
+{
+    struct iperf_live *lv = test->live;
+
+    if (lv == NULL)
+	return;
+    if (lv->timer != NULL)
+	tmr_cancel(lv->timer);
+    if (lv->map != NULL)
+	munmap(lv->map, LIVE_FILE_SIZE);
+    free(lv->file_name);
+    free(lv);
+    test->live = NULL;
+}
+
+void
+iperf_live_publish(struct iperf_test *test)
+{
+    struct iperf_live_header *h = test->live->map;
+    struct iperf_live_stream *ls;
+    struct iperf_stream *sp;
+    struct iperf_tcp_info_ext ti;
+    struct timeval now;
+    uint32_t n;
+
+    if (h == NULL)
+	return;
+    gettimeofday(&now, NULL);
+    ls = (struct iperf_live_stream *) (h + 1);
+
+    iperf_live_write_begin(h);
+    h->update_us = live_us(&now);
+    h->state = test->state;
+    h->role = test->role;
+    switch (test->protocol->id) {
+	case Ptcp: h->protocol = LIVE_TCP; break;
+	case Pudp: h->protocol = LIVE_UDP; break;
+	case Psctp: h->protocol = LIVE_SCTP; break;
+	default: h->protocol = 0; break;
+    }
+    h->flags = (test->sender ? LIVE_F_SENDER : 0) |
+	(test->reverse ? LIVE_F_REVERSE : 0) |
+	(test->omitting ? LIVE_F_OMITTING : 0);
+    h->num_streams = test->num_streams;
+    h->bytes = h->packets = h->lost = h->retrans = 0;
+
+    n = 0;
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	if (n == LIVE_MAX_STREAMS)
+	    break;
+	/* A closed socket keeps the TCP numbers it had. */
+	if (ls->id != sp->id) {
+	    memset(ls, 0, sizeof(*ls));
+	    ls->id = sp->id;
+	}
+	ls->socket = sp->socket;
+	if (sp->result != NULL)
+	    ls->bytes = test->sender ? sp->result->bytes_sent : sp->result->bytes_received;
+	ls->packets = sp->packet_count;
+	ls->lost = sp->cnt_error;
+	ls->jitter_us = sp->jitter * 1000000;
+	if (test->protocol->id == Ptcp && test->sender &&
+	    get_tcpinfo_ext(sp->socket, &ti) >= 0) {
+	    ls->retrans = ti.tcpi_total_retrans;
+	    ls->snd_cwnd = ti.tcpi_snd_cwnd * ti.tcpi_snd_mss;
+	    ls->rtt_us = ti.tcpi_rtt;
+	}
+	h->bytes += ls->bytes;
+	h->packets += ls->packets;
+	h->lost += ls->lost;
+	h->retrans += ls->retrans;
+	++ls;
+	++n;
+    }
+    h->streams = n;
+    iperf_live_write_end(h);
+}
+
+void
+iperf_live_write_begin(struct iperf_live_header *h)
+{
+    h->seq++;
+    __sync_synchronize();
+}
+
+void
+iperf_live_write_end(struct iperf_live_header *h)
+{
+    __sync_synchronize();
+    h->seq++;
+}
+
+int
+iperf_live_read(const struct iperf_live_header *h, void *buf, size_t len)
+{
+    uint32_t seq;
+    int i;
+
+    for (i = 0; i < LIVE_READ_TRIES; ++i) {
+	seq = h->seq;
+	if (seq & 1)
+	    continue;
+	__sync_synchronize();
+	memcpy(buf, (const void *) h, len);
+	__sync_synchronize();
+	if (h->seq == seq)
+	    return 0;
+    }
+    return -1;
+}
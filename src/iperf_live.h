@@ -0,0 +1,170 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_LIVE_H
+#define __IPERF_LIVE_H
+
+#include <stddef.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "timer.h"
+
+/*
+ * Live counters in a shared memory-mapped file (--live-stats).
+ *
+ * Every period the I/O thread copies each stream's counters and their
+ * totals into a file it keeps mapped, so that monitoring agents on the
+ * same host can map the file read-only and look at the numbers as often
+ * as they like, with no system calls to or signals for iperf3.  The
+ * file has a fixed size: a header, then room for LIVE_MAX_STREAMS
+ * stream records.  Fields are in host byte order.
+ *
+ * The writer brackets each update with increments of seq, so seq is
+ * odd while an update is in progress.  To take a consistent copy, a
+ * reader loads seq, retries while it is odd, copies what it needs,
+ * and accepts the copy only if seq is still the same afterwards;
+ * iperf_live_read() does this.  A server keeps the file across tests,
+ * counting them in generation.
+ */
+
+#define LIVE_MAX_SPEC 256
+#define LIVE_MAGIC "iperf3lv"
+#define LIVE_VERSION 1
+#define LIVE_MAX_STREAMS 128
+#define LIVE_DEFAULT_PERIOD 100000	/* us */
+#define LIVE_MIN_PERIOD 1000		/* us */
+#define LIVE_MAX_PERIOD 10000000	/* us */
+
+/* protocol */
+#define LIVE_TCP 1
+#define LIVE_UDP 2
+#define LIVE_SCTP 3
+
+/* flags */
+#define LIVE_F_SENDER 0x1		/* this side sends the data */
+#define LIVE_F_REVERSE 0x2		/* -R */
+#define LIVE_F_OMITTING 0x4		/* within --omit */
+
+struct iperf_live_header
+{
+    char      magic[8];			/* LIVE_MAGIC */
+    uint32_t  version;
+    uint32_t  header_size;		/* bytes, where the streams start */
+    uint32_t  stream_size;		/* bytes per stream record */
+    uint32_t  max_streams;
+    volatile uint32_t seq;		/* odd while being updated */
+    uint32_t  pid;
+    uint64_t  generation;		/* tests started */
+    uint64_t  update_us;		/* last update, us since the epoch */
+    uint64_t  start_us;			/* test start, us since the epoch */
+    int32_t   state;			/* TEST_RUNNING etc., see iperf_api.h */
+    uint32_t  role;			/* 'c' or 's' */
+    uint32_t  protocol;
+    uint32_t  flags;
+    uint32_t  num_streams;		/* in the test */
+    uint32_t  streams;			/* records filled in below */
+    /* Totals of the stream records. */
+    uint64_t  bytes;
+    uint64_t  packets;
+    uint64_t  lost;
+    uint64_t  retrans;
+};
+
+struct iperf_live_stream
+{
+    uint32_t  id;
+    int32_t   socket;
+    uint64_t  bytes;			/* sent or received, after --omit */
+    uint64_t  packets;			/* UDP */
+    uint64_t  lost;			/* UDP receiver, or as reported */
+    uint64_t  retrans;			/* TCP sender, whole connection */
+    uint32_t  snd_cwnd;			/* TCP sender, bytes */
+    uint32_t  rtt_us;			/* TCP sender */
+    uint32_t  jitter_us;		/* UDP */
+    uint32_t  reserved;
+};
+
+#define LIVE_FILE_SIZE (sizeof(struct iperf_live_header) + LIVE_MAX_STREAMS * sizeof(struct iperf_live_stream))
+
+/* Per test. */
+struct iperf_live
+{
+    char     *file_name;
+    int       period;			/* us */
+    struct iperf_live_header *map;	/* NULL until the first test starts */
+    Timer    *timer;
+    char      spec[LIVE_MAX_SPEC];
+};
+
+struct iperf_test;
+
+/**
+ * iperf_live_parse -- parse a --live-stats spec: file[,period_ms]
+ *
+ * returns a new configuration, or NULL and sets i_errno to IELIVESTATS
+ *
+ */
+struct iperf_live *iperf_live_parse(const char *spec);
+
+/**
+ * iperf_live_start -- map the file if need be, start a new generation
+ * and the update timer
+ *
+ * returns 0, or -1 and sets i_errno to IELIVESTATS
+ *
+ */
+int iperf_live_start(struct iperf_test *test);
+
+/**
+ * iperf_live_stop -- stop the timer and publish the final numbers
+ *
+ */
+void iperf_live_stop(struct iperf_test *test);
+
+/* Unmap, leaving the file as the last update left it. */
+void iperf_live_free(struct iperf_test *test);
+
+void iperf_live_publish(struct iperf_test *test);
+
+/**
+ * iperf_live_write_begin / iperf_live_write_end -- bracket an update
+ *
+ */
+void iperf_live_write_begin(struct iperf_live_header *h);
+void iperf_live_write_end(struct iperf_live_header *h);
+
+/**
+ * iperf_live_read -- copy the first len bytes of a mapped file into
+ * buf, consistently
+ *
+ * returns 0, or -1 if every try met an update in progress
+ *
+ */
+int iperf_live_read(const struct iperf_live_header *h, void *buf, size_t len);
+
+#endif
@@ -107,7 +107,18 @@ const char usage_longstr[] = "Usage: iperf [-s|-c host] [options]\n"
                            "  -B, --bind      <host>    bind to a specific interface\n"
                            "  -V, --verbose             more detailed output\n"
                            "  -J, --json                output in JSON format\n"
+                           "  --json-stream             output one JSON record per line as the test runs\n"
                            "  --logfile f               send output to a log file\n"
+                           "  --binlog f                append binary interval and summary records to f\n"
+                           "                            (iperf3_logconv turns them into JSON or CSV)\n"
+                           "  --live-stats f[,ms]       keep live counters in the memory-mapped file f,\n"
+                           "                            updated every ms milliseconds (default 100)\n"
+                           "  --sample-interval ms      sample throughput every ms milliseconds (down to 1)\n"
+                           "                            and summarize the rates and stalls at the end\n"
+#if defined(HAVE_PERF_EVENT)
+                           "  --perf-counters           count context switches, page faults, cycles,\n"
+                           "                            cache misses etc. with perf_event\n"
+#endif /* HAVE_PERF_EVENT */
                            "  -d, --debug               emit debugging output\n"
                            "  -v, --version             show version information and quit\n"
                            "  -h, --help                show this message and quit\n"
@@ -115,12 +126,15 @@ const char usage_longstr[] = "Usage: iperf [-s|-c host] [options]\n"
                            "  -s, --server              run in server mode\n"
                            "  -D, --daemon              run the server as a daemon\n"
                            "  -I, --pidfile file        write PID file\n"
+                           "  --metrics port            serve OpenMetrics (Prometheus) counters over\n"
+                           "                            HTTP on port, at /metrics\n"
                            "Client specific:\n"
                            "  -c, --client    <host>    run in client mode, connecting to <host>\n"
 #if defined(HAVE_SCTP)
                            "  --sctp                    use SCTP rather than TCP\n"
 #endif /* HAVE_SCTP */
                            "  -u, --udp                 use UDP rather than TCP\n"
+                           "                            (if most loss is receive socket overflow, raise -w)\n"
                            "  -b, --bandwidth #[KMG][/#] target bandwidth in bits/sec (0 for unlimited)\n"
                            "                            (default %d Mbit/sec for UDP, unlimited for TCP)\n"
                            "                            (optional slash and packet count for burst mode)\n"
@@ -149,6 +163,23 @@ const char usage_longstr[] = "Usage: iperf [-s|-c host] [options]\n"
                            "  -T, --title str           prefix every output line with this string\n"
                            "  --get-server-output       get results from server\n"
                            "  --udp-counters-64bit      use 64-bit counters in UDP test packets\n"
+                           "  --txtime fq|etf|sw        schedule UDP departures (SO_TXTIME or software)\n"
+                           "  --profile <spec>          shape the -b rate: cbr, poisson[:burst],\n"
+                           "                            onoff:period_ms:duty[:burst]\n"
+                           "  --size-mix <spec>         vary write sizes: imix, or size:weight[,...]\n"
+                           "  --trace file[,stride]     replay a CSV, binary or pcap trace of gaps and sizes\n"
+                           "  --rate-schedule <spec>    change the per-stream rate during the test:\n"
+                           "                            step:start:stop:incr:secs, ramp:start:stop[:secs]\n"
+                           "  --search <spec>           binary-search the highest UDP rate within a loss\n"
+                           "                            limit, min:max[:loss_percent[:resolution]]\n"
+                           "  --rr <spec>               time request/response transactions (TCP only):\n"
+                           "                            request[:response[:depth]], sizes in bytes [KMG]\n"
+                           "  --crr <spec>              like --rr, with a new connection per transaction:\n"
+                           "                            request[:response[:connections]]\n"
+#if defined(linux)
+                           "  --tcpinfo-sample ms[,file] sample TCP_INFO of each stream every ms milliseconds\n"
+                           "                            into the JSON output, or a binary file\n"
+#endif /* linux */
 
 #ifdef NOT_YET_SUPPORTED /* still working on these */
 #endif
@@ -229,6 +260,24 @@ const char test_start_bytes[] =
 const char test_start_blocks[] =
 "Starting Test: protocol: %s, %d streams, %d byte blocks, omitting %d seconds, %d blocks to send\n";
 
+const char test_start_profile[] =
+"Traffic profile: %s\n";
+
+const char test_start_rate_schedule[] =
+"Rate schedule: %s\n";
+
+const char test_start_tcpsample[] =
+"TCP_INFO sampled every %g ms into %s\n";
+
+const char test_start_sample[] =
+"Throughput sampled every %g ms\n";
+
+const char test_start_rr[] =
+"Transactions: %d byte requests, %d byte responses, %d in flight per stream\n";
+
+const char test_start_crr[] =
+"Connections: %d byte requests, %d byte responses, %d at once per stream\n";
+
 
 /* -------------------------------------------------------------------
  * reports
@@ -320,6 +369,21 @@ const char report_sum_bw_udp_sender_format[] =
 
 const char report_omitted[] = "(omitted)";
 
+const char report_rate_target_format[] =
+"[TGT] %6.2f-%-6.2f sec  target %ss/sec\n";
+
+const char report_rate_step_format[] =
+"[TGT] %6.2f-%-6.2f sec  target %ss/sec  step %d\n";
+
+const char report_search_trial[] =
+"Trial %2d: %ss/sec per stream offered, %ss/sec received, %lld/%lld lost (%.2g%%)  %s\n";
+
+const char report_search_result[] =
+"Search: %ss/sec per stream is the highest rate within %g%% loss (%d trials)\n";
+
+const char report_search_none[] =
+"Search: no rate tried, down to %ss/sec per stream, stayed within %g%% loss (%d trials)\n";
+
 const char report_bw_separator[] =
 "- - - - - - - - - - - - - - - - - - - - - - - - -\n";
 
@@ -329,6 +393,15 @@ const char report_outoforder[] =
 const char report_sum_outoforder[] =
 "[SUM] %4.1f-%4.1f sec  %d datagrams received out-of-order\n";
 
+const char report_socket_drops_format[] =
+"[%3d] %4.1f-%4.1f sec  %lld lost datagrams dropped by the receiving socket, %lld in the network\n";
+
+const char report_sum_socket_drops_format[] =
+"[SUM] %4.1f-%4.1f sec  %lld lost datagrams dropped by the receiving socket, %lld in the network\n";
+
+const char report_socket_drops_hint[] =
+"Most of the loss was the receiving socket's buffer overflowing; try a larger -w\n";
+
 const char report_peer[] =
 "[%3d] local %s port %u connected with %s port %u\n";
 
@@ -344,6 +417,65 @@ const char report_datagrams[] =
 const char report_sum_datagrams[] =
 "[SUM] Sent %d datagrams\n";
 
+const char report_txtime_late[] =
+"[%3d] Dropped %llu datagrams that missed their departure time\n";
+
+const char report_txtime_error[] =
+"[%3d] Departure spacing error: avg %.3f us, max %.3f us (%llu datagram pairs)\n";
+
+const char report_delay_format[] =
+"[%3d] %-5s p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms\n";
+
+const char report_sum_delay_format[] =
+"[SUM] %-5s p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms\n";
+
+const char report_seqwin_format[] =
+"[%3d] reordered %llu%s  duplicates %llu  loss bursts %llu%s\n";
+
+const char report_sum_seqwin_format[] =
+"[SUM] reordered %llu%s  duplicates %llu  loss bursts %llu%s\n";
+
+const char report_limits_format[] =
+"[%3d] time limited by: rwnd %.1f%%  sndbuf %.1f%%  cwnd %.1f%%  application %.1f%%\n";
+
+const char report_sum_limits_format[] =
+"[SUM] time limited by: rwnd %.1f%%  sndbuf %.1f%%  cwnd %.1f%%  application %.1f%%\n";
+
+const char report_rcv_format[] =
+"[%3d] receiver: rcv_rtt %.3f ms  rcv_space %s  rcv_ssthresh %s  out-of-order %s  queued %s\n";
+
+const char report_sum_fairness_format[] =
+"[SUM] fairness: Jain's index %.4f  min %ss/sec  max %ss/sec  stddev %ss/sec\n";
+
+const char report_sample_format[] =
+"[%3d] %g ms samples: min %ss/sec  median %ss/sec  max %ss/sec  stalls %llu, longest %.1f ms\n";
+
+const char report_sum_sample_format[] =
+"[SUM] %g ms samples: min %ss/sec  median %ss/sec  max %ss/sec  stalls %llu, longest %.1f ms\n";
+
+const char report_steady_format[] =
+"[%3d] steady share %ss/sec, reached after %.2f sec\n";
+
+const char report_steady_none_format[] =
+"[%3d] steady share %ss/sec, not reached\n";
+
+const char report_owd[] = "delay";
+const char report_ipdv[] = "ipdv";
+const char report_rtt[] = "rtt";
+const char report_connect[] = "connect";
+
+const char report_rr_format[] =
+"[%3d] %6.2f-%-6.2f sec  %llu transactions  %.1f trans/sec  %s\n";
+
+const char report_sum_rr_format[] =
+"[SUM] %6.2f-%-6.2f sec  %llu transactions  %.1f trans/sec  %s\n";
+
+const char report_crr_format[] =
+"[%3d] %6.2f-%-6.2f sec  %llu connections  %.1f conn/sec  %llu failed  %s\n";
+
+const char report_sum_crr_format[] =
+"[SUM] %6.2f-%-6.2f sec  %llu connections  %.1f conn/sec  %llu failed  %s\n";
+
 const char server_reporting[] =
 "[%3d] Server Report:\n";
 
@@ -353,6 +485,27 @@ const char reportCSV_peer[] =
 const char report_cpu[] =
 "CPU Utilization: %s/%s %.1f%% (%.1f%%u/%.1f%%s), %s/%s %.1f%% (%.1f%%u/%.1f%%s)\n";
 
+const char report_cpu_cost[] =
+"CPU cost: %s/%s %.3f CPU-s/GB (%.3f s), %s/%s %.3f CPU-s/GB (%.3f s)\n";
+
+const char report_cpu_cost_local[] =
+"CPU cost: %s/%s %.3f CPU-s/GB (%.3f s)\n";
+
+const char report_cpu_interval_format[] =
+"[CPU] %6.2f-%-6.2f sec  user %.3f s  system %.3f s  %.3f CPU-s/GB\n";
+
+const char report_perf_interval_format[] =
+"[PRF] %6.2f-%-6.2f sec  %s\n";
+
+const char report_perf_format[] =
+"perf counters: %s\n";
+
+const char report_io_format[] =
+"[%3d] syscalls %llu  %s/call  EAGAIN %llu (%.1f%%)  short %llu  soft errors %llu\n";
+
+const char report_sockmem_format[] =
+"[%3d] socket rmem %s of %s  wmem %s of %s  backlog %s  drops %s  inq %s  outq %s\n";
+
 const char report_local[] = "local";
 const char report_remote[] = "remote";
 const char report_sender[] = "sender";
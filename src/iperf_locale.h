@@ -47,6 +47,12 @@ extern const char wait_server_threads[] ;
 extern const char test_start_time[];
 extern const char test_start_bytes[];
 extern const char test_start_blocks[];
+extern const char test_start_profile[];
+extern const char test_start_rate_schedule[];
+extern const char test_start_tcpsample[];
+extern const char test_start_sample[];
+extern const char test_start_rr[];
+extern const char test_start_crr[];
 
 extern const char report_time[] ;
 extern const char report_connecting[] ;
@@ -77,18 +83,55 @@ extern const char report_sum_bw_retrans_format[] ;
 extern const char report_sum_bw_udp_format[] ;
 extern const char report_sum_bw_udp_sender_format[] ;
 extern const char report_omitted[] ;
+extern const char report_rate_target_format[] ;
+extern const char report_rate_step_format[] ;
+extern const char report_search_trial[] ;
+extern const char report_search_result[] ;
+extern const char report_search_none[] ;
 extern const char report_bw_separator[] ;
 extern const char report_outoforder[] ;
 extern const char report_sum_outoforder[] ;
+extern const char report_socket_drops_format[] ;
+extern const char report_sum_socket_drops_format[] ;
+extern const char report_socket_drops_hint[] ;
 extern const char report_peer[] ;
 extern const char report_mss_unsupported[] ;
 extern const char report_mss[] ;
 extern const char report_datagrams[] ;
 extern const char report_sum_datagrams[] ;
+extern const char report_txtime_late[] ;
+extern const char report_txtime_error[] ;
+extern const char report_delay_format[] ;
+extern const char report_sum_delay_format[] ;
+extern const char report_seqwin_format[] ;
+extern const char report_sum_seqwin_format[] ;
+extern const char report_limits_format[] ;
+extern const char report_sum_limits_format[] ;
+extern const char report_rcv_format[] ;
+extern const char report_sum_fairness_format[] ;
+extern const char report_sample_format[] ;
+extern const char report_sum_sample_format[] ;
+extern const char report_steady_format[] ;
+extern const char report_steady_none_format[] ;
+extern const char report_owd[] ;
+extern const char report_ipdv[] ;
+extern const char report_rtt[] ;
+extern const char report_connect[] ;
+extern const char report_rr_format[] ;
+extern const char report_sum_rr_format[] ;
+extern const char report_crr_format[] ;
+extern const char report_sum_crr_format[] ;
 extern const char server_reporting[] ;
 extern const char reportCSV_peer[] ;
 
 extern const char report_cpu[] ;
+extern const char report_cpu_cost[] ;
+extern const char report_cpu_cost_local[] ;
+extern const char report_cpu_interval_format[] ;
+extern const char report_perf_interval_format[] ;
+extern const char report_perf_format[] ;
+extern const char report_io_format[] ;
+extern const char report_sockmem_format[] ;
 extern const char report_local[] ;
 extern const char report_remote[] ;
 extern const char report_sender[] ;
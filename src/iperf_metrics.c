@@ -0,0 +1,503 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_metrics.c
+ *
+ * OpenMetrics endpoint for the server.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_util.h"
+#include "iperf_metrics.h"
+#include "net.h"
+
+/* A growing text buffer for the response. */
+struct metrics_text
+{
+    char     *p;
+    size_t    len;
+    size_t    size;
+};
+
+static void
+mprintf(struct metrics_text *t, const char *format, ...) __attribute__ ((format(printf,2,3)));
+
+static void
+mprintf(struct metrics_text *t, const char *format, ...)
+{
+    va_list ap;
+    char *p;
+    int n;
+
+    if (t->p == NULL && t->size != 0)
+	return;				/* out of memory earlier */
+    for (;;) {
+	va_start(ap, format);
+	n = vsnprintf(t->p + t->len, t->size - t->len, format, ap);
+	va_end(ap);
+	if (n < 0)
+	    return;
+	if (t->len + n < t->size) {
+	    t->len += n;
+	    return;
+	}
+	t->size = (t->size + n) * 2 + 1024;
+	if ((p = realloc(t->p, t->size)) == NULL) {
+	    free(t->p);
+	    t->p = NULL;
+	    return;
+	}
+	t->p = p;
+    }
+}
+
+/* A label value, with \, " and newlines escaped. */
+static void
+mprint_label(struct metrics_text *t, const char *s)
+{
+    for (; *s != '\0'; ++s) {
+	if (*s == '\\' || *s == '"')
+	    mprintf(t, "\\%c", *s);
+	else if (*s == '\n')
+	    mprintf(t, "\\n");
+	else
+	    mprintf(t, "%c", *s);
+    }
+}
+
+static const char *
+state_name(int state)
+{
+    switch (state) {
+	case PARAM_EXCHANGE: return "param_exchange";
+	case CREATE_STREAMS: return "create_streams";
+	case TEST_START: return "test_start";
+	case TEST_RUNNING: return "test_running";
+	case TEST_END: return "test_end";
+	case EXCHANGE_RESULTS: return "exchange_results";
+	case DISPLAY_RESULTS: return "display_results";
+	case NEXT_TRIAL: return "next_trial";
+	default: return "idle";
+    }
+}
+
+static const char *state_names[] = {
+    "idle", "param_exchange", "create_streams", "test_start", "test_running",
+    "test_end", "exchange_results", "display_results", "next_trial",
+};
+
+/* What the current test's streams have done so far, from this side. */
+static int
+current_test(struct iperf_test *test, struct metrics_test *mt)
+{
+    struct iperf_stream *sp;
+    struct iperf_stream_result *rp;
+    struct timeval now;
+
+    memset(mt, 0, sizeof(*mt));
+    sp = SLIST_FIRST(&test->streams);
+    /* The streams are timed from TEST_START on. */
+    if (sp == NULL || test->state == PARAM_EXCHANGE || test->state == CREATE_STREAMS)
+	return 0;
+    /* end_time is set by the stats callback, which an aborted test may not reach. */
+    if (test->state == TEST_RUNNING || sp->result->end_time.tv_sec == 0) {
+	gettimeofday(&now, NULL);
+	mt->seconds = timeval_diff(&sp->result->start_time, &now);
+    } else
+	mt->seconds = timeval_diff(&sp->result->start_time, &sp->result->end_time);
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	rp = sp->result;
+	mt->bytes += test->sender ? rp->bytes_sent : rp->bytes_received;
+	mt->retransmits += rp->stream_retrans;
+	++mt->streams;
+    }
+    return 1;
+}
+
+/* The per-test gauges, each with a sample for the current and the last test. */
+enum { TEST_SECONDS, TEST_BYTES, TEST_BITS_PER_SECOND, TEST_RETRANSMITS, TEST_STREAMS, TEST_GAUGES };
+
+static const struct {
+    const char *name;
+    const char *help;
+} test_gauges[TEST_GAUGES] = {
+    { "iperf3_server_test_seconds", "Length of the current or last test so far." },
+    { "iperf3_server_test_bytes", "Test data moved by this side, after --omit." },
+    { "iperf3_server_test_bits_per_second", "Average rate of the test so far." },
+    { "iperf3_server_test_retransmits", "TCP retransmits by the sender." },
+    { "iperf3_server_test_streams", "Streams in the test." },
+};
+
+static void
+mprint_test(struct metrics_text *t, int gauge, const char *which, struct metrics_test *mt)
+{
+    mprintf(t, "%s{test=\"%s\"} ", test_gauges[gauge].name, which);
+    switch (gauge) {
+	case TEST_SECONDS:
+	    mprintf(t, "%.6f\n", mt->seconds);
+	    break;
+	case TEST_BYTES:
+	    mprintf(t, "%llu\n", (unsigned long long) mt->bytes);
+	    break;
+	case TEST_BITS_PER_SECOND:
+	    mprintf(t, "%.0f\n", mt->seconds > 0 ? mt->bytes * 8 / mt->seconds : 0.0);
+	    break;
+	case TEST_RETRANSMITS:
+	    mprintf(t, "%llu\n", (unsigned long long) mt->retransmits);
+	    break;
+	case TEST_STREAMS:
+	    mprintf(t, "%d\n", mt->streams);
+	    break;
+    }
+}
+
+static void
+metrics_render(struct iperf_test *test, struct metrics_text *t)
+{
+    struct iperf_metrics *m = test->metrics;
+    struct metrics_test cur;
+    uint64_t received = m->bytes_received, sent = m->bytes_sent;
+    const char *state;
+    int i, have_cur;
+
+    have_cur = m->active && current_test(test, &cur);
+    if (have_cur) {
+	if (test->sender)
+	    sent += cur.bytes;
+	else
+	    received += cur.bytes;
+    }
+    state = m->active ? state_name(test->state) : "idle";
+
+    mprintf(t, "# TYPE iperf3_server_tests counter\n"
+	    "# HELP iperf3_server_tests Tests finished without error.\n"
+	    "iperf3_server_tests_total %llu\n", (unsigned long long) m->tests);
+    mprintf(t, "# TYPE iperf3_server_test_failures counter\n"
+	    "# HELP iperf3_server_test_failures Tests ended by an error.\n"
+	    "iperf3_server_test_failures_total %llu\n", (unsigned long long) m->failures);
+    mprintf(t, "# TYPE iperf3_server_errors counter\n"
+	    "# HELP iperf3_server_errors Errors that ended a test, by i_errno.\n");
+    for (i = 0; i < m->nerrors; ++i) {
+	mprintf(t, "iperf3_server_errors_total{errno=\"%d\",error=\"", m->errors[i].code);
+	mprint_label(t, m->errors[i].message);
+	mprintf(t, "\"} %llu\n", (unsigned long long) m->errors[i].count);
+    }
+    mprintf(t, "# TYPE iperf3_server_accept_denied counter\n"
+	    "# HELP iperf3_server_accept_denied Clients turned away because a test was running.\n"
+	    "iperf3_server_accept_denied_total %llu\n", (unsigned long long) m->accept_denied);
+    mprintf(t, "# TYPE iperf3_server_received_bytes counter\n"
+	    "# HELP iperf3_server_received_bytes Test data received.\n"
+	    "iperf3_server_received_bytes_total %llu\n", (unsigned long long) received);
+    mprintf(t, "# TYPE iperf3_server_sent_bytes counter\n"
+	    "# HELP iperf3_server_sent_bytes Test data sent.\n"
+	    "iperf3_server_sent_bytes_total %llu\n", (unsigned long long) sent);
+    mprintf(t, "# TYPE iperf3_server_scrapes counter\n"
+	    "iperf3_server_scrapes_total %llu\n", (unsigned long long) m->scrapes);
+    mprintf(t, "# TYPE iperf3_server_state stateset\n"
+	    "# HELP iperf3_server_state Where the server is in a test.\n");
+    for (i = 0; i < sizeof(state_names) / sizeof(state_names[0]); ++i)
+	mprintf(t, "iperf3_server_state{iperf3_server_state=\"%s\"} %d\n", state_names[i],
+		strcmp(state, state_names[i]) == 0);
+
+    /* A family's samples must follow its own TYPE and HELP lines. */
+    if (have_cur || m->have_last)
+	for (i = 0; i < TEST_GAUGES; ++i) {
+	    mprintf(t, "# TYPE %s gauge\n# HELP %s %s\n", test_gauges[i].name, test_gauges[i].name, test_gauges[i].help);
+	    if (have_cur)
+		mprint_test(t, i, "current", &cur);
+	    if (m->have_last)
+		mprint_test(t, i, "last", &m->last);
+	}
+    mprintf(t, "# EOF\n");
+}
+
+static void
+conn_close(struct iperf_test *test, struct metrics_conn *c)
+{
+    FD_CLR(c->fd, &test->read_set);
+    FD_CLR(c->fd, &test->write_set);
+    close(c->fd);
+    free(c->response);
+    c->fd = -1;
+    c->response = NULL;
+}
+
+/* Build the answer to a complete request. */
+static void
+conn_respond(struct iperf_test *test, struct metrics_conn *c)
+{
+    struct metrics_text body, t;
+    const char *status = "200 OK";
+
+    memset(&body, 0, sizeof(body));
+    memset(&t, 0, sizeof(t));
+    if (strncmp(c->request, "GET ", 4) != 0)
+	status = "405 Method Not Allowed";
+    else if (strncmp(c->request + 4, "/metrics ", 9) != 0 && strncmp(c->request + 4, "/ ", 2) != 0)
+	status = "404 Not Found";
+    if (status[0] == '2') {
+	++test->metrics->scrapes;
+	metrics_render(test, &body);
+    } else
+	mprintf(&body, "%s\n", status);
+    mprintf(&t, "HTTP/1.0 %s\r\n"
+	    "Content-Type: %s\r\n"
+	    "Content-Length: %lu\r\n"
+	    "Connection: close\r\n\r\n%s",
+	    status, status[0] == '2' ? "application/openmetrics-text; version=1.0.0; charset=utf-8" : "text/plain",
+	    (unsigned long) body.len, body.p != NULL ? body.p : "");
+    free(body.p);
+    if (t.p == NULL) {
+	conn_close(test, c);
+	return;
+    }
+    c->response = t.p;
+    c->response_len = t.len;
+    c->response_off = 0;
+    FD_CLR(c->fd, &test->read_set);
+    FD_SET(c->fd, &test->write_set);
+}
+
+static void
+conn_read(struct iperf_test *test, struct metrics_conn *c)
+{
+    ssize_t n;
+
+    n = read(c->fd, c->request + c->request_len, sizeof(c->request) - 1 - c->request_len);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+	return;
+    if (n <= 0) {
+	conn_close(test, c);
+	return;
+    }
+    c->request_len += n;
+    c->request[c->request_len] = '\0';
+    /* Only the request line matters; answer once the headers are in. */
+    if (strstr(c->request, "\r\n\r\n") != NULL || strstr(c->request, "\n\n") != NULL ||
+	c->request_len == sizeof(c->request) - 1)
+	conn_respond(test, c);
+}
+
+static void
+conn_write(struct iperf_test *test, struct metrics_conn *c)
+{
+    ssize_t n;
+
+    n = write(c->fd, c->response + c->response_off, c->response_len - c->response_off);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+	return;
+    if (n <= 0) {
+	conn_close(test, c);
+	return;
+    }
+    c->response_off += n;
+    if (c->response_off == c->response_len)
+	conn_close(test, c);
+}
+
+static void
+metrics_accept(struct iperf_test *test)
+{
+    struct iperf_metrics *m = test->metrics;
+    struct metrics_conn *c = NULL, *oldest = NULL;
+    struct timeval now;
+    int s, i;
+
+    if ((s = accept(m->listener, NULL, NULL)) < 0)
+	return;
+    gettimeofday(&now, NULL);
+    for (i = 0; i < METRICS_MAX_CONNS && c == NULL; ++i) {
+	if (m->conns[i].fd < 0)
+	    c = &m->conns[i];
+	else if (oldest == NULL || timeval_diff(&m->conns[i].since, &now) > timeval_diff(&oldest->since, &now))
+	    oldest = &m->conns[i];
+    }
+    /* Every slot taken: drop a scraper that has stalled, or this one. */
+    if (c == NULL && timeval_diff(&oldest->since, &now) > METRICS_IDLE_TIMEOUT) {
+	conn_close(test, oldest);
+	c = oldest;
+    }
+    if (c == NULL || setnonblocking(s, 1) < 0) {
+	close(s);
+	return;
+    }
+    memset(c, 0, sizeof(*c));
+    c->fd = s;
+    c->since = now;
+    FD_SET(s, &test->read_set);
+    if (s > test->max_fd) test->max_fd = s;
+}
+
+int
+iperf_metrics_open(struct iperf_test *test)
+{
+    struct iperf_metrics *m;
+    int i;
+
+    m = (struct iperf_metrics *) calloc(1, sizeof(struct iperf_metrics));
+    if (m == NULL) {
+	i_errno = IEMETRICS;
+	return -1;
+    }
+    m->listener = netannounce(test->settings->domain, Ptcp, test->bind_address, test->metrics_port);
+    if (m->listener < 0 || setnonblocking(m->listener, 1) < 0) {
+	if (m->listener >= 0)
+	    close(m->listener);
+	free(m);
+	i_errno = IEMETRICS;
+	return -1;
+    }
+    for (i = 0; i < METRICS_MAX_CONNS; ++i)
+	m->conns[i].fd = -1;
+    test->metrics = m;
+    return 0;
+}
+
+void
+iperf_metrics_close(struct iperf_test *test)
+{
+    struct iperf_metrics *m = test->metrics;
+    int i;
+
+    if (m == NULL)
+	return;
+    for (i = 0; i < METRICS_MAX_CONNS; ++i)
+	if (m->conns[i].fd >= 0)
+	    conn_close(test, &m->conns[i]);
+    FD_CLR(m->listener, &test->read_set);
+    close(m->listener);
+    free(m);
+    test->metrics = NULL;
+}
+
+void
+iperf_metrics_fdset(struct iperf_test *test)
+{
+    struct iperf_metrics *m = test->metrics;
+    int i, fd;
+
+    FD_SET(m->listener, &test->read_set);
+    if (m->listener > test->max_fd) test->max_fd = m->listener;
+    for (i = 0; i < METRICS_MAX_CONNS; ++i) {
+	if ((fd = m->conns[i].fd) < 0)
+	    continue;
+	if (m->conns[i].response != NULL)
+	    FD_SET(fd, &test->write_set);
+	else
+	    FD_SET(fd, &test->read_set);
+	if (fd > test->max_fd) test->max_fd = fd;
+    }
+}
+
+void
+iperf_metrics_run(struct iperf_test *test, fd_set *read_setP, fd_set *write_setP)
+{
+    struct iperf_metrics *m = test->metrics;
+    struct metrics_conn *c;
+    int i;
+
+    for (i = 0; i < METRICS_MAX_CONNS; ++i) {
+	c = &m->conns[i];
+	if (c->fd < 0)
+	    continue;
+	if (c->response == NULL && FD_ISSET(c->fd, read_setP))
+	    conn_read(test, c);
+	else if (c->response != NULL && FD_ISSET(c->fd, write_setP))
+	    conn_write(test, c);
+    }
+    if (FD_ISSET(m->listener, read_setP))
+	metrics_accept(test);
+}
+
+void
+iperf_metrics_fold(struct iperf_test *test)
+{
+    struct iperf_metrics *m = test->metrics;
+    struct metrics_test mt;
+
+    if (m == NULL || !m->active || !current_test(test, &mt))
+	return;
+    if (test->sender)
+	m->bytes_sent += mt.bytes;
+    else
+	m->bytes_received += mt.bytes;
+}
+
+void
+iperf_metrics_test_done(struct iperf_test *test, int result)
+{
+    struct iperf_metrics *m = test->metrics;
+    int i;
+
+    if (m == NULL)
+	return;
+    if (current_test(test, &m->last))
+	m->have_last = 1;
+    iperf_metrics_fold(test);
+    m->active = 0;
+
+    if (result == 0 && i_errno == IENONE) {
+	++m->tests;
+	return;
+    }
+    ++m->failures;
+    for (i = 0; i < m->nerrors; ++i)
+	if (m->errors[i].code == i_errno)
+	    break;
+    if (i == m->nerrors) {
+	if (m->nerrors == METRICS_MAX_ERRORS)
+	    return;
+	++m->nerrors;
+	m->errors[i].code = i_errno;
+	snprintf(m->errors[i].message, sizeof(m->errors[i].message), "%s", iperf_strerror(i_errno));
+    }
+    ++m->errors[i].count;
+}
+
+char *
+iperf_metrics_render(struct iperf_test *test)
+{
+    struct metrics_text t;
+
+    memset(&t, 0, sizeof(t));
+    metrics_render(test, &t);
+    return t.p;
+}
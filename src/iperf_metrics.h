@@ -0,0 +1,145 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_METRICS_H
+#define __IPERF_METRICS_H
+
+#include <sys/time.h>
+#include <sys/select.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+/*
+ * OpenMetrics (Prometheus) endpoint for the server (--metrics port).
+ *
+ * The server's select() loop also watches a listening socket on the
+ * metrics port and the few scrape connections it accepts, all
+ * nonblocking.  A GET of /metrics gets the counters below as
+ * application/openmetrics-text; a scrape reads and writes what the
+ * sockets will take without waiting, so a slow or stuck scraper never
+ * holds up a test, and at most METRICS_MAX_CONNS are served at once.
+ * The counters live as long as the server, across tests.
+ */
+
+#define METRICS_MAX_CONNS 4
+#define METRICS_MAX_ERRORS 32		/* distinct i_errno values counted */
+#define METRICS_REQUEST_SIZE 1024
+#define METRICS_IDLE_TIMEOUT 5		/* seconds before a busy slot is reused */
+
+struct metrics_conn
+{
+    int       fd;			/* -1 if the slot is free */
+    struct timeval since;
+    char      request[METRICS_REQUEST_SIZE];
+    size_t    request_len;
+    char     *response;			/* NULL until the request is in */
+    size_t    response_len;
+    size_t    response_off;
+};
+
+struct metrics_error
+{
+    int       code;			/* i_errno */
+    uint64_t  count;
+    char      message[128];		/* as first seen */
+};
+
+/* What one test did, from this side. */
+struct metrics_test
+{
+    double    seconds;
+    uint64_t  bytes;
+    uint64_t  retransmits;
+    int       streams;
+};
+
+struct iperf_metrics
+{
+    int       listener;
+    struct metrics_conn conns[METRICS_MAX_CONNS];
+
+    int       active;			/* a test is under way */
+    uint64_t  tests;			/* finished without error */
+    uint64_t  failures;
+    uint64_t  accept_denied;		/* ACCESS_DENIED answers */
+    uint64_t  bytes_received;		/* by finished tests, and omitted */
+    uint64_t  bytes_sent;
+    uint64_t  scrapes;
+    struct metrics_error errors[METRICS_MAX_ERRORS];
+    int       nerrors;
+    int       have_last;
+    struct metrics_test last;
+};
+
+struct iperf_test;
+
+/**
+ * iperf_metrics_open -- listen on test->metrics_port, once per server
+ *
+ * returns 0, or -1 and sets i_errno to IEMETRICS
+ *
+ */
+int iperf_metrics_open(struct iperf_test *test);
+
+void iperf_metrics_close(struct iperf_test *test);
+
+/**
+ * iperf_metrics_fdset -- add the listener and the scrape connections
+ * to the test's select() sets
+ *
+ */
+void iperf_metrics_fdset(struct iperf_test *test);
+
+/**
+ * iperf_metrics_run -- accept, read and answer scrapes that are ready
+ *
+ */
+void iperf_metrics_run(struct iperf_test *test, fd_set *read_setP, fd_set *write_setP);
+
+/**
+ * iperf_metrics_fold -- move the bytes the streams have counted so
+ * far into the totals, before they are reset
+ *
+ */
+void iperf_metrics_fold(struct iperf_test *test);
+
+/**
+ * iperf_metrics_test_done -- count a test that iperf_run_server
+ * finished, with its result
+ *
+ */
+void iperf_metrics_test_done(struct iperf_test *test, int result);
+
+/**
+ * iperf_metrics_render -- the /metrics page as it would be served now
+ *
+ * returns a malloc'd string, or NULL if out of memory
+ *
+ */
+char *iperf_metrics_render(struct iperf_test *test);
+
+#endif
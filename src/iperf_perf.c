@@ -0,0 +1,218 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_perf.c
+ *
+ * perf_event counters for the iperf3 process.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#if defined(HAVE_PERF_EVENT)
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "iperf_perf.h"
+
+static const char *perf_names[PERF_NCOUNTERS] = {
+    "context_switches", "page_faults", "cpu_migrations",
+    "cycles", "instructions", "cache_misses"
+};
+
+#if defined(HAVE_PERF_EVENT)
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} perf_events[PERF_NCOUNTERS] = {
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+
+static int
+perf_open_one(int i, int exclude_kernel)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[i].type;
+    attr.config = perf_events[i].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;			/* and any threads started later */
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    /* This process, on any CPU. */
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* The counter's value, scaled up if it was multiplexed. */
+static int
+perf_read_one(int fd, uint64_t *value)
+{
+    uint64_t r[3];			/* value, time enabled, time running */
+
+    if (read(fd, r, sizeof(r)) != sizeof(r))
+	return -1;
+    if (r[2] > 0 && r[2] < r[1])
+	r[0] = (uint64_t) ((double) r[0] * r[1] / r[2]);
+    *value = r[0];
+    return 0;
+}
+#endif /* HAVE_PERF_EVENT */
+
+struct iperf_perf *
+iperf_perf_open(void)
+{
+#if defined(HAVE_PERF_EVENT)
+    struct iperf_perf *p;
+    int i, n = 0, err = 0;
+
+    p = (struct iperf_perf *) malloc(sizeof(struct iperf_perf));
+    if (p == NULL)
+	return NULL;
+    for (i = 0; i < PERF_NCOUNTERS; ++i) {
+	p->last[i] = 0;
+	p->fd[i] = perf_open_one(i, 0);
+	if (p->fd[i] < 0 && (errno == EACCES || errno == EPERM))
+	    p->fd[i] = perf_open_one(i, 1);
+	if (p->fd[i] < 0)
+	    err = errno;
+	else {
+	    (void) perf_read_one(p->fd[i], &p->last[i]);
+	    ++n;
+	}
+    }
+    if (n == 0) {
+	free(p);
+	errno = err;
+	return NULL;
+    }
+    return p;
+#else
+    errno = ENOSYS;
+    return NULL;
+#endif /* HAVE_PERF_EVENT */
+}
+
+void
+iperf_perf_close(struct iperf_perf *p)
+{
+    int i;
+
+    if (p == NULL)
+	return;
+    for (i = 0; i < PERF_NCOUNTERS; ++i)
+	if (p->fd[i] >= 0)
+	    close(p->fd[i]);
+    free(p);
+}
+
+void
+iperf_perf_unknown(struct iperf_perf_counts *c)
+{
+    int i;
+
+    for (i = 0; i < PERF_NCOUNTERS; ++i)
+	c->v[i] = -1;
+}
+
+void
+iperf_perf_read(struct iperf_perf *p, struct iperf_perf_counts *c)
+{
+    iperf_perf_unknown(c);
+#if defined(HAVE_PERF_EVENT)
+    {
+	uint64_t v;
+	int i;
+
+	for (i = 0; i < PERF_NCOUNTERS; ++i)
+	    if (p->fd[i] >= 0 && perf_read_one(p->fd[i], &v) == 0) {
+		/* Scaling can make a multiplexed count step back a little. */
+		c->v[i] = v > p->last[i] ? (int64_t) (v - p->last[i]) : 0;
+		p->last[i] = v;
+	    }
+    }
+#endif /* HAVE_PERF_EVENT */
+}
+
+void
+iperf_perf_add(struct iperf_perf_counts *to, const struct iperf_perf_counts *from)
+{
+    int i;
+
+    for (i = 0; i < PERF_NCOUNTERS; ++i)
+	to->v[i] = (to->v[i] < 0 || from->v[i] < 0) ? -1 : to->v[i] + from->v[i];
+}
+
+cJSON *
+iperf_perf_to_json(const struct iperf_perf_counts *c, uint64_t bytes)
+{
+    cJSON *j, *jg;
+    int i;
+
+    j = cJSON_CreateObject();
+    if (j == NULL)
+	return NULL;
+    jg = cJSON_CreateObject();
+    for (i = 0; i < PERF_NCOUNTERS; ++i)
+	if (c->v[i] >= 0) {
+	    cJSON_AddIntToObject(j, perf_names[i], c->v[i]);
+	    if (jg != NULL && bytes > 0)
+		cJSON_AddFloatToObject(jg, perf_names[i], c->v[i] * 1e9 / bytes);
+	}
+    if (jg != NULL)
+	cJSON_AddItemToObject(j, "per_gb", jg);
+    return j;
+}
+
+int
+iperf_perf_snprintf(char *buf, int len, const struct iperf_perf_counts *c, uint64_t bytes)
+{
+    int i, n = 0;
+
+    buf[0] = '\0';
+    for (i = 0; i < PERF_NCOUNTERS && n < len; ++i)
+	if (c->v[i] >= 0) {
+	    if (bytes > 0)
+		n += snprintf(buf + n, len - n, "%s%s %lld (%.4g/GB)", n > 0 ? "  " : "", perf_names[i], (long long) c->v[i], c->v[i] * 1e9 / bytes);
+	    else
+		n += snprintf(buf + n, len - n, "%s%s %lld", n > 0 ? "  " : "", perf_names[i], (long long) c->v[i]);
+	}
+    return n;
+}
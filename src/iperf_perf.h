@@ -0,0 +1,106 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_PERF_H
+#define __IPERF_PERF_H
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "cjson.h"
+
+/*
+ * perf_event counters for the iperf3 process (--perf-counters, Linux
+ * only).
+ *
+ * The software counters (context switches, page faults, CPU
+ * migrations) are always available; the hardware ones (cycles,
+ * instructions, cache misses) only where there is a PMU, which
+ * excludes many virtual machines.  If the kernel will not count
+ * kernel-mode events for an unprivileged user (perf_event_paranoid),
+ * only user-mode events are counted.  Counters that the kernel has to
+ * multiplex are scaled up to the whole time they were enabled.
+ */
+enum {
+    PERF_CONTEXT_SWITCHES,
+    PERF_PAGE_FAULTS,
+    PERF_CPU_MIGRATIONS,
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_NCOUNTERS
+};
+
+struct iperf_perf
+{
+    int       fd[PERF_NCOUNTERS];	/* -1 if not available */
+    uint64_t  last[PERF_NCOUNTERS];	/* scaled value at the last read */
+};
+
+/* Counts over some period; -1 for counters that are not available. */
+struct iperf_perf_counts
+{
+    int64_t   v[PERF_NCOUNTERS];
+};
+
+/**
+ * iperf_perf_open -- start counting for the calling process
+ *
+ * Returns NULL, with errno set, if not even one counter could be
+ * opened.
+ *
+ */
+struct iperf_perf *iperf_perf_open(void);
+
+void iperf_perf_close(struct iperf_perf *);
+
+/**
+ * iperf_perf_read -- the counts since the previous read (or the open)
+ *
+ */
+void iperf_perf_read(struct iperf_perf *, struct iperf_perf_counts *);
+
+void iperf_perf_unknown(struct iperf_perf_counts *);
+
+/* Add from into to; a counter unknown in either is unknown. */
+void iperf_perf_add(struct iperf_perf_counts *to, const struct iperf_perf_counts *from);
+
+/**
+ * iperf_perf_to_json -- the available counts, and under "per_gb" the
+ * same per 10^9 bytes moved
+ *
+ */
+cJSON *iperf_perf_to_json(const struct iperf_perf_counts *, uint64_t bytes);
+
+/**
+ * iperf_perf_snprintf -- "name count (per GB)" for each available
+ * counter, for the text output
+ *
+ */
+int iperf_perf_snprintf(char *buf, int len, const struct iperf_perf_counts *, uint64_t bytes);
+
+#endif
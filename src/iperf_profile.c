@@ -0,0 +1,774 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_profile.c
+ *
+ * Traffic profiles and packet size mixes for the sender.
+ *
+ * With a profile, sending streams are gated by a schedule of arrival
+ * times instead of the constant-rate throttle.  The schedule advances
+ * in "on time": for a Poisson source that is just elapsed time, for
+ * an on/off source only the on part of each cycle counts, so the
+ * average rate over whole cycles is still the -b rate.  Streams wait
+ * for their next arrival on a one-shot timer.
+ *
+ * The size mix is applied by a snd wrapper, chained in the same way
+ * as the -F diskfile routines, so a test without --size-mix or
+ * --profile pays nothing for it.
+ *
+ * A trace is a profile whose arrivals and sizes come from a file.  It
+ * is read in place from the mapping, one record per write, and wraps
+ * around at the end.
+ *
+ * Rate schedules are kept here too.  They do not change how a stream
+ * sends, only how fast: the constant-rate throttle compares the bytes
+ * sent against the integral of the scheduled rate instead of against
+ * a fixed -b rate.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_profile.h"
+#include "timer.h"
+#include "units.h"
+#include "portable_endian.h"
+
+/* The classic 7:4:1 simple IMIX. */
+static const char imix_spec[] = "40:7,576:4,1500:1";
+
+#define TRACE_BINARY_MAGIC "IPTR"
+#define TRACE_BINARY_VERSION 1
+#define TRACE_BINARY_HEADER 8
+#define TRACE_BINARY_RECORD 8
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_HEADER 24
+#define PCAP_RECORD 16
+
+struct iperf_profile *
+iperf_profile_new(void)
+{
+    struct iperf_profile *pf;
+
+    pf = (struct iperf_profile *) malloc(sizeof(struct iperf_profile));
+    if (pf == NULL)
+	return NULL;
+    memset(pf, 0, sizeof(struct iperf_profile));
+    pf->type = PROFILE_CBR;
+    pf->burst = 1;
+    strcpy(pf->spec, "cbr");
+    return pf;
+}
+
+void
+iperf_profile_free(struct iperf_profile *pf)
+{
+    if (pf->trace_map != NULL)
+	munmap(pf->trace_map, pf->trace_len);
+    free(pf);
+}
+
+/* Parse a positive integer that must use up the whole field. */
+static int
+parse_count(const char *s, int max)
+{
+    char *end;
+    long v;
+
+    v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v <= 0 || v > max)
+	return -1;
+    return (int) v;
+}
+
+int
+iperf_profile_parse(struct iperf_profile *pf, const char *spec)
+{
+    char buf[PROFILE_MAX_SPEC];
+    char *fields[4];
+    char *cp, *end;
+    int nfields;
+
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    /* Split on colons. */
+    nfields = 0;
+    fields[nfields++] = buf;
+    for (cp = buf; *cp != '\0'; ++cp)
+	if (*cp == ':') {
+	    if (nfields == 4)
+		goto bad;
+	    *cp = '\0';
+	    fields[nfields++] = cp + 1;
+	}
+
+    pf->burst = 1;
+    if (strcmp(fields[0], "trace") == 0) {
+	/* The schedule comes from iperf_profile_load_trace. */
+	if (nfields != 1)
+	    goto bad;
+	pf->type = PROFILE_TRACE;
+    } else if (strcmp(fields[0], "cbr") == 0) {
+	if (nfields != 1)
+	    goto bad;
+	pf->type = PROFILE_CBR;
+    } else if (strcmp(fields[0], "poisson") == 0) {
+	if (nfields > 2)
+	    goto bad;
+	pf->type = PROFILE_POISSON;
+	if (nfields == 2 && (pf->burst = parse_count(fields[1], MAX_BURST)) < 0)
+	    goto bad;
+    } else if (strcmp(fields[0], "onoff") == 0) {
+	if (nfields < 3)
+	    goto bad;
+	pf->type = PROFILE_ONOFF;
+	if ((pf->period_ms = parse_count(fields[1], MAX_TIME * 1000)) < 0)
+	    goto bad;
+	pf->duty = strtod(fields[2], &end);
+	if (end == fields[2] || *end != '\0' || !(pf->duty > 0 && pf->duty <= 1))
+	    goto bad;
+	if (nfields == 4 && (pf->burst = parse_count(fields[3], MAX_BURST)) < 0)
+	    goto bad;
+    } else
+	goto bad;
+
+    strcpy(pf->spec, spec);
+    return 0;
+
+  bad:
+    i_errno = IEPROFILE;
+    return -1;
+}
+
+int
+iperf_profile_parse_sizes(struct iperf_profile *pf, const char *spec)
+{
+    char buf[PROFILE_MAX_SPEC];
+    char *entry, *next, *colon;
+    int n, size, weight;
+    double sum;
+
+    if (strcmp(spec, "imix") == 0)
+	spec = imix_spec;
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    n = 0;
+    pf->total_weight = 0;
+    pf->min_size = MAX_BLOCKSIZE;
+    pf->max_size = 0;
+    sum = 0;
+    for (entry = buf; entry != NULL; entry = next) {
+	next = strchr(entry, ',');
+	if (next != NULL)
+	    *next++ = '\0';
+	colon = strchr(entry, ':');
+	if (colon == NULL || n == PROFILE_MAX_SIZES)
+	    goto bad;
+	*colon = '\0';
+	if ((size = parse_count(entry, MAX_BLOCKSIZE)) < 0 ||
+	    (weight = parse_count(colon + 1, 1000000)) < 0)
+	    goto bad;
+	pf->sizes[n] = size;
+	pf->weights[n] = weight;
+	pf->total_weight += weight;
+	if (size < pf->min_size)
+	    pf->min_size = size;
+	if (size > pf->max_size)
+	    pf->max_size = size;
+	sum += (double) size * weight;
+	++n;
+    }
+    pf->nsizes = n;
+    pf->mean_size = sum / pf->total_weight;
+
+    strcpy(pf->size_spec, spec);
+    return 0;
+
+  bad:
+    pf->nsizes = 0;
+    i_errno = IESIZEMIX;
+    return -1;
+}
+
+static uint32_t
+pcap_u32(struct iperf_profile *pf, const char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return pf->trace_pcap_swap ? ((v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24)) : v;
+}
+
+/*
+ * Read the trace record at *cursor and move *cursor past it.  *t is
+ * the gap since the previous record in seconds, except for pcap files
+ * where it is the packet's absolute timestamp.  Returns 0, or -1 at
+ * the end of the trace or on a malformed record.
+ */
+static int
+trace_read(struct iperf_profile *pf, size_t *cursor, double *t, int *size)
+{
+    const char *rec, *nl;
+    char line[128];
+    size_t left, n;
+    uint32_t v;
+    char *cp;
+
+    switch (pf->trace_format) {
+	case TRACE_BINARY:
+	    if (pf->trace_len - *cursor < TRACE_BINARY_RECORD)
+		return -1;
+	    rec = pf->trace_map + *cursor;
+	    memcpy(&v, rec, sizeof(v));
+	    *t = be32toh(v) / 1e9;
+	    memcpy(&v, rec + 4, sizeof(v));
+	    *size = be32toh(v);
+	    *cursor += TRACE_BINARY_RECORD;
+	    return 0;
+
+	case TRACE_PCAP:
+	    if (pf->trace_len - *cursor < PCAP_RECORD)
+		return -1;
+	    rec = pf->trace_map + *cursor;
+	    n = pcap_u32(pf, rec + 8);	/* captured length */
+	    if (pf->trace_len - *cursor - PCAP_RECORD < n)
+		return -1;
+	    *t = pcap_u32(pf, rec) + pcap_u32(pf, rec + 4) / (pf->trace_pcap_nsec ? 1e9 : 1e6);
+	    *size = pcap_u32(pf, rec + 12);	/* length on the wire */
+	    *cursor += PCAP_RECORD + n;
+	    return 0;
+
+	default:
+	    while (*cursor < pf->trace_len) {
+		rec = pf->trace_map + *cursor;
+		left = pf->trace_len - *cursor;
+		nl = memchr(rec, '\n', left);
+		n = nl != NULL ? nl - rec : left;
+		*cursor += nl != NULL ? n + 1 : n;
+		if (n >= sizeof(line))
+		    return -1;
+		memcpy(line, rec, n);
+		line[n] = '\0';
+		for (cp = line; *cp == ' ' || *cp == '\t'; ++cp)
+		    ;
+		/* Headers, comments and blank lines. */
+		if (!((*cp >= '0' && *cp <= '9') || *cp == '.'))
+		    continue;
+		*t = strtod(cp, &cp) / 1e6;
+		while (*cp == ' ' || *cp == '\t' || *cp == ',')
+		    ++cp;
+		*size = strtol(cp, &cp, 10);
+		return 0;
+	    }
+	    return -1;
+    }
+}
+
+int
+iperf_profile_load_trace(struct iperf_profile *pf, const char *spec)
+{
+    char path[PROFILE_MAX_SPEC];
+    char *comma, *end;
+    struct stat st;
+    uint32_t magic;
+    size_t cursor;
+    double t;
+    int fd, size;
+
+    if (strlen(spec) >= sizeof(path)) {
+	errno = ENAMETOOLONG;
+	goto bad;
+    }
+    strcpy(path, spec);
+    pf->trace_stride = 0;
+    if ((comma = strrchr(path, ',')) != NULL) {
+	*comma = '\0';
+	pf->trace_stride = strtol(comma + 1, &end, 10);
+	if (end == comma + 1 || *end != '\0' || pf->trace_stride < 0) {
+	    errno = EINVAL;
+	    goto bad;
+	}
+    }
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+	goto bad;
+    if (fstat(fd, &st) < 0) {
+	close(fd);
+	goto bad;
+    }
+    if (st.st_size == 0) {
+	close(fd);
+	errno = EINVAL;
+	goto bad;
+    }
+    pf->trace_len = st.st_size;
+    pf->trace_map = mmap(NULL, pf->trace_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pf->trace_map == MAP_FAILED) {
+	pf->trace_map = NULL;
+	goto bad;
+    }
+
+    /* Work out the format from the first bytes. */
+    pf->trace_format = TRACE_CSV;
+    pf->trace_start = 0;
+    if (pf->trace_len >= 4) {
+	memcpy(&magic, pf->trace_map, sizeof(magic));
+	if (memcmp(pf->trace_map, TRACE_BINARY_MAGIC, 4) == 0) {
+	    if (pf->trace_len < TRACE_BINARY_HEADER) {
+		errno = EINVAL;
+		goto bad;
+	    }
+	    memcpy(&magic, pf->trace_map + 4, sizeof(magic));
+	    if (be32toh(magic) != TRACE_BINARY_VERSION) {
+		errno = EINVAL;
+		goto bad;
+	    }
+	    pf->trace_format = TRACE_BINARY;
+	    pf->trace_start = TRACE_BINARY_HEADER;
+	} else if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NSEC ||
+		   be32toh(magic) == PCAP_MAGIC || be32toh(magic) == PCAP_MAGIC_NSEC ||
+		   le32toh(magic) == PCAP_MAGIC || le32toh(magic) == PCAP_MAGIC_NSEC) {
+	    if (pf->trace_len < PCAP_HEADER) {
+		errno = EINVAL;
+		goto bad;
+	    }
+	    pf->trace_format = TRACE_PCAP;
+	    pf->trace_start = PCAP_HEADER;
+	    pf->trace_pcap_swap = magic != PCAP_MAGIC && magic != PCAP_MAGIC_NSEC;
+	    magic = pcap_u32(pf, pf->trace_map);
+	    pf->trace_pcap_nsec = magic == PCAP_MAGIC_NSEC;
+	}
+    }
+
+    /* Check every record once, so the replay never meets a bad one. */
+    pf->trace_records = 0;
+    pf->trace_max_size = 0;
+    cursor = pf->trace_start;
+    while (cursor < pf->trace_len) {
+	if (trace_read(pf, &cursor, &t, &size) < 0) {
+	    /* Trailing blank lines and comments are fine. */
+	    if (pf->trace_format == TRACE_CSV && cursor >= pf->trace_len)
+		break;
+	    errno = EINVAL;
+	    goto bad;
+	}
+	if (t < 0 || size <= 0) {
+	    errno = EINVAL;
+	    goto bad;
+	}
+	if (size > pf->trace_max_size)
+	    pf->trace_max_size = size;
+	++pf->trace_records;
+    }
+    if (pf->trace_records == 0) {
+	errno = EINVAL;
+	goto bad;
+    }
+
+    pf->type = PROFILE_TRACE;
+    pf->burst = 1;
+    strcpy(pf->spec, "trace");
+    return 0;
+
+  bad:
+    if (pf->trace_map != NULL) {
+	munmap(pf->trace_map, pf->trace_len);
+	pf->trace_map = NULL;
+    }
+    i_errno = IETRACE;
+    return -1;
+}
+
+/*
+ * Load the stream's next trace record: when it is due and how big a
+ * write it asks for.  The trace wraps around at the end; for a pcap
+ * the first packet after wrapping is sent without a gap.
+ */
+static void
+trace_next(struct iperf_stream *sp)
+{
+    struct iperf_test *test = sp->test;
+    struct iperf_profile *pf = test->profile;
+    double t;
+    int size, min_size;
+
+    if (trace_read(pf, &sp->profile_cursor, &t, &size) < 0) {
+	sp->profile_cursor = pf->trace_start;
+	sp->profile_trace_ts = 0;
+	(void) trace_read(pf, &sp->profile_cursor, &t, &size);
+    }
+    if (pf->trace_format == TRACE_PCAP) {
+	double ts = t;
+
+	t = sp->profile_trace_ts != 0 && ts > sp->profile_trace_ts ? ts - sp->profile_trace_ts : 0;
+	sp->profile_trace_ts = ts;
+    }
+    sp->profile_vtime += t;
+    sp->profile_next = sp->profile_epoch + sp->profile_vtime;
+
+    /* Records that don't fit a test packet are trimmed or padded. */
+    min_size = test->protocol->id == Pudp ? (test->udp_counters_64bit ? 16 : 12) : 1;
+    if (size > test->settings->blksize)
+	size = test->settings->blksize;
+    if (size < min_size)
+	size = min_size;
+    sp->send_size = size;
+}
+
+/* Position a stream at its starting record and load that record. */
+static void
+trace_begin(struct iperf_stream *sp)
+{
+    struct iperf_profile *pf = sp->test->profile;
+    long skip;
+    double t;
+    int size;
+
+    sp->profile_cursor = pf->trace_start;
+    sp->profile_trace_ts = 0;
+    skip = (pf->trace_stride * (sp->id - 1)) % pf->trace_records;
+    while (skip-- > 0)
+	(void) trace_read(pf, &sp->profile_cursor, &t, &size);
+    trace_next(sp);
+}
+
+int
+iperf_profile_scheduled(struct iperf_test *test)
+{
+    return test->profile != NULL && test->profile->type != PROFILE_CBR;
+}
+
+/* Pick the length of the next write from the size mix. */
+static int
+profile_pick_size(struct iperf_profile *pf, unsigned short seed[3])
+{
+    int i, w;
+
+    w = (int) (erand48(seed) * pf->total_weight);
+    for (i = 0; i < pf->nsizes - 1; ++i) {
+	if (w < pf->weights[i])
+	    break;
+	w -= pf->weights[i];
+    }
+    return pf->sizes[i];
+}
+
+/*
+ * Move the stream's schedule on to its next arrival.  profile_vtime is
+ * measured in on time; for an on/off source it is mapped back to wall
+ * clock time by inserting the off part of every cycle.
+ */
+static void
+profile_advance(struct iperf_stream *sp)
+{
+    struct iperf_test *test = sp->test;
+    struct iperf_profile *pf = test->profile;
+    double mean_size, gap, on_len, cycles;
+
+    if (pf->type == PROFILE_TRACE) {
+	trace_next(sp);
+	return;
+    }
+    mean_size = pf->nsizes > 0 ? pf->mean_size : test->settings->blksize;
+    gap = pf->burst * mean_size * 8 / test->settings->rate;
+
+    switch (pf->type) {
+	case PROFILE_POISSON:
+	    sp->profile_vtime += -log(1.0 - erand48(sp->profile_seed)) * gap;
+	    sp->profile_next = sp->profile_epoch + sp->profile_vtime;
+	    break;
+	case PROFILE_ONOFF:
+	    on_len = pf->duty * pf->period_ms / 1000.0;
+	    sp->profile_vtime += gap * pf->duty;
+	    cycles = floor(sp->profile_vtime / on_len);
+	    sp->profile_next = sp->profile_epoch + cycles * pf->period_ms / 1000.0 +
+		(sp->profile_vtime - cycles * on_len);
+	    break;
+    }
+}
+
+/*
+ * snd wrapper: pick the write size, call the protocol's send routine
+ * and account the write against the current arrival's burst.
+ */
+static int
+profile_send(struct iperf_stream *sp)
+{
+    struct iperf_profile *pf = sp->test->profile;
+    int r;
+
+    if (pf->nsizes > 0)
+	sp->send_size = profile_pick_size(pf, sp->profile_seed);
+    r = sp->snd2(sp);
+    if (r > 0 && sp->profile_burst_left > 0 && --sp->profile_burst_left == 0)
+	profile_advance(sp);
+    return r;
+}
+
+void
+iperf_profile_attach(struct iperf_stream *sp)
+{
+    long seed = random();
+
+    sp->profile_seed[0] = 0x330e;
+    sp->profile_seed[1] = seed & 0xffff;
+    sp->profile_seed[2] = (seed >> 16) & 0xffff;
+    sp->profile_next = 0;
+    sp->profile_vtime = 0;
+    sp->profile_burst_left = 0;
+
+    sp->snd2 = sp->snd;
+    sp->snd = profile_send;
+}
+
+static void
+profile_timer_proc(TimerClientData client_data, struct timeval *nowP)
+{
+    struct iperf_stream *sp = client_data.p;
+
+    /* One-shot timers are released by the timer code once they run. */
+    sp->send_timer = NULL;
+    iperf_check_throttle(sp, nowP);
+}
+
+int
+iperf_profile_check(struct iperf_stream *sp, struct timeval *nowP)
+{
+    double now = nowP->tv_sec + nowP->tv_usec / 1000000.0;
+    TimerClientData cd;
+
+    if (sp->profile_burst_left > 0)
+	return 1;
+    if (sp->profile_next == 0) {
+	sp->profile_next = sp->profile_epoch = now;
+	if (sp->test->profile->type == PROFILE_TRACE)
+	    trace_begin(sp);
+    }
+    /* Timers have microsecond resolution. */
+    if (sp->profile_next <= now + 0.000001) {
+	sp->profile_burst_left = sp->test->profile->burst;
+	return 1;
+    }
+    if (sp->send_timer == NULL) {
+	cd.p = sp;
+	sp->send_timer = tmr_create(nowP, profile_timer_proc, cd, (int64_t) ceil((sp->profile_next - now) * SEC_TO_US), 0);
+	/* Without a wakeup the stream would stall; send early instead. */
+	if (sp->send_timer == NULL) {
+	    sp->profile_burst_left = sp->test->profile->burst;
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+const char *
+iperf_profile_describe(struct iperf_profile *pf)
+{
+    static char buf[2 * PROFILE_MAX_SPEC + 100];
+    int len;
+
+    switch (pf->type) {
+	case PROFILE_POISSON:
+	    len = snprintf(buf, sizeof(buf), "Poisson arrivals, %d write%s per arrival", pf->burst, pf->burst == 1 ? "" : "s");
+	    break;
+	case PROFILE_ONOFF:
+	    len = snprintf(buf, sizeof(buf), "on/off, %d ms cycle at %g%% duty, %d write%s per arrival", pf->period_ms, pf->duty * 100, pf->burst, pf->burst == 1 ? "" : "s");
+	    break;
+	case PROFILE_TRACE:
+	    if (pf->trace_map != NULL)
+		len = snprintf(buf, sizeof(buf), "trace replay, %ld records, stride %ld", pf->trace_records, pf->trace_stride);
+	    else
+		len = snprintf(buf, sizeof(buf), "trace replay");
+	    break;
+	default:
+	    len = snprintf(buf, sizeof(buf), "constant rate");
+	    break;
+    }
+    if (pf->nsizes > 0 && len < sizeof(buf))
+	snprintf(buf + len, sizeof(buf) - len, ", write sizes %s (mean %.0f bytes)", pf->size_spec, pf->mean_size);
+    return buf;
+}
+
+/* Parse a non-negative rate, with the usual K/M/G suffixes. */
+static int
+parse_rate(const char *s, double *rate)
+{
+    char *end;
+
+    if (strtod(s, &end) < 0 || end == s)
+	return -1;
+    /* Only a single unit letter may follow the number. */
+    if (*end != '\0' && end[1] != '\0')
+	return -1;
+    *rate = unit_atof_rate(s);
+    return 0;
+}
+
+struct iperf_rate_schedule *
+iperf_rate_schedule_parse(const char *spec)
+{
+    struct iperf_rate_schedule *rs;
+    char buf[PROFILE_MAX_SPEC];
+    char *fields[5];
+    char *cp, *end;
+    int nfields;
+
+    rs = (struct iperf_rate_schedule *) malloc(sizeof(struct iperf_rate_schedule));
+    if (rs == NULL) {
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    memset(rs, 0, sizeof(struct iperf_rate_schedule));
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    nfields = 0;
+    fields[nfields++] = buf;
+    for (cp = buf; *cp != '\0'; ++cp)
+	if (*cp == ':') {
+	    if (nfields == 5)
+		goto bad;
+	    *cp = '\0';
+	    fields[nfields++] = cp + 1;
+	}
+    if (nfields < 3 ||
+	parse_rate(fields[1], &rs->start) < 0 ||
+	parse_rate(fields[2], &rs->stop) < 0 ||
+	(rs->start == 0 && rs->stop == 0))
+	goto bad;
+
+    if (strcmp(fields[0], "step") == 0) {
+	if (nfields != 5 || parse_rate(fields[3], &rs->incr) < 0 || rs->incr <= 0)
+	    goto bad;
+	rs->type = RATE_SCHEDULE_STEP;
+	/* A last, partial step is clipped to stop. */
+	rs->nsteps = (int) ceil(fabs(rs->stop - rs->start) / rs->incr - 1e-9);
+	if (rs->stop < rs->start)
+	    rs->incr = -rs->incr;
+    } else if (strcmp(fields[0], "ramp") == 0) {
+	if (nfields > 4)
+	    goto bad;
+	rs->type = RATE_SCHEDULE_RAMP;
+    } else
+	goto bad;
+
+    /* The last field, if there is one, is the step or ramp length. */
+    if (nfields == 4 || nfields == 5) {
+	rs->secs = strtod(fields[nfields - 1], &end);
+	if (end == fields[nfields - 1] || *end != '\0' ||
+	    !(rs->secs >= MIN_INTERVAL && rs->secs <= MAX_TIME))
+	    goto bad;
+    }
+
+    strcpy(rs->spec, spec);
+    return rs;
+
+  bad:
+    free(rs);
+    i_errno = IERATESCHEDULE;
+    return NULL;
+}
+
+int
+iperf_rate_schedule_resolve(struct iperf_rate_schedule *rs, int duration)
+{
+    if (rs->secs == 0) {
+	if (duration == 0) {
+	    i_errno = IERATESCHEDULE;
+	    return -1;
+	}
+	rs->secs = duration;
+    }
+    return 0;
+}
+
+/*
+ * The schedule is piecewise linear (or piecewise constant), so the
+ * bits due by time t have a closed form; the throttle never has to
+ * walk the steps.
+ */
+double
+iperf_rate_schedule_bits(struct iperf_rate_schedule *rs, double t)
+{
+    double k;
+
+    if (t <= 0)
+	return 0;
+    switch (rs->type) {
+	case RATE_SCHEDULE_STEP:
+	    k = floor(t / rs->secs);
+	    if (k < rs->nsteps)
+		return rs->secs * (k * rs->start + rs->incr * k * (k - 1) / 2) +
+		    (rs->start + k * rs->incr) * (t - k * rs->secs);
+	    k = rs->nsteps;
+	    return rs->secs * (k * rs->start + rs->incr * k * (k - 1) / 2) +
+		rs->stop * (t - k * rs->secs);
+	case RATE_SCHEDULE_RAMP:
+	    if (t <= rs->secs)
+		return rs->start * t + (rs->stop - rs->start) * t * t / (2 * rs->secs);
+	    return (rs->start + rs->stop) * rs->secs / 2 + rs->stop * (t - rs->secs);
+    }
+    return 0;
+}
+
+int
+iperf_rate_schedule_step(struct iperf_rate_schedule *rs, double t)
+{
+    int k;
+
+    if (rs->type != RATE_SCHEDULE_STEP || t <= 0)
+	return 0;
+    k = (int) floor(t / rs->secs);
+    return k < rs->nsteps ? k : rs->nsteps;
+}
+
+double
+iperf_rate_schedule_peak(struct iperf_rate_schedule *rs)
+{
+    return rs->start > rs->stop ? rs->start : rs->stop;
+}
@@ -0,0 +1,223 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_PROFILE_H
+#define __IPERF_PROFILE_H
+
+#include <sys/time.h>
+
+/*
+ * Traffic profiles (--profile) and packet size mixes (--size-mix).
+ *
+ * A profile replaces the constant-rate send throttle with a schedule
+ * of arrivals whose long-term average is still the -b target rate.
+ * Each arrival releases a burst of one or more writes.  A size mix
+ * picks the length of every write from a weighted table; all sizes
+ * are sent out of the stream's existing blksize buffer.
+ *
+ * A trace (--trace) replays recorded inter-arrival times and sizes
+ * instead.  The file is memory-mapped and read record by record as
+ * the streams go; it can be
+ *   - CSV: one "delta_usec,size" record per line; lines that do not
+ *     start with a number (headers, # comments) are skipped,
+ *   - binary: the magic "IPTR", a 32-bit version (1), then records of
+ *     a 32-bit delta in nanoseconds and a 32-bit size, all big-endian,
+ *   - a classic libpcap capture, using each packet's timestamp and
+ *     original length.
+ */
+
+/* profile types */
+#define PROFILE_CBR 0		/* constant rate, the default throttle */
+#define PROFILE_POISSON 1	/* exponentially distributed inter-arrivals */
+#define PROFILE_ONOFF 2		/* periodic on/off source */
+#define PROFILE_TRACE 3		/* replay of a recorded trace */
+
+/* trace file formats */
+#define TRACE_CSV 0
+#define TRACE_BINARY 1
+#define TRACE_PCAP 2
+
+#define PROFILE_MAX_SIZES 16
+#define PROFILE_MAX_SPEC 256
+
+struct iperf_profile
+{
+    int       type;
+    int       burst;			/* writes per arrival */
+    int       period_ms;		/* on/off: length of one on+off cycle */
+    double    duty;			/* on/off: fraction of the cycle spent on */
+
+    int       nsizes;			/* 0 means every write is blksize */
+    int       sizes[PROFILE_MAX_SIZES];
+    int       weights[PROFILE_MAX_SIZES];
+    int       total_weight;
+    int       min_size;
+    int       max_size;
+    double    mean_size;
+
+    /* --trace replay (sender only) */
+    char     *trace_map;		/* the mmapped file, or NULL */
+    size_t    trace_len;
+    size_t    trace_start;		/* offset of the first record */
+    int       trace_format;
+    int       trace_pcap_swap;		/* pcap written with the other byte order */
+    int       trace_pcap_nsec;		/* pcap timestamps are in nanoseconds */
+    long      trace_records;
+    long      trace_stride;		/* records between the streams' start points */
+    int       trace_max_size;
+
+    /* the option strings, as given, for the parameter exchange */
+    char      spec[PROFILE_MAX_SPEC];
+    char      size_spec[PROFILE_MAX_SPEC];
+};
+
+/*
+ * Rate schedules (--rate-schedule) change the per-stream target rate
+ * while the test runs, either in steps or as a linear ramp.  Time is
+ * measured from the start of each stream's (non-omitted) run, on the
+ * sender and the receiver alike, so both label intervals the same way.
+ */
+#define RATE_SCHEDULE_STEP 1	/* start, start+incr, ... stop; secs per step */
+#define RATE_SCHEDULE_RAMP 2	/* linear from start to stop over secs */
+
+struct iperf_rate_schedule
+{
+    int       type;
+    double    start;			/* bits per second */
+    double    stop;
+    double    incr;			/* step: rate change per step, signed */
+    double    secs;			/* step: length of a step; ramp: length of the ramp */
+    int       nsteps;			/* step: number of rate changes */
+    char      spec[PROFILE_MAX_SPEC];
+};
+
+struct iperf_test;
+struct iperf_stream;
+
+/**
+ * iperf_profile_new -- allocate a profile that describes constant-rate
+ * traffic with fixed-size writes
+ *
+ */
+struct iperf_profile *iperf_profile_new(void);
+
+void iperf_profile_free(struct iperf_profile *);
+
+/**
+ * iperf_profile_parse -- parse a --profile spec:
+ *   cbr | poisson[:burst] | onoff:period_ms:duty[:burst]
+ *
+ * returns 0 on success, -1 and sets i_errno to IEPROFILE on error
+ *
+ */
+int iperf_profile_parse(struct iperf_profile *, const char *spec);
+
+/**
+ * iperf_profile_parse_sizes -- parse a --size-mix spec:
+ *   imix | size:weight[,size:weight...]
+ *
+ * returns 0 on success, -1 and sets i_errno to IESIZEMIX on error
+ *
+ */
+int iperf_profile_parse_sizes(struct iperf_profile *, const char *spec);
+
+/**
+ * iperf_profile_load_trace -- map and validate a --trace file:
+ *   file[,stride]
+ * where stream n starts (n - 1) * stride records into the trace
+ *
+ * returns 0 on success, -1 and sets i_errno to IETRACE on error
+ *
+ */
+int iperf_profile_load_trace(struct iperf_profile *, const char *spec);
+
+/**
+ * iperf_profile_attach -- set up a new sending stream to follow the
+ * test's profile
+ *
+ */
+void iperf_profile_attach(struct iperf_stream *);
+
+/**
+ * iperf_profile_check -- whether a scheduled stream may send now.  If
+ * not, a one-shot timer is armed for the next arrival.
+ *
+ */
+int iperf_profile_check(struct iperf_stream *, struct timeval *nowP);
+
+/**
+ * iperf_profile_scheduled -- whether the test sends on a profile
+ * schedule rather than through the constant-rate throttle
+ *
+ */
+int iperf_profile_scheduled(struct iperf_test *);
+
+/**
+ * iperf_profile_describe -- human-readable summary of the profile
+ *
+ */
+const char *iperf_profile_describe(struct iperf_profile *);
+
+/**
+ * iperf_rate_schedule_parse -- parse a --rate-schedule spec:
+ *   step:start:stop:incr:secs | ramp:start:stop[:secs]
+ * where a ramp without secs lasts for the whole test
+ *
+ * returns a new schedule, or NULL and sets i_errno to IERATESCHEDULE
+ *
+ */
+struct iperf_rate_schedule *iperf_rate_schedule_parse(const char *spec);
+
+/**
+ * iperf_rate_schedule_resolve -- fit the schedule to a test of the
+ * given duration; a ramp without a length of its own needs one
+ *
+ * returns 0 on success, -1 and sets i_errno to IERATESCHEDULE on error
+ *
+ */
+int iperf_rate_schedule_resolve(struct iperf_rate_schedule *, int duration);
+
+/**
+ * iperf_rate_schedule_bits -- bits a stream should have sent t seconds
+ * into the schedule
+ *
+ */
+double iperf_rate_schedule_bits(struct iperf_rate_schedule *, double t);
+
+/**
+ * iperf_rate_schedule_step -- which step is in effect t seconds into
+ * the schedule (always 0 for a ramp)
+ *
+ */
+int iperf_rate_schedule_step(struct iperf_rate_schedule *, double t);
+
+/**
+ * iperf_rate_schedule_peak -- the highest rate the schedule reaches
+ *
+ */
+double iperf_rate_schedule_peak(struct iperf_rate_schedule *);
+
+#endif
@@ -0,0 +1,811 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_rr.c
+ *
+ * Request/response transactions.  The streams are set up, reported
+ * and torn down like any other TCP streams; this file only replaces
+ * their send and receive routines and keeps the round-trip times.
+ * For --crr it also opens, and on the server accepts, a connection for
+ * every transaction.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_rr.h"
+#include "iperf_metrics.h"
+#include "net.h"
+#include "units.h"
+
+/* Parse a positive size, with the usual K/M/G suffixes. */
+static int
+parse_size(const char *s, int *size)
+{
+    char *end;
+    iperf_size_t n;
+
+    if (strtod(s, &end) <= 0 || end == s)
+	return -1;
+    if (*end != '\0' && end[1] != '\0')
+	return -1;
+    n = unit_atoi(s);
+    if (n == 0 || n > MAX_BLOCKSIZE)
+	return -1;
+    *size = (int) n;
+    return 0;
+}
+
+struct iperf_rr *
+iperf_rr_parse(const char *spec)
+{
+    struct iperf_rr *rr;
+    char buf[RR_MAX_SPEC];
+    char *fields[3];
+    char *cp, *end;
+    int nfields;
+    long depth;
+
+    rr = (struct iperf_rr *) malloc(sizeof(struct iperf_rr));
+    if (rr == NULL) {
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    memset(rr, 0, sizeof(struct iperf_rr));
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    nfields = 0;
+    fields[nfields++] = buf;
+    for (cp = buf; *cp != '\0'; ++cp)
+	if (*cp == ':') {
+	    if (nfields == 3)
+		goto bad;
+	    *cp = '\0';
+	    fields[nfields++] = cp + 1;
+	}
+    if (parse_size(fields[0], &rr->request) < 0)
+	goto bad;
+    rr->response = rr->request;
+    if (nfields >= 2 && parse_size(fields[1], &rr->response) < 0)
+	goto bad;
+    rr->depth = 1;
+    if (nfields == 3) {
+	depth = strtol(fields[2], &end, 10);
+	if (end == fields[2] || *end != '\0' || depth < 1 || depth > RR_MAX_DEPTH)
+	    goto bad;
+	rr->depth = depth;
+    }
+    strcpy(rr->spec, spec);
+    return rr;
+
+  bad:
+    free(rr);
+    i_errno = IERR;
+    return NULL;
+}
+
+static uint64_t
+rr_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * SEC_TO_NS + (uint64_t) ts.tv_nsec;
+}
+
+/*
+ * A client stream may write while it is part way through a request or
+ * has room in the pipeline; otherwise it waits for a response.
+ */
+static void
+rr_set_green_light(struct iperf_stream *sp)
+{
+    if (sp->rr_write_left > 0 || sp->rr_inflight < sp->test->rr->depth) {
+	sp->green_light = 1;
+	FD_SET(sp->socket, &sp->test->write_set);
+    } else {
+	sp->green_light = 0;
+	FD_CLR(sp->socket, &sp->test->write_set);
+    }
+}
+
+/* Client: start a request if there is room, and write what we can of it. */
+static int
+rr_send_request(struct iperf_stream *sp)
+{
+    struct iperf_rr *rr = sp->test->rr;
+    int r;
+
+    if (sp->rr_write_left == 0) {
+	if (sp->rr_inflight >= rr->depth) {
+	    rr_set_green_light(sp);
+	    return 0;
+	}
+	sp->rr_sent[(sp->rr_head + sp->rr_inflight) % rr->depth] = rr_now();
+	++sp->rr_inflight;
+	sp->rr_write_left = rr->request;
+    }
+
+    r = Nwrite_counted(sp->socket, sp->buffer, sp->rr_write_left, Ptcp, &sp->io);
+    if (r < 0)
+	return r;
+    sp->rr_write_left -= r;
+    sp->result->bytes_sent += r;
+    sp->result->bytes_sent_this_interval += r;
+    rr_set_green_light(sp);
+
+    return r;
+}
+
+/* Client: read responses, and time the requests they complete. */
+static int
+rr_recv_response(struct iperf_stream *sp)
+{
+    struct iperf_rr *rr = sp->test->rr;
+    uint64_t now;
+    int r;
+
+    r = Nread_counted(sp->socket, sp->buffer, sp->settings->blksize, Ptcp, &sp->io);
+    if (r < 0)
+	return r;
+    sp->result->bytes_received += r;
+    sp->result->bytes_received_this_interval += r;
+
+    sp->rr_read_acc += r;
+    now = rr_now();
+    while (sp->rr_read_acc >= rr->response && sp->rr_inflight > 0) {
+	sp->rr_read_acc -= rr->response;
+	iperf_histogram_record(sp->rr_hist, (int64_t) (now - sp->rr_sent[sp->rr_head]));
+	iperf_histogram_record(sp->rr_hist_interval, (int64_t) (now - sp->rr_sent[sp->rr_head]));
+	sp->rr_head = (sp->rr_head + 1) % rr->depth;
+	--sp->rr_inflight;
+	++sp->rr_transactions;
+	++sp->rr_transactions_this_interval;
+    }
+    rr_set_green_light(sp);
+
+    return r;
+}
+
+/* Server: write as much of the owed responses as the socket takes. */
+static int
+rr_flush_responses(struct iperf_stream *sp)
+{
+    int n, r;
+
+    while (sp->rr_write_left > 0) {
+	n = sp->rr_write_left < sp->settings->blksize ? sp->rr_write_left : sp->settings->blksize;
+	r = Nwrite_counted(sp->socket, sp->buffer, n, Ptcp, &sp->io);
+	if (r == 0 || r == NET_SOFTERROR)
+	    break;
+	if (r < 0)
+	    return r;
+	sp->rr_write_left -= r;
+	sp->result->bytes_sent += r;
+	sp->result->bytes_sent_this_interval += r;
+    }
+    return 0;
+}
+
+/*
+ * Server: read requests and answer each complete one.  While the
+ * client is not taking its responses we stop reading, so that the
+ * requests back up in TCP rather than in here.
+ */
+static int
+rr_answer_requests(struct iperf_stream *sp)
+{
+    struct iperf_rr *rr = sp->test->rr;
+    int r, n;
+
+    if ((r = rr_flush_responses(sp)) < 0)
+	return r;
+    if (sp->rr_write_left > 0)
+	return 0;
+
+    r = Nread_counted(sp->socket, sp->buffer, sp->settings->blksize, Ptcp, &sp->io);
+    if (r < 0)
+	return r;
+    sp->result->bytes_received += r;
+    sp->result->bytes_received_this_interval += r;
+
+    sp->rr_read_acc += r;
+    n = sp->rr_read_acc / rr->request;
+    sp->rr_read_acc -= n * rr->request;
+    sp->rr_write_left += (iperf_size_t) n * rr->response;
+    sp->rr_transactions += n;
+    sp->rr_transactions_this_interval += n;
+    if (rr_flush_responses(sp) < 0)
+	return NET_HARDERROR;
+
+    return r;
+}
+
+/* --crr connection states */
+#define CRR_IDLE 0
+#define CRR_CONNECTING 1		/* client: waiting for the connect */
+#define CRR_REQUEST 2			/* client writing, server reading the request */
+#define CRR_RESPONSE 3			/* server writing, client reading the response */
+
+#define CRR_HEADER_SIZE (COOKIE_SIZE + 4)	/* the cookie, then the stream id */
+
+struct iperf_crr_conn
+{
+    int       fd;			/* -1 when idle */
+    int       state;
+    int       done;			/* bytes of the current message moved */
+    uint64_t  start;			/* client: when the connect began, ns */
+    struct iperf_stream *sp;		/* server: whose request this is */
+    struct net_stats io;		/* server: reading the header, before sp is known */
+    char      header[CRR_HEADER_SIZE];
+};
+
+struct iperf_crr
+{
+    int       nconns;
+    struct iperf_crr_conn *conns;
+};
+
+static struct iperf_crr *
+crr_new(int nconns)
+{
+    struct iperf_crr *crr;
+    int i;
+
+    crr = (struct iperf_crr *) malloc(sizeof(struct iperf_crr) + nconns * sizeof(struct iperf_crr_conn));
+    if (crr == NULL)
+	return NULL;
+    crr->nconns = nconns;
+    crr->conns = (struct iperf_crr_conn *) (crr + 1);
+    memset(crr->conns, 0, nconns * sizeof(struct iperf_crr_conn));
+    for (i = 0; i < nconns; ++i)
+	crr->conns[i].fd = -1;
+    return crr;
+}
+
+static void
+crr_close(struct iperf_test *test, struct iperf_crr_conn *c)
+{
+    FD_CLR(c->fd, &test->read_set);
+    FD_CLR(c->fd, &test->write_set);
+    close(c->fd);
+    c->fd = -1;
+    c->state = CRR_IDLE;
+}
+
+static void
+crr_free(struct iperf_test *test, struct iperf_crr *crr)
+{
+    int i;
+
+    if (crr == NULL)
+	return;
+    for (i = 0; i < crr->nconns; ++i)
+	if (crr->conns[i].fd >= 0)
+	    crr_close(test, &crr->conns[i]);
+    free(crr);
+}
+
+static void
+crr_set_nodelay(int s)
+{
+    int opt = 1;
+
+    (void) setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *) &opt, sizeof(opt));
+}
+
+static socklen_t
+crr_addrlen(struct sockaddr_storage *sa)
+{
+    if (sa->ss_family == AF_INET6)
+	return sizeof(struct sockaddr_in6);
+    return sizeof(struct sockaddr_in);
+}
+
+/*
+ * Move what the socket takes of a message made of header bytes from
+ * the connection's header and len bytes from buf, counting the calls
+ * in ns.  Returns 1 when the message is complete, 0 if the socket
+ * would block, and -1 on error or (reading) if the peer closed early.
+ * Reads use read() directly because Nread cannot tell the end of the
+ * connection from EAGAIN.
+ */
+static int
+crr_write(struct iperf_crr_conn *c, char *buf, int header, int len, struct net_stats *ns)
+{
+    int r;
+
+    while (c->done < header + len) {
+	if (c->done < header)
+	    r = Nwrite_counted(c->fd, c->header + c->done, header - c->done, Ptcp, ns);
+	else
+	    r = Nwrite_counted(c->fd, buf, header + len - c->done, Ptcp, ns);
+	if (r < 0)
+	    return -1;
+	if (r == 0)
+	    return 0;
+	c->done += r;
+    }
+    return 1;
+}
+
+static int
+crr_read(struct iperf_crr_conn *c, char *buf, int header, int len, struct net_stats *ns)
+{
+    ssize_t r;
+    int want;
+
+    while (c->done < header + len) {
+	if (c->done < header) {
+	    want = header - c->done;
+	    r = read(c->fd, c->header + c->done, want);
+	} else {
+	    want = header + len - c->done;
+	    r = read(c->fd, buf, want);
+	}
+	++ns->calls;
+	if (r < 0) {
+	    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+		++ns->eagain;
+		return 0;
+	    }
+	    return -1;
+	}
+	if (r == 0)
+	    return -1;
+	ns->bytes += r;
+	if (r < want)
+	    ++ns->short_io;
+	c->done += r;
+    }
+    return 1;
+}
+
+/* Client: a connect or a transaction that did not complete. */
+static void
+crr_fail(struct iperf_stream *sp, struct iperf_crr_conn *c)
+{
+    if (c->fd >= 0)
+	crr_close(sp->test, c);
+    ++sp->crr_failures;
+    ++sp->crr_failures_this_interval;
+}
+
+/*
+ * Client: start a connection to the address the stream is connected
+ * to, and from the stream's own address if -B asked for one.
+ */
+static void
+crr_open(struct iperf_stream *sp, struct iperf_crr_conn *c)
+{
+    struct iperf_test *test = sp->test;
+    struct sockaddr_storage local;
+    int s;
+
+    if ((s = socket(sp->remote_addr.ss_family, SOCK_STREAM, 0)) < 0) {
+	crr_fail(sp, c);
+	return;
+    }
+    if (s >= FD_SETSIZE) {
+	close(s);
+	crr_fail(sp, c);
+	return;
+    }
+    c->fd = s;
+    setnonblocking(s, 1);
+    if (test->no_delay)
+	crr_set_nodelay(s);
+    if (test->bind_address != NULL) {
+	memcpy(&local, &sp->local_addr, sizeof(local));
+	if (local.ss_family == AF_INET6)
+	    ((struct sockaddr_in6 *) &local)->sin6_port = 0;
+	else
+	    ((struct sockaddr_in *) &local)->sin_port = 0;
+	if (bind(s, (struct sockaddr *) &local, crr_addrlen(&local)) < 0) {
+	    crr_fail(sp, c);
+	    return;
+	}
+    }
+    c->start = rr_now();
+    if (connect(s, (struct sockaddr *) &sp->remote_addr, crr_addrlen(&sp->remote_addr)) < 0 &&
+	errno != EINPROGRESS) {
+	crr_fail(sp, c);
+	return;
+    }
+    c->state = CRR_CONNECTING;
+    c->done = 0;
+    FD_SET(s, &test->write_set);
+    if (s > test->max_fd) test->max_fd = s;
+}
+
+/* Client: take one connection as far as it goes without blocking. */
+static void
+crr_client_step(struct iperf_stream *sp, struct iperf_crr_conn *c, fd_set *read_setP, fd_set *write_setP)
+{
+    struct iperf_test *test = sp->test;
+    struct iperf_rr *rr = test->rr;
+    socklen_t len;
+    uint64_t now;
+    uint32_t id;
+    int err, r;
+
+    switch (c->state) {
+	case CRR_CONNECTING:
+	    if (!FD_ISSET(c->fd, write_setP))
+		return;
+	    len = sizeof(err);
+	    if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, (char *) &err, &len) < 0 || err != 0) {
+		crr_fail(sp, c);
+		return;
+	    }
+	    now = rr_now();
+	    iperf_histogram_record(sp->crr_connect_hist, (int64_t) (now - c->start));
+	    iperf_histogram_record(sp->crr_connect_hist_interval, (int64_t) (now - c->start));
+	    memcpy(c->header, test->cookie, COOKIE_SIZE);
+	    id = htonl(sp->id);
+	    memcpy(c->header + COOKIE_SIZE, &id, sizeof(id));
+	    c->state = CRR_REQUEST;
+	    /* FALLTHROUGH */
+	case CRR_REQUEST:
+	    if (!FD_ISSET(c->fd, write_setP))
+		return;
+	    if ((r = crr_write(c, sp->buffer, CRR_HEADER_SIZE, rr->request, &sp->io)) < 0) {
+		crr_fail(sp, c);
+		return;
+	    }
+	    if (r == 0)
+		return;
+	    sp->result->bytes_sent += rr->request;
+	    sp->result->bytes_sent_this_interval += rr->request;
+	    FD_CLR(c->fd, &test->write_set);
+	    FD_SET(c->fd, &test->read_set);
+	    c->state = CRR_RESPONSE;
+	    c->done = 0;
+	    return;
+	case CRR_RESPONSE:
+	    if (!FD_ISSET(c->fd, read_setP))
+		return;
+	    if ((r = crr_read(c, sp->buffer, 0, rr->response, &sp->io)) < 0) {
+		crr_fail(sp, c);
+		return;
+	    }
+	    if (r == 0)
+		return;
+	    now = rr_now();
+	    iperf_histogram_record(sp->rr_hist, (int64_t) (now - c->start));
+	    iperf_histogram_record(sp->rr_hist_interval, (int64_t) (now - c->start));
+	    ++sp->rr_transactions;
+	    ++sp->rr_transactions_this_interval;
+	    sp->result->bytes_received += rr->response;
+	    sp->result->bytes_received_this_interval += rr->response;
+	    crr_close(test, c);
+	    return;
+    }
+}
+
+/* Server: write what we can of the response, and close once it is all out. */
+static void
+crr_answer(struct iperf_test *test, struct iperf_crr_conn *c)
+{
+    struct iperf_stream *sp = c->sp;
+    int r;
+
+    if ((r = crr_write(c, sp->buffer, 0, test->rr->response, &sp->io)) < 0) {
+	crr_close(test, c);
+	return;
+    }
+    if (r == 0) {
+	FD_SET(c->fd, &test->write_set);
+	return;
+    }
+    ++sp->rr_transactions;
+    ++sp->rr_transactions_this_interval;
+    sp->result->bytes_sent += test->rr->response;
+    sp->result->bytes_sent_this_interval += test->rr->response;
+    crr_close(test, c);
+}
+
+/*
+ * Server: read the header and the request.  Connections that do not
+ * carry this test's cookie get ACCESS_DENIED, as in iperf_accept.
+ * The cookie is checked before the stream id is read: a client opening
+ * its control connection while the test runs sends only the cookie,
+ * then waits for an answer.
+ */
+static void
+crr_server_step(struct iperf_test *test, struct iperf_crr_conn *c, fd_set *read_setP, fd_set *write_setP)
+{
+    struct iperf_stream *sp;
+    signed char rbuf = ACCESS_DENIED;
+    uint32_t id;
+    int r;
+
+    switch (c->state) {
+	case CRR_REQUEST:
+	    if (!FD_ISSET(c->fd, read_setP))
+		return;
+	    if (c->sp == NULL) {
+		if (c->done < COOKIE_SIZE) {
+		    if ((r = crr_read(c, NULL, COOKIE_SIZE, 0, &c->io)) <= 0) {
+			if (r < 0)
+			    crr_close(test, c);
+			return;
+		    }
+		    if (memcmp(c->header, test->cookie, COOKIE_SIZE) != 0) {
+			if (test->metrics != NULL)
+			    ++test->metrics->accept_denied;
+			(void) Nwrite(c->fd, (char *) &rbuf, sizeof(rbuf), Ptcp);
+			crr_close(test, c);
+			return;
+		    }
+		}
+		if ((r = crr_read(c, NULL, CRR_HEADER_SIZE, 0, &c->io)) <= 0) {
+		    if (r < 0)
+			crr_close(test, c);
+		    return;
+		}
+		memcpy(&id, c->header + COOKIE_SIZE, sizeof(id));
+		id = ntohl(id);
+		SLIST_FOREACH(sp, &test->streams, streams)
+		    if (sp->id == id)
+			break;
+		if (sp == NULL) {
+		    crr_close(test, c);
+		    return;
+		}
+		c->sp = sp;
+		c->done = 0;
+		/* The header's reads count for the stream too. */
+		sp->io.calls += c->io.calls;
+		sp->io.bytes += c->io.bytes;
+		sp->io.eagain += c->io.eagain;
+		sp->io.short_io += c->io.short_io;
+	    }
+	    if ((r = crr_read(c, c->sp->buffer, 0, test->rr->request, &c->sp->io)) <= 0) {
+		if (r < 0)
+		    crr_close(test, c);
+		return;
+	    }
+	    c->sp->result->bytes_received += test->rr->request;
+	    c->sp->result->bytes_received_this_interval += test->rr->request;
+	    FD_CLR(c->fd, &test->read_set);
+	    c->state = CRR_RESPONSE;
+	    c->done = 0;
+	    crr_answer(test, c);
+	    return;
+	case CRR_RESPONSE:
+	    if (FD_ISSET(c->fd, write_setP))
+		crr_answer(test, c);
+	    return;
+    }
+}
+
+int
+iperf_rr_attach(struct iperf_stream *sp)
+{
+    struct iperf_test *test = sp->test;
+
+    if (test->rr->connect) {
+	/* The server's side of --crr lives in iperf_crr_accept. */
+	if (test->role != 'c')
+	    return 0;
+	sp->crr = crr_new(test->rr->depth);
+	sp->rr_hist = iperf_histogram_new();
+	sp->rr_hist_interval = iperf_histogram_new();
+	sp->crr_connect_hist = iperf_histogram_new();
+	sp->crr_connect_hist_interval = iperf_histogram_new();
+	if (sp->crr == NULL || sp->rr_hist == NULL || sp->rr_hist_interval == NULL ||
+	    sp->crr_connect_hist == NULL || sp->crr_connect_hist_interval == NULL) {
+	    iperf_rr_detach(sp);
+	    i_errno = IECREATESTREAM;
+	    return -1;
+	}
+    } else if (test->role == 'c') {
+	sp->rr_sent = (uint64_t *) calloc(test->rr->depth, sizeof(uint64_t));
+	sp->rr_hist = iperf_histogram_new();
+	sp->rr_hist_interval = iperf_histogram_new();
+	if (sp->rr_sent == NULL || sp->rr_hist == NULL || sp->rr_hist_interval == NULL) {
+	    iperf_rr_detach(sp);
+	    i_errno = IECREATESTREAM;
+	    return -1;
+	}
+	sp->snd = rr_send_request;
+	sp->rcv = rr_recv_response;
+    } else
+	sp->rcv = rr_answer_requests;
+    return 0;
+}
+
+void
+iperf_rr_detach(struct iperf_stream *sp)
+{
+    free(sp->rr_sent);
+    iperf_histogram_free(sp->rr_hist);
+    iperf_histogram_free(sp->rr_hist_interval);
+    iperf_histogram_free(sp->crr_connect_hist);
+    iperf_histogram_free(sp->crr_connect_hist_interval);
+    crr_free(sp->test, sp->crr);
+    sp->rr_sent = NULL;
+    sp->rr_hist = sp->rr_hist_interval = NULL;
+    sp->crr_connect_hist = sp->crr_connect_hist_interval = NULL;
+    sp->crr = NULL;
+}
+
+void
+iperf_rr_reset(struct iperf_stream *sp)
+{
+    sp->rr_transactions = 0;
+    sp->rr_transactions_this_interval = 0;
+    sp->crr_failures = 0;
+    sp->crr_failures_this_interval = 0;
+    if (sp->rr_hist != NULL) {
+	iperf_histogram_reset(sp->rr_hist);
+	iperf_histogram_reset(sp->rr_hist_interval);
+    }
+    if (sp->crr_connect_hist != NULL) {
+	iperf_histogram_reset(sp->crr_connect_hist);
+	iperf_histogram_reset(sp->crr_connect_hist_interval);
+    }
+}
+
+int
+iperf_rr_recv(struct iperf_test *test, fd_set *read_setP)
+{
+    struct iperf_stream *sp;
+    int r;
+
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	if (FD_ISSET(sp->socket, read_setP)) {
+	    if ((r = sp->rcv(sp)) < 0) {
+		i_errno = IESTREAMREAD;
+		return r;
+	    }
+	    FD_CLR(sp->socket, read_setP);
+	}
+    }
+    return 0;
+}
+
+int
+iperf_crr_accept(struct iperf_test *test)
+{
+    struct iperf_crr_conn *c;
+    signed char rbuf = ACCESS_DENIED;
+    int i, n, s;
+
+    if (test->crr == NULL) {
+	/* Each stream keeps depth connections going; leave room for as many closing. */
+	if ((test->crr = crr_new(2 * test->num_streams * test->rr->depth)) == NULL) {
+	    i_errno = IEACCEPT;
+	    return -1;
+	}
+	setnonblocking(test->listener, 1);
+    }
+
+    /* Take what the backlog holds, up to one connection per slot. */
+    for (n = 0; n < test->crr->nconns; ++n) {
+	if ((s = accept(test->listener, NULL, NULL)) < 0) {
+	    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED)
+		return 0;
+	    i_errno = IEACCEPT;
+	    return -1;
+	}
+	c = NULL;
+	if (s < FD_SETSIZE)
+	    for (i = 0; i < test->crr->nconns; ++i)
+		if (test->crr->conns[i].fd < 0) {
+		    c = &test->crr->conns[i];
+		    break;
+		}
+	if (c == NULL) {
+	    /*
+	     * A --crr client counts it as failed; anyone else is told
+	     * the server is busy.
+	     */
+	    (void) Nwrite(s, (char *) &rbuf, sizeof(rbuf), Ptcp);
+	    close(s);
+	    continue;
+	}
+	setnonblocking(s, 1);
+	if (test->no_delay)
+	    crr_set_nodelay(s);
+	c->fd = s;
+	c->state = CRR_REQUEST;
+	c->done = 0;
+	c->sp = NULL;
+	memset(&c->io, 0, sizeof(c->io));
+	FD_SET(s, &test->read_set);
+	if (s > test->max_fd) test->max_fd = s;
+    }
+    return 0;
+}
+
+void
+iperf_crr_run(struct iperf_test *test, fd_set *read_setP, fd_set *write_setP)
+{
+    struct iperf_stream *sp;
+    int i;
+
+    if (test->role != 'c') {
+	if (test->crr != NULL)
+	    for (i = 0; i < test->crr->nconns; ++i)
+		if (test->crr->conns[i].fd >= 0)
+		    crr_server_step(test, &test->crr->conns[i], read_setP, write_setP);
+	return;
+    }
+
+    SLIST_FOREACH(sp, &test->streams, streams)
+	for (i = 0; i < sp->crr->nconns; ++i)
+	    if (sp->crr->conns[i].fd >= 0)
+		crr_client_step(sp, &sp->crr->conns[i], read_setP, write_setP);
+
+    /*
+     * Reopen only after every connection has been stepped, so that a
+     * new socket reusing a closed one's descriptor is not taken as
+     * ready by the sets from the last select.
+     */
+    if (test->done)
+	return;
+    SLIST_FOREACH(sp, &test->streams, streams)
+	for (i = 0; i < sp->crr->nconns; ++i)
+	    if (sp->crr->conns[i].fd < 0)
+		crr_open(sp, &sp->crr->conns[i]);
+}
+
+void
+iperf_crr_stop(struct iperf_test *test)
+{
+    struct iperf_stream *sp;
+    int i;
+
+    if (test->role != 'c') {
+	crr_free(test, test->crr);
+	test->crr = NULL;
+	return;
+    }
+    SLIST_FOREACH(sp, &test->streams, streams)
+	if (sp->crr != NULL)
+	    for (i = 0; i < sp->crr->nconns; ++i)
+		if (sp->crr->conns[i].fd >= 0)
+		    crr_close(test, &sp->crr->conns[i]);
+}
@@ -0,0 +1,134 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_RR_H
+#define __IPERF_RR_H
+
+#include <sys/select.h>
+
+/*
+ * Request/response transactions (--rr), in the manner of netperf's
+ * TCP_RR test.
+ *
+ * Each client stream writes a request of a fixed size; the server
+ * answers every complete request with a response of a fixed size.  Up
+ * to depth requests may be outstanding on a connection at once.  The
+ * client timestamps each request and records the time until its
+ * response has been read completely; since TCP keeps the order, the
+ * responses match the requests first in, first out.
+ *
+ * The client drives the requests through the usual sending path: a
+ * stream has a green light while it has request bytes to write or room
+ * in the pipeline, and it is read whenever a response arrives.
+ *
+ * With --crr, in the manner of TCP_CRR, every transaction opens a
+ * connection of its own: the client connects without blocking, sends
+ * the test cookie, the stream id and the request, reads the response,
+ * and the server closes.  The depth is then the number of connections
+ * each stream keeps going at once.  The streams themselves only carry
+ * the test's identity and carry no data.
+ */
+
+#define RR_MAX_DEPTH 1024
+#define RR_MAX_SPEC 64
+#define CRR_MAX_CONNS 512		/* --crr connections at once, all streams */
+
+struct iperf_rr
+{
+    int       request;			/* bytes per request */
+    int       response;			/* bytes per response */
+    int       depth;			/* requests in flight per connection, or
+					   (--crr) connections at once per stream */
+    int       connect;			/* --crr: a new connection per transaction */
+    char      spec[RR_MAX_SPEC];
+};
+
+struct iperf_test;
+struct iperf_stream;
+
+/**
+ * iperf_rr_parse -- parse an --rr spec:
+ *   request[:response[:depth]]
+ * sizes take the usual K/M suffixes; the response defaults to the
+ * request size and the depth to 1
+ *
+ * returns a new spec, or NULL and sets i_errno to IERR
+ *
+ */
+struct iperf_rr *iperf_rr_parse(const char *spec);
+
+/**
+ * iperf_rr_attach -- make a new stream send requests (client) or
+ * answer them (server)
+ *
+ * returns 0 on success, -1 and sets i_errno to IECREATESTREAM on error
+ *
+ */
+int iperf_rr_attach(struct iperf_stream *);
+
+void iperf_rr_detach(struct iperf_stream *);
+
+/**
+ * iperf_rr_reset -- forget the transactions so far, after the omit
+ * period
+ *
+ */
+void iperf_rr_reset(struct iperf_stream *);
+
+/**
+ * iperf_rr_recv -- client: read the responses on the streams that are
+ * ready in read_setP
+ *
+ * returns 0 on success, < 0 and sets i_errno to IESTREAMREAD on error
+ *
+ */
+int iperf_rr_recv(struct iperf_test *, fd_set *read_setP);
+
+/**
+ * iperf_crr_accept -- server: accept the --crr connections waiting on
+ * the listener
+ *
+ * returns 0 on success, -1 and sets i_errno to IEACCEPT on error
+ *
+ */
+int iperf_crr_accept(struct iperf_test *);
+
+/**
+ * iperf_crr_run -- advance the --crr connections that are ready in
+ * read_setP or write_setP, and (client) open new ones where there is
+ * room; connections that fail are counted, not reported as errors
+ *
+ */
+void iperf_crr_run(struct iperf_test *, fd_set *read_setP, fd_set *write_setP);
+
+/**
+ * iperf_crr_stop -- close the --crr connections in progress at the end
+ * of the test
+ *
+ */
+void iperf_crr_stop(struct iperf_test *);
+
+#endif
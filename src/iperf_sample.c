@@ -0,0 +1,291 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_sample.c
+ *
+ * Fine-grained throughput sampling into per-stream rings.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_sample.h"
+
+struct iperf_sample_config *
+iperf_sample_new(int period)
+{
+    struct iperf_sample_config *sc;
+
+    sc = (struct iperf_sample_config *) calloc(1, sizeof(struct iperf_sample_config));
+    if (sc == NULL) {
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    sc->period = period;
+    return sc;
+}
+
+void
+iperf_sample_free(struct iperf_sample_config *sc)
+{
+    if (sc == NULL)
+	return;
+    if (sc->timer != NULL)
+	tmr_cancel(sc->timer);
+    iperf_sample_ring_free(sc->sum);
+    free(sc);
+}
+
+struct iperf_sample_ring *
+iperf_sample_ring_new(uint32_t size)
+{
+    struct iperf_sample_ring *r;
+
+    r = (struct iperf_sample_ring *) calloc(1, sizeof(struct iperf_sample_ring));
+    if (r == NULL)
+	return NULL;
+    r->samples = (struct iperf_sample *) calloc(size, sizeof(struct iperf_sample));
+    if (r->samples == NULL) {
+	free(r);
+	return NULL;
+    }
+    r->size = size;
+    return r;
+}
+
+void
+iperf_sample_ring_free(struct iperf_sample_ring *r)
+{
+    if (r == NULL)
+	return;
+    free(r->samples);
+    free(r);
+}
+
+void
+iperf_sample_add(struct iperf_sample_ring *r, uint64_t time, uint64_t bytes)
+{
+    struct iperf_sample *s;
+
+    if (r->head - r->tail == r->size)
+	++r->tail;			/* full: overwrite the oldest */
+    s = &r->samples[r->head % r->size];
+    s->time = time;
+    s->bytes = bytes;
+    ++r->head;
+}
+
+/* Room for the whole test, within SAMPLE_MAX_SAMPLES over all rings. */
+static uint32_t
+sample_size(struct iperf_test *test)
+{
+    uint64_t size, limit;
+
+    limit = SAMPLE_MAX_SAMPLES / (test->num_streams + 1);
+    if (limit < SAMPLE_MIN_SAMPLES)
+	limit = SAMPLE_MIN_SAMPLES;
+    if (test->duration == 0)
+	return limit;
+    size = (uint64_t) (test->duration + test->omit + 1) * SEC_TO_US / test->sample->period + 1;
+    return size < limit ? size : limit;
+}
+
+int
+iperf_sample_attach(struct iperf_stream *sp)
+{
+    sp->sample = iperf_sample_ring_new(sample_size(sp->test));
+    if (sp->sample == NULL) {
+	i_errno = IECREATESTREAM;
+	return -1;
+    }
+    return 0;
+}
+
+void
+iperf_sample_detach(struct iperf_stream *sp)
+{
+    iperf_sample_ring_free(sp->sample);
+    sp->sample = NULL;
+}
+
+static void
+sample_timer_proc(TimerClientData client_data, struct timeval *nowP)
+{
+    struct iperf_test *test = client_data.p;
+    struct iperf_sample_config *sc = test->sample;
+    struct iperf_stream *sp;
+    struct iperf_sample_ring *r;
+    iperf_size_t total;
+    uint64_t t, bytes, sum;
+
+    if (test->state != TEST_RUNNING)
+	return;
+    t = (nowP->tv_sec - sc->start.tv_sec) * SEC_TO_US + (nowP->tv_usec - sc->start.tv_usec);
+    /* A timer that fell behind catches up in one go; keep one sample. */
+    r = sc->sum;
+    if (r->head > 0 && t < r->samples[(r->head - 1) % r->size].time + sc->period / 2)
+	return;
+    sum = 0;
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	if ((r = sp->sample) == NULL)
+	    continue;
+	total = test->sender ? sp->result->bytes_sent : sp->result->bytes_received;
+	/* The counts start again from zero when --omit ends. */
+	bytes = total >= r->total ? total - r->total : total;
+	r->total = total;
+	iperf_sample_add(r, t, bytes);
+	sum += bytes;
+    }
+    iperf_sample_add(sc->sum, t, sum);
+}
+
+int
+iperf_sample_start(struct iperf_test *test)
+{
+    struct iperf_sample_config *sc = test->sample;
+    TimerClientData cd;
+
+    iperf_sample_ring_free(sc->sum);
+    if ((sc->sum = iperf_sample_ring_new(sample_size(test))) == NULL) {
+	i_errno = IEINITTEST;
+	return -1;
+    }
+    if (sc->timer != NULL)
+	tmr_cancel(sc->timer);
+    if (gettimeofday(&sc->start, NULL) < 0) {
+	i_errno = IEINITTEST;
+	return -1;
+    }
+    cd.p = test;
+    sc->timer = tmr_create(&sc->start, sample_timer_proc, cd, sc->period, 1);
+    if (sc->timer == NULL) {
+	i_errno = IEINITTEST;
+	return -1;
+    }
+    return 0;
+}
+
+void
+iperf_sample_stop(struct iperf_test *test)
+{
+    struct iperf_sample_config *sc = test->sample;
+
+    if (sc != NULL && sc->timer != NULL) {
+	tmr_cancel(sc->timer);
+	sc->timer = NULL;
+    }
+}
+
+static int
+sample_compare(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+int
+iperf_sample_summarize(struct iperf_sample_ring *r, uint64_t from_us, struct iperf_sample_stats *st)
+{
+    struct iperf_sample *s;
+    double *rates, dt, run;
+    uint64_t i, prev, n;
+
+    memset(st, 0, sizeof(*st));
+    if (r == NULL || r->head == r->tail)
+	return -1;
+    rates = (double *) malloc((r->head - r->tail) * sizeof(double));
+    if (rates == NULL)
+	return -1;
+
+    /* The oldest sample left only marks where the next one starts. */
+    i = r->tail;
+    prev = 0;
+    if (i > 0)
+	prev = r->samples[i++ % r->size].time;
+    n = 0;
+    run = 0;
+    for (; i < r->head; prev = s->time, ++i) {
+	s = &r->samples[i % r->size];
+	if (s->time <= from_us || s->time <= prev)
+	    continue;
+	dt = (s->time - prev) / (double) SEC_TO_US;
+	rates[n++] = s->bytes / dt;
+	if (s->bytes == 0) {
+	    if (run == 0)
+		++st->stalls;
+	    run += dt;
+	    if (run > st->longest_stall)
+		st->longest_stall = run;
+	} else
+	    run = 0;
+    }
+    if (n == 0) {
+	free(rates);
+	return -1;
+    }
+    qsort(rates, n, sizeof(double), sample_compare);
+    st->samples = n;
+    st->min = rates[0];
+    st->median = n % 2 ? rates[n / 2] : (rates[n / 2 - 1] + rates[n / 2]) / 2;
+    st->max = rates[n - 1];
+    free(rates);
+    return 0;
+}
+
+cJSON *
+iperf_sample_to_json(struct iperf_sample_ring *r)
+{
+    cJSON *j, *t, *b;
+    uint64_t i;
+
+    j = cJSON_CreateObject();
+    t = cJSON_CreateArray();
+    b = cJSON_CreateArray();
+    if (j == NULL || t == NULL || b == NULL) {
+	cJSON_Delete(j);
+	cJSON_Delete(t);
+	cJSON_Delete(b);
+	return NULL;
+    }
+    cJSON_AddIntToObject(j, "dropped", r->tail);
+    for (i = r->tail; i < r->head; ++i) {
+	cJSON_AddItemToArray(t, cJSON_CreateInt(r->samples[i % r->size].time));
+	cJSON_AddItemToArray(b, cJSON_CreateInt(r->samples[i % r->size].bytes));
+    }
+    cJSON_AddItemToObject(j, "time_us", t);
+    cJSON_AddItemToObject(j, "bytes", b);
+    return j;
+}
@@ -0,0 +1,135 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_SAMPLE_H
+#define __IPERF_SAMPLE_H
+
+#include <sys/time.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "timer.h"
+#include "cjson.h"
+
+/*
+ * Fine-grained throughput sampling (--sample-interval).
+ *
+ * Interval reports cost a gettimeofday() per stream and a formatted
+ * line each, which is why -i stops at MIN_INTERVAL.  Sampling takes
+ * that apart from reporting: a timer on the I/O thread notes, for
+ * every stream and for their sum, how many bytes moved since the last
+ * sample, with one clock reading per tick and no formatting, into
+ * rings preallocated for the test.  The samples are only looked at
+ * when the test is over: the text output gives the lowest, median and
+ * highest sampled rates and the stalls (runs of samples with nothing
+ * moved), the JSON output also the samples themselves.  A ring that
+ * fills up overwrites its oldest samples.
+ */
+
+#define SAMPLE_MIN_PERIOD 1000			/* us */
+#define SAMPLE_MAX_PERIOD 1000000		/* us */
+#define SAMPLE_MIN_SAMPLES 4096			/* per stream */
+#define SAMPLE_MAX_SAMPLES 1048576		/* over all streams */
+
+struct iperf_sample
+{
+    uint64_t  time;			/* us since sampling started */
+    uint64_t  bytes;			/* since the previous sample */
+};
+
+/* Per stream, and one for the sum. */
+struct iperf_sample_ring
+{
+    struct iperf_sample *samples;
+    uint32_t  size;
+    uint64_t  head;			/* samples taken */
+    uint64_t  tail;			/* oldest sample still in the ring */
+    uint64_t  total;			/* stream byte count at the last sample */
+};
+
+/* Per test. */
+struct iperf_sample_config
+{
+    int       period;			/* us */
+    uint32_t  size;			/* samples per ring */
+    struct timeval start;
+    Timer    *timer;
+    struct iperf_sample_ring *sum;
+};
+
+struct iperf_sample_stats
+{
+    uint64_t  samples;			/* those summarized */
+    double    min;			/* bytes/sec */
+    double    median;
+    double    max;
+    uint64_t  stalls;			/* runs of samples with no bytes */
+    double    longest_stall;		/* seconds */
+};
+
+struct iperf_test;
+struct iperf_stream;
+
+struct iperf_sample_config *iperf_sample_new(int period);
+void iperf_sample_free(struct iperf_sample_config *);
+
+/**
+ * iperf_sample_attach -- give a new stream its ring
+ *
+ * returns 0, or -1 and sets i_errno
+ *
+ */
+int iperf_sample_attach(struct iperf_stream *sp);
+void iperf_sample_detach(struct iperf_stream *sp);
+
+/**
+ * iperf_sample_start -- start the sampling timer, with the sum ring
+ * sized like the streams'
+ *
+ * returns 0, or -1 and sets i_errno
+ *
+ */
+int iperf_sample_start(struct iperf_test *test);
+void iperf_sample_stop(struct iperf_test *test);
+
+struct iperf_sample_ring *iperf_sample_ring_new(uint32_t size);
+void iperf_sample_ring_free(struct iperf_sample_ring *r);
+void iperf_sample_add(struct iperf_sample_ring *r, uint64_t time, uint64_t bytes);
+
+/**
+ * iperf_sample_summarize -- the rates and stalls over the samples in
+ * r taken after from_us
+ *
+ * returns 0, or -1 if there are none
+ *
+ */
+int iperf_sample_summarize(struct iperf_sample_ring *r, uint64_t from_us, struct iperf_sample_stats *st);
+
+/* The samples as {"time_us": [...], "bytes": [...]}. */
+cJSON *iperf_sample_to_json(struct iperf_sample_ring *r);
+
+#endif
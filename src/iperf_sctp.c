@@ -60,7 +60,7 @@ iperf_sctp_recv(struct iperf_stream *sp)
 #if defined(HAVE_SCTP)
     int r;
 
-    r = Nread(sp->socket, sp->buffer, sp->settings->blksize, Psctp);
+    r = Nread_counted(sp->socket, sp->buffer, sp->settings->blksize, Psctp, &sp->io);
     if (r < 0)
         return r;
 
@@ -85,7 +85,7 @@ iperf_sctp_send(struct iperf_stream *sp)
 #if defined(HAVE_SCTP)
     int r;
 
-    r = Nwrite(sp->socket, sp->buffer, sp->settings->blksize, Psctp);
+    r = Nwrite_counted(sp->socket, sp->buffer, sp->send_size, Psctp, &sp->io);
     if (r < 0)
         return r;    
 
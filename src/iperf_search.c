@@ -0,0 +1,211 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_search.c
+ *
+ * Maximum loss-free rate search.  The state machine hooks are in
+ * iperf_client_api.c and iperf_server_api.c; this file only keeps the
+ * bounds and the trial history, and picks the next rate.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_search.h"
+#include "iperf_locale.h"
+#include "iperf_util.h"
+#include "units.h"
+
+/* Parse a positive rate, with the usual K/M/G suffixes. */
+static int
+parse_rate(const char *s, double *rate)
+{
+    char *end;
+
+    if (strtod(s, &end) <= 0 || end == s)
+	return -1;
+    if (*end != '\0' && end[1] != '\0')
+	return -1;
+    *rate = unit_atof_rate(s);
+    return 0;
+}
+
+struct iperf_search *
+iperf_search_parse(const char *spec)
+{
+    struct iperf_search *s;
+    char buf[SEARCH_MAX_SPEC];
+    char *fields[4];
+    char *cp, *end;
+    int nfields;
+
+    s = (struct iperf_search *) malloc(sizeof(struct iperf_search));
+    if (s == NULL) {
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    memset(s, 0, sizeof(struct iperf_search));
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    nfields = 0;
+    fields[nfields++] = buf;
+    for (cp = buf; *cp != '\0'; ++cp)
+	if (*cp == ':') {
+	    if (nfields == 4)
+		goto bad;
+	    *cp = '\0';
+	    fields[nfields++] = cp + 1;
+	}
+    if (nfields < 2 ||
+	parse_rate(fields[0], &s->min_rate) < 0 ||
+	parse_rate(fields[1], &s->max_rate) < 0 ||
+	s->min_rate >= s->max_rate)
+	goto bad;
+    if (nfields >= 3) {
+	s->loss = strtod(fields[2], &end);
+	if (end == fields[2] || *end != '\0' || !(s->loss >= 0 && s->loss < 100))
+	    goto bad;
+    }
+    if (nfields == 4) {
+	if (parse_rate(fields[3], &s->resolution) < 0)
+	    goto bad;
+    } else
+	s->resolution = s->max_rate / 100;
+
+    s->lo = s->min_rate;
+    s->hi = s->max_rate;
+    strcpy(s->spec, spec);
+    return s;
+
+  bad:
+    free(s);
+    i_errno = IESEARCH;
+    return NULL;
+}
+
+int
+iperf_search_next(struct iperf_test *test)
+{
+    struct iperf_search *s = test->search;
+    struct iperf_search_trial *t;
+    struct iperf_stream *sp;
+    iperf_size_t bytes = 0;
+    double duration = 0;
+    char rbuf[UNIT_LEN];
+    char nbuf[UNIT_LEN];
+
+    /* With -R the counts are our own; otherwise they came from the server. */
+    t = &s->trials[s->ntrials++];
+    t->rate = test->settings->rate;
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	t->packets += sp->packet_count - sp->omitted_packet_count;
+	t->lost_packets += sp->cnt_error;
+	bytes += sp->result->bytes_received;
+    }
+    sp = SLIST_FIRST(&test->streams);
+    if (sp != NULL)
+	duration = timeval_diff(&sp->result->start_time, &sp->result->end_time);
+    t->bits_per_second = duration > 0 ? bytes * 8 / duration : 0;
+    if (t->packets > 0) {
+	t->lost_percent = 100.0 * t->lost_packets / t->packets;
+	t->pass = t->lost_packets <= 0 || t->lost_percent <= s->loss;
+    } else {
+	t->lost_percent = 100.0;
+	t->pass = 0;
+    }
+
+    if (!test->json_output) {
+	unit_snprintf(rbuf, UNIT_LEN, t->rate / 8, test->settings->unit_format);
+	unit_snprintf(nbuf, UNIT_LEN, t->bits_per_second / 8, test->settings->unit_format);
+	iprintf(test, report_search_trial, s->ntrials, rbuf, nbuf, t->lost_packets, t->packets, t->lost_percent, t->pass ? "pass" : "fail");
+    }
+
+    if (t->pass) {
+	if (t->rate > s->best)
+	    s->best = t->rate;
+	s->lo = t->rate;
+    } else
+	s->hi = t->rate;
+
+    /* The first trial runs at the upper bound; if that is clean, so is everything below. */
+    if ((s->ntrials == 1 && t->pass) || s->ntrials == SEARCH_MAX_TRIALS)
+	return 0;
+    if (s->hi - s->lo <= s->resolution) {
+	/* Before giving up, try the lower bound itself. */
+	if (s->best > 0 || s->hi <= s->min_rate)
+	    return 0;
+	test->settings->rate = (uint64_t) s->min_rate;
+	return 1;
+    }
+    test->settings->rate = (uint64_t) ((s->lo + s->hi) / 2);
+    return 1;
+}
+
+void
+iperf_search_report(struct iperf_test *test)
+{
+    struct iperf_search *s = test->search;
+    struct iperf_search_trial *t;
+    cJSON *j, *j_trials;
+    char nbuf[UNIT_LEN];
+    double lowest;
+    int i;
+
+    if (test->json_output) {
+	j = iperf_json_printf("min_bits_per_second: %f  max_bits_per_second: %f  loss_percent: %f  resolution: %f  bits_per_second: %f  converged: %b", s->min_rate, s->max_rate, s->loss, s->resolution, s->best, s->best > 0);
+	if (j == NULL)
+	    return;
+	j_trials = cJSON_CreateArray();
+	if (j_trials != NULL) {
+	    for (i = 0; i < s->ntrials; ++i) {
+		t = &s->trials[i];
+		cJSON_AddItemToArray(j_trials, iperf_json_printf("rate: %f  bits_per_second: %f  lost_packets: %d  packets: %d  lost_percent: %f  pass: %b", t->rate, t->bits_per_second, (int64_t) t->lost_packets, (int64_t) t->packets, t->lost_percent, t->pass));
+	    }
+	    cJSON_AddItemToObject(j, "trials", j_trials);
+	}
+	cJSON_AddItemToObject(test->json_end, "search", j);
+    } else if (s->best > 0) {
+	unit_snprintf(nbuf, UNIT_LEN, s->best / 8, test->settings->unit_format);
+	iprintf(test, report_search_result, nbuf, s->loss, s->ntrials);
+    } else {
+	/* Say only what was tried. */
+	lowest = s->max_rate;
+	for (i = 0; i < s->ntrials; ++i)
+	    if (s->trials[i].rate < lowest)
+		lowest = s->trials[i].rate;
+	unit_snprintf(nbuf, UNIT_LEN, lowest / 8, test->settings->unit_format);
+	iprintf(test, report_search_none, nbuf, s->loss, s->ntrials);
+    }
+}
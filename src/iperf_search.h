@@ -0,0 +1,101 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_SEARCH_H
+#define __IPERF_SEARCH_H
+
+/*
+ * Maximum loss-free rate search (--search), in the manner of the
+ * RFC 2544 throughput test.
+ *
+ * The client runs a series of UDP trials over one control connection.
+ * Each trial is a complete TEST_START ... DISPLAY_RESULTS cycle at a
+ * fixed -b rate, with fresh data streams.  The first trial runs at the
+ * upper bound; after that the rate is halved between the highest rate
+ * that passed and the lowest that failed, until the two are within the
+ * resolution, with a last trial at the lower bound if none has passed
+ * by then.  A trial passes if the receiver lost no more than the
+ * allowed percentage of the datagrams it should have seen.
+ */
+
+#define SEARCH_MAX_TRIALS 64
+#define SEARCH_MAX_SPEC 256
+
+struct iperf_search_trial
+{
+    double    rate;			/* offered, per stream, bits per second */
+    double    bits_per_second;		/* received, all streams */
+    int64_t   packets;
+    int64_t   lost_packets;
+    double    lost_percent;
+    int       pass;
+};
+
+struct iperf_search
+{
+    double    min_rate;			/* bounds, per stream, bits per second */
+    double    max_rate;
+    double    loss;			/* allowed loss, percent */
+    double    resolution;		/* stop when the bounds are this close */
+
+    double    lo;			/* current bounds */
+    double    hi;
+    double    best;			/* highest rate that passed, or 0 */
+
+    int       ntrials;
+    struct iperf_search_trial trials[SEARCH_MAX_TRIALS];
+    char      spec[SEARCH_MAX_SPEC];
+};
+
+struct iperf_test;
+
+/**
+ * iperf_search_parse -- parse a --search spec:
+ *   min:max[:loss_percent[:resolution]]
+ *
+ * returns a new search, or NULL and sets i_errno to IESEARCH
+ *
+ */
+struct iperf_search *iperf_search_parse(const char *spec);
+
+/**
+ * iperf_search_next -- record the trial that just finished (the
+ * receiver's counts are in the streams after the results exchange)
+ * and choose the rate of the next one
+ *
+ * returns 1 and sets the test's rate if another trial is needed,
+ * 0 when the search has converged
+ *
+ */
+int iperf_search_next(struct iperf_test *);
+
+/**
+ * iperf_search_report -- print the converged rate and the trial history
+ *
+ */
+void iperf_search_report(struct iperf_test *);
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_seqwin.c
+ *
+ * Loss, reordering and duplicate accounting for UDP receivers.
+ */
+#include "iperf_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf_seqwin.h"
+
+static const char *seqwin_labels[SEQWIN_BUCKETS] = {
+    "1", "2-3", "4-7", "8-15", "16-31", "32-63", "64-127", "128+"
+};
+
+#define SEQWIN_BIT(seq) ((uint64_t) 1 << ((seq) & 63))
+#define SEQWIN_WORD(w, seq) ((w)->bits[((seq) & (SEQWIN_SIZE - 1)) >> 6])
+
+static int
+seqwin_bucket(uint64_t v)
+{
+    int b;
+
+    for (b = 0; v > 1 && b < SEQWIN_BUCKETS - 1; ++b)
+	v >>= 1;
+    return b;
+}
+
+static void
+seqwin_count_burst(struct iperf_seqwin *w)
+{
+    int b = seqwin_bucket(w->burst);
+
+    ++w->total.bursts[b];
+    ++w->interval.bursts[b];
+    w->burst = 0;
+}
+
+/* A sequence number leaves the window: lost unless it arrived. */
+static void
+seqwin_retire(struct iperf_seqwin *w, uint64_t seq)
+{
+    if (SEQWIN_WORD(w, seq) & SEQWIN_BIT(seq)) {
+	if (w->burst > 0)
+	    seqwin_count_burst(w);
+    } else
+	++w->burst;
+}
+
+/* Move the top of the window up to seq. */
+static void
+seqwin_advance(struct iperf_seqwin *w, uint64_t seq)
+{
+    uint64_t s, n = seq - w->highest;
+
+    if (n > SEQWIN_SIZE) {
+	/* The whole window leaves, and what lies between never entered it. */
+	for (s = w->highest + 1; s <= w->highest + SEQWIN_SIZE; ++s)
+	    if (s > SEQWIN_SIZE)
+		seqwin_retire(w, s - SEQWIN_SIZE);
+	w->burst += n - SEQWIN_SIZE;
+	memset(w->bits, 0, sizeof(w->bits));
+    } else
+	for (s = w->highest + 1; s <= seq; ++s) {
+	    if (s > SEQWIN_SIZE)
+		seqwin_retire(w, s - SEQWIN_SIZE);
+	    SEQWIN_WORD(w, s) &= ~SEQWIN_BIT(s);
+	}
+    SEQWIN_WORD(w, seq) |= SEQWIN_BIT(seq);
+    w->highest = seq;
+}
+
+struct iperf_seqwin *
+iperf_seqwin_new(void)
+{
+    return (struct iperf_seqwin *) calloc(1, sizeof(struct iperf_seqwin));
+}
+
+void
+iperf_seqwin_free(struct iperf_seqwin *w)
+{
+    free(w);
+}
+
+int
+iperf_seqwin_record(struct iperf_seqwin *w, uint64_t seq)
+{
+    uint64_t d;
+    int b;
+
+    if (seq > w->highest) {
+	seqwin_advance(w, seq);
+	return SEQWIN_NEW;
+    }
+    d = w->highest - seq;
+    if (d < SEQWIN_SIZE) {
+	if (SEQWIN_WORD(w, seq) & SEQWIN_BIT(seq)) {
+	    ++w->total.duplicates;
+	    ++w->interval.duplicates;
+	    return SEQWIN_DUPLICATE;
+	}
+	SEQWIN_WORD(w, seq) |= SEQWIN_BIT(seq);
+    }
+    b = seqwin_bucket(d);
+    ++w->total.reorder[b];
+    ++w->interval.reorder[b];
+    return d < SEQWIN_SIZE ? SEQWIN_LATE : SEQWIN_STALE;
+}
+
+void
+iperf_seqwin_flush(struct iperf_seqwin *w)
+{
+    uint64_t s;
+
+    s = w->highest > SEQWIN_SIZE ? w->highest - SEQWIN_SIZE + 1 : 1;
+    for (; s <= w->highest; ++s)
+	seqwin_retire(w, s);
+    if (w->burst > 0)
+	seqwin_count_burst(w);
+    /* Everything up to the highest has been settled. */
+    memset(w->bits, 0xff, sizeof(w->bits));
+}
+
+void
+iperf_seqwin_reset(struct iperf_seqwin *w)
+{
+    memset(&w->total, 0, sizeof(w->total));
+    memset(&w->interval, 0, sizeof(w->interval));
+}
+
+void
+iperf_seqwin_merge(struct iperf_seqwin_counts *to, const struct iperf_seqwin_counts *from)
+{
+    int i;
+
+    to->duplicates += from->duplicates;
+    for (i = 0; i < SEQWIN_BUCKETS; ++i) {
+	to->reorder[i] += from->reorder[i];
+	to->bursts[i] += from->bursts[i];
+    }
+}
+
+uint64_t
+iperf_seqwin_total(const uint64_t *buckets)
+{
+    uint64_t n = 0;
+    int i;
+
+    for (i = 0; i < SEQWIN_BUCKETS; ++i)
+	n += buckets[i];
+    return n;
+}
+
+const char *
+iperf_seqwin_label(int bucket)
+{
+    return seqwin_labels[bucket];
+}
+
+static cJSON *
+seqwin_buckets_json(const uint64_t *buckets)
+{
+    cJSON *j;
+    int i;
+
+    j = cJSON_CreateObject();
+    if (j == NULL)
+	return NULL;
+    for (i = 0; i < SEQWIN_BUCKETS; ++i)
+	cJSON_AddIntToObject(j, seqwin_labels[i], buckets[i]);
+    return j;
+}
+
+cJSON *
+iperf_seqwin_to_json(const struct iperf_seqwin_counts *c)
+{
+    cJSON *j;
+
+    j = cJSON_CreateObject();
+    if (j == NULL)
+	return NULL;
+    cJSON_AddIntToObject(j, "duplicates", c->duplicates);
+    cJSON_AddIntToObject(j, "reordered", iperf_seqwin_total(c->reorder));
+    cJSON_AddItemToObject(j, "reorder_distance", seqwin_buckets_json(c->reorder));
+    cJSON_AddIntToObject(j, "loss_bursts", iperf_seqwin_total(c->bursts));
+    cJSON_AddItemToObject(j, "loss_burst_length", seqwin_buckets_json(c->bursts));
+    return j;
+}
+
+static int
+seqwin_buckets_from_json(uint64_t *buckets, cJSON *j)
+{
+    cJSON *j_item;
+    int i;
+
+    if (j == NULL)
+	return -1;
+    for (i = 0; i < SEQWIN_BUCKETS; ++i) {
+	if ((j_item = cJSON_GetObjectItem(j, seqwin_labels[i])) == NULL)
+	    return -1;
+	buckets[i] = j_item->valueint;
+    }
+    return 0;
+}
+
+int
+iperf_seqwin_from_json(struct iperf_seqwin_counts *c, cJSON *j)
+{
+    cJSON *j_dup;
+
+    memset(c, 0, sizeof(*c));
+    if ((j_dup = cJSON_GetObjectItem(j, "duplicates")) == NULL ||
+	seqwin_buckets_from_json(c->reorder, cJSON_GetObjectItem(j, "reorder_distance")) < 0 ||
+	seqwin_buckets_from_json(c->bursts, cJSON_GetObjectItem(j, "loss_burst_length")) < 0) {
+	memset(c, 0, sizeof(*c));
+	return -1;
+    }
+    c->duplicates = j_dup->valueint;
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_SEQWIN_H
+#define __IPERF_SEQWIN_H
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "cjson.h"
+
+/*
+ * Sliding-window analysis of UDP sequence numbers.
+ *
+ * The receiver remembers which of the last SEQWIN_SIZE sequence
+ * numbers below the highest one seen have arrived.  A datagram from
+ * within that window is either a duplicate, if its bit is already set,
+ * or a late arrival filling a gap; it is not lost after all.  A
+ * sequence number is only taken as lost when it slides out of the
+ * window without having arrived, and consecutive losses are counted as
+ * one burst.  Datagrams older than the window are counted as reordered,
+ * but cannot be told from duplicates and their loss stands.
+ *
+ * Reorder distances (how far behind the highest sequence number a
+ * late datagram was) and burst lengths are counted in power-of-two
+ * buckets: 1, 2-3, 4-7, ..., and SEQWIN_BUCKETS-1 collects the rest.
+ */
+#define SEQWIN_SIZE 1024		/* a power of two */
+#define SEQWIN_BUCKETS 8		/* the last one is 128 and up */
+
+/* iperf_seqwin_record results */
+#define SEQWIN_NEW 0			/* above the highest so far */
+#define SEQWIN_LATE 1			/* below it, filling a gap */
+#define SEQWIN_DUPLICATE 2
+#define SEQWIN_STALE 3			/* below the window; still lost */
+
+struct iperf_seqwin_counts
+{
+    uint64_t  duplicates;
+    uint64_t  reorder[SEQWIN_BUCKETS];	/* late datagrams, by distance */
+    uint64_t  bursts[SEQWIN_BUCKETS];	/* losses, by run length */
+};
+
+struct iperf_seqwin
+{
+    uint64_t  highest;			/* 0 until the first datagram */
+    uint64_t  bits[SEQWIN_SIZE / 64];	/* arrivals, indexed by sequence number */
+    uint64_t  burst;			/* losses in the run being retired */
+    struct iperf_seqwin_counts total;
+    struct iperf_seqwin_counts interval;
+};
+
+struct iperf_seqwin *iperf_seqwin_new(void);
+
+void iperf_seqwin_free(struct iperf_seqwin *);
+
+/**
+ * iperf_seqwin_record -- note the arrival of a sequence number
+ *
+ * returns SEQWIN_NEW, SEQWIN_LATE, SEQWIN_DUPLICATE or SEQWIN_STALE
+ *
+ */
+int iperf_seqwin_record(struct iperf_seqwin *, uint64_t seq);
+
+/**
+ * iperf_seqwin_flush -- at the end of the test, settle the gaps still
+ * in the window as losses
+ *
+ */
+void iperf_seqwin_flush(struct iperf_seqwin *);
+
+/**
+ * iperf_seqwin_reset -- zero the counts, after the omit period; the
+ * window itself is kept
+ *
+ */
+void iperf_seqwin_reset(struct iperf_seqwin *);
+
+void iperf_seqwin_merge(struct iperf_seqwin_counts *to, const struct iperf_seqwin_counts *from);
+
+/* Sum of the buckets of a distribution. */
+uint64_t iperf_seqwin_total(const uint64_t *buckets);
+
+/* Label of a bucket: "1", "2-3", ..., "128+". */
+const char *iperf_seqwin_label(int bucket);
+
+/**
+ * iperf_seqwin_to_json -- the counts as an object:
+ *   {"duplicates": n, "reordered": n, "reorder_distance": {"1": n, ...},
+ *    "loss_bursts": n, "loss_burst_length": {"1": n, ...}}
+ * which is used both in the results exchange and in the JSON output
+ *
+ */
+cJSON *iperf_seqwin_to_json(const struct iperf_seqwin_counts *);
+
+/**
+ * iperf_seqwin_from_json -- read counts written by iperf_seqwin_to_json
+ *
+ * returns 0 on success, -1 on a malformed object
+ *
+ */
+int iperf_seqwin_from_json(struct iperf_seqwin_counts *, cJSON *);
+
+#endif
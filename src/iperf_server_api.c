@@ -61,6 +61,8 @@
 #include "tcp_window_size.h"
 #include "iperf_util.h"
 #include "iperf_locale.h"
+#include "iperf_rr.h"
+#include "iperf_metrics.h"
 
 
 int
@@ -121,6 +123,8 @@ iperf_server_listen(struct iperf_test *test)
     FD_ZERO(&test->write_set);
     FD_SET(test->listener, &test->read_set);
     if (test->listener > test->max_fd) test->max_fd = test->listener;
+    if (test->metrics != NULL)
+	iperf_metrics_fdset(test);
 
     return 0;
 }
@@ -164,6 +168,8 @@ iperf_accept(struct iperf_test *test)
 	 * Don't try to read from the socket.  It could block an ongoing test. 
 	 * Just send ACCESS_DENIED.
 	 */
+	if (test->metrics != NULL)
+	    ++test->metrics->accept_denied;
         if (Nwrite(s, (char*) &rbuf, sizeof(rbuf), Ptcp) < 0) {
             i_errno = IESENDMESSAGE;
             return -1;
@@ -200,6 +206,8 @@ iperf_handle_message_server(struct iperf_test *test)
             break;
         case TEST_END:
 	    test->done = 1;
+	    if (test->rr != NULL && test->rr->connect)
+		iperf_crr_stop(test);
             cpu_util(test->cpu_util);
             test->stats_callback(test);
             SLIST_FOREACH(sp, &test->streams, streams) {
@@ -217,6 +225,14 @@ iperf_handle_message_server(struct iperf_test *test)
                 test->on_test_finish(test);
             test->reporter_callback(test);
             break;
+        case NEXT_TRIAL:
+	    /* Another --search trial; the streams were closed at TEST_END. */
+	    iperf_reset_trial(test);
+	    if (iperf_set_send_state(test, PARAM_EXCHANGE) != 0)
+                return -1;
+            if (iperf_exchange_parameters(test) < 0)
+                return -1;
+            break;
         case IPERF_DONE:
             break;
         case CLIENT_TERMINATE:
@@ -439,8 +455,8 @@ sigend_handler(int sig)
 }
 
 
-int
-iperf_run_server(struct iperf_test *test)
+static int
+run_server(struct iperf_test *test)
 {
     int result, s, streams_accepted;
     fd_set read_set, write_set;
@@ -497,7 +513,14 @@ iperf_run_server(struct iperf_test *test)
         }
 	if (result > 0) {
             if (FD_ISSET(test->listener, &read_set)) {
-                if (test->state != CREATE_STREAMS) {
+		/* --crr transactions arrive as connections of their own. */
+		if (test->state == TEST_RUNNING && test->rr != NULL && test->rr->connect) {
+		    if (iperf_crr_accept(test) < 0) {
+			cleanup_server(test);
+			return -1;
+		    }
+		    FD_CLR(test->listener, &read_set);
+		} else if (test->state != CREATE_STREAMS) {
                     if (iperf_accept(test) < 0) {
 			cleanup_server(test);
                         return -1;
@@ -511,6 +534,9 @@ iperf_run_server(struct iperf_test *test)
                     return -1;
 		}
                 FD_CLR(test->ctrl_sck, &read_set);                
+		/* A --search trial starts over with new streams. */
+		if (test->state == CREATE_STREAMS)
+		    streams_accepted = 0;
             }
 
             if (test->state == CREATE_STREAMS) {
@@ -612,8 +638,13 @@ iperf_run_server(struct iperf_test *test)
 			cleanup_server(test);
                         return -1;
 		    }
+		    if (test->rr != NULL && test->rr->connect)
+			iperf_crr_run(test, &read_set, &write_set);
                 }
             }
+
+	    if (test->metrics != NULL)
+		iperf_metrics_run(test, &read_set, &write_set);
         }
 
 	if (result == 0 ||
@@ -639,3 +670,21 @@ iperf_run_server(struct iperf_test *test)
 
     return 0;
 }
+
+/* One test; the --metrics counters see how each one ends. */
+int
+iperf_run_server(struct iperf_test *test)
+{
+    int result;
+
+    if (test->metrics_port != 0 && test->metrics == NULL &&
+	iperf_metrics_open(test) < 0)
+	return -1;
+    if (test->metrics != NULL) {
+	i_errno = IENONE;
+	test->metrics->active = 1;
+    }
+    result = run_server(test);
+    iperf_metrics_test_done(test, result);
+    return result;
+}
@@ -57,7 +57,7 @@ iperf_tcp_recv(struct iperf_stream *sp)
 {
     int r;
 
-    r = Nread(sp->socket, sp->buffer, sp->settings->blksize, Ptcp);
+    r = Nread_counted(sp->socket, sp->buffer, sp->settings->blksize, Ptcp, &sp->io);
 
     if (r < 0)
         return r;
@@ -79,9 +79,9 @@ iperf_tcp_send(struct iperf_stream *sp)
     int r;
 
     if (sp->test->zerocopy)
-	r = Nsendfile(sp->buffer_fd, sp->socket, sp->buffer, sp->settings->blksize);
+	r = Nsendfile_counted(sp->buffer_fd, sp->socket, sp->buffer, sp->send_size, &sp->io);
     else
-	r = Nwrite(sp->socket, sp->buffer, sp->settings->blksize, Ptcp);
+	r = Nwrite_counted(sp->socket, sp->buffer, sp->send_size, Ptcp, &sp->io);
 
     if (r < 0)
         return r;
@@ -289,7 +289,7 @@ iperf_tcp_listen(struct iperf_test *test)
 
         freeaddrinfo(res);
 
-        if (listen(s, 5) < 0) {
+        if (listen(s, SOMAXCONN) < 0) {
             i_errno = IESTREAMLISTEN;
             return -1;
         }
@@ -0,0 +1,328 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+/* iperf_tcpsample.c
+ *
+ * High-rate TCP_INFO sampling into per-stream rings.
+ */
+#include "iperf_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_tcpsample.h"
+#include "tcp_info_ext.h"
+#include "portable_endian.h"
+
+struct iperf_tcpsample_config *
+iperf_tcpsample_parse(const char *spec)
+{
+    struct iperf_tcpsample_config *ts;
+    char buf[TCPSAMPLE_MAX_SPEC];
+    char *file, *end;
+    double ms;
+
+    ts = (struct iperf_tcpsample_config *) malloc(sizeof(struct iperf_tcpsample_config));
+    if (ts == NULL) {
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    memset(ts, 0, sizeof(struct iperf_tcpsample_config));
+    if (strlen(spec) >= sizeof(buf))
+	goto bad;
+    strcpy(buf, spec);
+
+    file = strchr(buf, ',');
+    if (file != NULL) {
+	*file++ = '\0';
+	if (*file == '\0')
+	    goto bad;
+    }
+    ms = strtod(buf, &end);
+    if (end == buf || *end != '\0' ||
+	ms * 1000 < TCPSAMPLE_MIN_PERIOD || ms * 1000 > TCPSAMPLE_MAX_PERIOD)
+	goto bad;
+    ts->period = ms * 1000;
+    if (file != NULL && (ts->file_name = strdup(file)) == NULL) {
+	free(ts);
+	i_errno = IENEWTEST;
+	return NULL;
+    }
+    strcpy(ts->spec, spec);
+    return ts;
+
+  bad:
+    free(ts);
+    errno = EINVAL;
+    i_errno = IETCPSAMPLE;
+    return NULL;
+}
+
+void
+iperf_tcpsample_free(struct iperf_tcpsample_config *ts)
+{
+    if (ts == NULL)
+	return;
+    if (ts->timer != NULL)
+	tmr_cancel(ts->timer);
+    if (ts->file != NULL)
+	fclose(ts->file);
+    free(ts->file_name);
+    free(ts);
+}
+
+int
+iperf_tcpsample_attach(struct iperf_stream *sp)
+{
+    struct iperf_test *test = sp->test;
+    struct iperf_tcpsample_ring *r;
+    uint64_t size;
+
+    /* Room for the whole test, unless the file takes the samples away. */
+    if (test->tcpsample->file_name != NULL)
+	size = TCPSAMPLE_FILE_SAMPLES;
+    else if (test->duration == 0)
+	size = TCPSAMPLE_MAX_SAMPLES;
+    else {
+	size = (test->duration + test->omit + 1) * SEC_TO_US / test->tcpsample->period + 1;
+	if (size > TCPSAMPLE_MAX_SAMPLES)
+	    size = TCPSAMPLE_MAX_SAMPLES;
+    }
+
+    r = (struct iperf_tcpsample_ring *) calloc(1, sizeof(struct iperf_tcpsample_ring));
+    if (r == NULL) {
+	i_errno = IECREATESTREAM;
+	return -1;
+    }
+    r->samples = (struct iperf_tcpsample *) calloc(size, sizeof(struct iperf_tcpsample));
+    if (r->samples == NULL) {
+	free(r);
+	i_errno = IECREATESTREAM;
+	return -1;
+    }
+    r->size = size;
+    sp->tcpsample = r;
+    return 0;
+}
+
+void
+iperf_tcpsample_detach(struct iperf_stream *sp)
+{
+    if (sp->tcpsample == NULL)
+	return;
+    free(sp->tcpsample->samples);
+    free(sp->tcpsample);
+    sp->tcpsample = NULL;
+}
+
+static int
+tcpsample_write_header(struct iperf_tcpsample_config *ts)
+{
+    uint32_t words[4];
+
+    words[0] = htonl(TCPSAMPLE_VERSION);
+    words[1] = htonl(TCPSAMPLE_RECORD_SIZE);
+    words[2] = htonl(ts->period);
+    words[3] = 0;
+    if (fwrite(TCPSAMPLE_MAGIC, 8, 1, ts->file) != 1 ||
+	fwrite(words, sizeof(words), 1, ts->file) != 1)
+	return -1;
+    return 0;
+}
+
+/* Write out and forget the samples in a stream's ring. */
+static void
+tcpsample_write(struct iperf_test *test, struct iperf_stream *sp)
+{
+    struct iperf_tcpsample_ring *r = sp->tcpsample;
+    struct iperf_tcpsample *s;
+    unsigned char rec[TCPSAMPLE_RECORD_SIZE];
+    uint32_t w[8];
+    uint64_t q;
+
+    for (; r->tail < r->head; ++r->tail) {
+	s = &r->samples[r->tail % r->size];
+	q = htobe64(s->time);
+	memcpy(rec, &q, 8);
+	w[0] = htonl(sp->id);
+	w[1] = htonl(s->cwnd);
+	w[2] = htonl(s->rtt);
+	w[3] = htonl(s->rttvar);
+	w[4] = htonl(s->unacked);
+	w[5] = htonl(s->retrans);
+	w[6] = htonl(s->lost);
+	w[7] = 0;
+	memcpy(rec + 8, w, sizeof(w));
+	q = htobe64(s->pacing_rate);
+	memcpy(rec + 40, &q, 8);
+	q = htobe64(s->delivery_rate);
+	memcpy(rec + 48, &q, 8);
+	if (fwrite(rec, sizeof(rec), 1, test->tcpsample->file) != 1) {
+	    iperf_err(test, "--tcpinfo-sample file write failed: %s", strerror(errno));
+	    r->tail = r->head;
+	    return;
+	}
+    }
+}
+
+static void
+tcpsample_timer_proc(TimerClientData client_data, struct timeval *nowP)
+{
+    struct iperf_test *test = client_data.p;
+    struct iperf_tcpsample_config *ts = test->tcpsample;
+    struct iperf_stream *sp;
+    struct iperf_tcpsample_ring *r;
+    struct iperf_tcpsample *s;
+    struct iperf_tcp_info_ext ti;
+    uint64_t t;
+    int len;
+
+    t = (nowP->tv_sec - ts->start.tv_sec) * SEC_TO_US + (nowP->tv_usec - ts->start.tv_usec);
+    SLIST_FOREACH(sp, &test->streams, streams) {
+	r = sp->tcpsample;
+	if (r == NULL || (len = get_tcpinfo_ext(sp->socket, &ti)) < 0)
+	    continue;
+	/* A timer that fell behind catches up in one go; keep one sample. */
+	if (r->head > r->tail && t < r->samples[(r->head - 1) % r->size].time + ts->period / 2)
+	    continue;
+	if (r->head - r->tail == r->size)
+	    ++r->tail;			/* full: overwrite the oldest */
+	s = &r->samples[r->head % r->size];
+	s->time = t;
+	s->cwnd = ti.tcpi_snd_cwnd * ti.tcpi_snd_mss;
+	s->rtt = ti.tcpi_rtt;
+	s->rttvar = ti.tcpi_rttvar;
+	s->unacked = ti.tcpi_unacked;
+	s->retrans = ti.tcpi_total_retrans;
+	s->lost = ti.tcpi_lost;
+	s->pacing_rate = TCP_INFO_EXT_HAS(len, tcpi_pacing_rate) ? ti.tcpi_pacing_rate : 0;
+	s->delivery_rate = TCP_INFO_EXT_HAS(len, tcpi_delivery_rate) ? ti.tcpi_delivery_rate : 0;
+	++r->head;
+	if (ts->file != NULL && r->head - r->tail >= r->size / 2)
+	    tcpsample_write(test, sp);
+    }
+}
+
+int
+iperf_tcpsample_start(struct iperf_test *test)
+{
+    struct iperf_tcpsample_config *ts = test->tcpsample;
+    TimerClientData cd;
+
+    if (ts->file_name != NULL && ts->file == NULL) {
+	ts->file = fopen(ts->file_name, "w");
+	if (ts->file == NULL || tcpsample_write_header(ts) < 0) {
+	    i_errno = IETCPSAMPLE;
+	    return -1;
+	}
+    }
+    if (gettimeofday(&ts->start, NULL) < 0) {
+	i_errno = IEINITTEST;
+	return -1;
+    }
+    cd.p = test;
+    ts->timer = tmr_create(&ts->start, tcpsample_timer_proc, cd, ts->period, 1);
+    if (ts->timer == NULL) {
+	i_errno = IEINITTEST;
+	return -1;
+    }
+    return 0;
+}
+
+void
+iperf_tcpsample_stop(struct iperf_test *test)
+{
+    struct iperf_tcpsample_config *ts = test->tcpsample;
+    struct iperf_stream *sp;
+
+    if (ts->timer != NULL) {
+	tmr_cancel(ts->timer);
+	ts->timer = NULL;
+    }
+    if (ts->file == NULL)
+	return;
+    SLIST_FOREACH(sp, &test->streams, streams)
+	if (sp->tcpsample != NULL)
+	    tcpsample_write(test, sp);
+    fflush(ts->file);
+}
+
+static void
+tcpsample_add_column(cJSON *j, const char *name, struct iperf_tcpsample_ring *r, size_t offset, int wide)
+{
+    cJSON *a;
+    uint64_t i;
+    const char *p;
+
+    a = cJSON_CreateArray();
+    if (a == NULL)
+	return;
+    for (i = r->tail; i < r->head; ++i) {
+	p = (const char *) &r->samples[i % r->size] + offset;
+	cJSON_AddItemToArray(a, cJSON_CreateInt(wide ? *(const uint64_t *) p : *(const uint32_t *) p));
+    }
+    cJSON_AddItemToObject(j, name, a);
+}
+
+cJSON *
+iperf_tcpsample_to_json(struct iperf_test *test, struct iperf_stream *sp)
+{
+    struct iperf_tcpsample_ring *r = sp->tcpsample;
+    cJSON *j;
+
+    j = cJSON_CreateObject();
+    if (j == NULL)
+	return NULL;
+    cJSON_AddFloatToObject(j, "period_ms", test->tcpsample->period / 1000.0);
+    if (test->tcpsample->file != NULL) {
+	cJSON_AddStringToObject(j, "file", test->tcpsample->file_name);
+	cJSON_AddIntToObject(j, "samples", r->head);
+	return j;
+    }
+    /* Without a file, the ring only moves its tail to overwrite. */
+    cJSON_AddIntToObject(j, "dropped", r->tail);
+    tcpsample_add_column(j, "time_us", r, offsetof(struct iperf_tcpsample, time), 1);
+    tcpsample_add_column(j, "cwnd", r, offsetof(struct iperf_tcpsample, cwnd), 0);
+    tcpsample_add_column(j, "rtt", r, offsetof(struct iperf_tcpsample, rtt), 0);
+    tcpsample_add_column(j, "rttvar", r, offsetof(struct iperf_tcpsample, rttvar), 0);
+    tcpsample_add_column(j, "pacing_rate", r, offsetof(struct iperf_tcpsample, pacing_rate), 1);
+    tcpsample_add_column(j, "delivery_rate", r, offsetof(struct iperf_tcpsample, delivery_rate), 1);
+    tcpsample_add_column(j, "unacked", r, offsetof(struct iperf_tcpsample, unacked), 0);
+    tcpsample_add_column(j, "retrans", r, offsetof(struct iperf_tcpsample, retrans), 0);
+    tcpsample_add_column(j, "lost", r, offsetof(struct iperf_tcpsample, lost), 0);
+    return j;
+}
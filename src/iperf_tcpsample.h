@@ -0,0 +1,149 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef __IPERF_TCPSAMPLE_H
+#define __IPERF_TCPSAMPLE_H
+
+#include <stdio.h>
+#include <sys/time.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "timer.h"
+#include "cjson.h"
+
+/*
+ * High-rate TCP_INFO sampling (--tcpinfo-sample, Linux only).
+ *
+ * A timer on the client reads TCP_INFO from every stream socket each
+ * period, in addition to the once-per-interval read for the reports.
+ * Samples go into a ring preallocated for each stream, so the timer
+ * never allocates.  Without a file the ring is sized for the whole
+ * test (up to TCPSAMPLE_MAX_SAMPLES, after which the oldest samples
+ * are overwritten) and ends up in the JSON output as one array per
+ * field.  With a file the ring is written out whenever it is half full
+ * and at the end, as binary records:
+ *
+ *   header:  "iperf3ts", version, record size, period in us, 0
+ *            (8 bytes and four 32-bit words)
+ *   record:  time in us since sampling started (64 bits), stream id,
+ *            cwnd, rtt, rttvar, unacked, retrans, lost, 0 (32 bits
+ *            each), pacing_rate, delivery_rate (64 bits each)
+ *
+ * all in network byte order.  Units are as in TCP_INFO, except that
+ * cwnd is in bytes; the rates are bytes per second, and are 0 on
+ * kernels too old to report them.
+ */
+
+#define TCPSAMPLE_MAX_SPEC 256
+#define TCPSAMPLE_MIN_PERIOD 100		/* us */
+#define TCPSAMPLE_MAX_PERIOD 1000000		/* us */
+#define TCPSAMPLE_MAX_SAMPLES 65536		/* per stream, without a file */
+#define TCPSAMPLE_FILE_SAMPLES 4096		/* per stream, with a file */
+#define TCPSAMPLE_MAGIC "iperf3ts"
+#define TCPSAMPLE_VERSION 1
+#define TCPSAMPLE_RECORD_SIZE 56
+
+struct iperf_tcpsample
+{
+    uint64_t  time;			/* us since sampling started */
+    uint32_t  cwnd;			/* bytes */
+    uint32_t  rtt;			/* us */
+    uint32_t  rttvar;			/* us */
+    uint32_t  unacked;			/* segments */
+    uint32_t  retrans;			/* segments retransmitted, whole connection */
+    uint32_t  lost;			/* segments */
+    uint64_t  pacing_rate;		/* bytes/sec */
+    uint64_t  delivery_rate;		/* bytes/sec */
+};
+
+/* Per stream. */
+struct iperf_tcpsample_ring
+{
+    struct iperf_tcpsample *samples;
+    uint32_t  size;
+    uint64_t  head;			/* samples taken */
+    uint64_t  tail;			/* oldest sample still in the ring */
+};
+
+/* Per test. */
+struct iperf_tcpsample_config
+{
+    int       period;			/* us */
+    char     *file_name;		/* or NULL for JSON output */
+    FILE     *file;
+    struct timeval start;
+    Timer    *timer;
+    char      spec[TCPSAMPLE_MAX_SPEC];
+};
+
+struct iperf_test;
+struct iperf_stream;
+
+/**
+ * iperf_tcpsample_parse -- parse a --tcpinfo-sample spec:
+ *   period_ms[,file]
+ *
+ * returns a new configuration, or NULL and sets i_errno to IETCPSAMPLE
+ *
+ */
+struct iperf_tcpsample_config *iperf_tcpsample_parse(const char *spec);
+
+void iperf_tcpsample_free(struct iperf_tcpsample_config *);
+
+/**
+ * iperf_tcpsample_attach -- give a new stream its ring
+ *
+ * returns 0, or -1 and sets i_errno
+ *
+ */
+int iperf_tcpsample_attach(struct iperf_stream *);
+
+void iperf_tcpsample_detach(struct iperf_stream *);
+
+/**
+ * iperf_tcpsample_start -- open the file and start the timer
+ *
+ * returns 0, or -1 and sets i_errno
+ *
+ */
+int iperf_tcpsample_start(struct iperf_test *);
+
+/**
+ * iperf_tcpsample_stop -- stop the timer and write out what is left
+ *
+ */
+void iperf_tcpsample_stop(struct iperf_test *);
+
+/**
+ * iperf_tcpsample_to_json -- a stream's samples, oldest first, as
+ *   {"period_ms": n, "dropped": n, "time_us": [...], "cwnd": [...], ...}
+ *
+ */
+cJSON *iperf_tcpsample_to_json(struct iperf_test *, struct iperf_stream *);
+
+#endif
@@ -24,6 +24,8 @@
  * This code is distributed under a BSD style license, see the LICENSE
  * file for complete information.
  */
+#include "iperf_config.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,6 +40,11 @@
 #endif
 #include <sys/time.h>
 #include <sys/select.h>
+#include <time.h>
+#include <sys/uio.h>
+#if defined(HAVE_SO_TXTIME)
+#include <linux/net_tstamp.h>
+#endif /* HAVE_SO_TXTIME */
 
 #include "iperf.h"
 #include "iperf_api.h"
@@ -47,6 +54,162 @@
 #include "net.h"
 #include "portable_endian.h"
 
+/*
+ * Size of the fixed part of the UDP test packet header: seconds,
+ * microseconds and the packet counter.  With --txtime the intended
+ * departure time (64 bits, nanoseconds) follows immediately after.
+ */
+static int
+udp_header_len(struct iperf_test *test)
+{
+    return test->udp_counters_64bit ? 16 : 12;
+}
+
+/*
+ * Clock used for --txtime departure times.  The etf qdisc requires
+ * CLOCK_TAI, fq and the software scheduler use CLOCK_MONOTONIC.
+ */
+static clockid_t
+txtime_clock(struct iperf_test *test)
+{
+#if defined(CLOCK_TAI)
+    if (test->txtime == TXTIME_ETF)
+	return CLOCK_TAI;
+#endif
+    return CLOCK_MONOTONIC;
+}
+
+static uint64_t
+txtime_now(struct iperf_test *test)
+{
+    struct timespec ts;
+
+    clock_gettime(txtime_clock(test), &ts);
+    return (uint64_t) ts.tv_sec * SEC_TO_NS + ts.tv_nsec;
+}
+
+/*
+ * Time between the starts of two consecutive bursts (one packet, if
+ * no burst was given) at the target rate.
+ */
+static uint64_t
+txtime_gap(struct iperf_test *test)
+{
+    int burst = test->settings->burst ? test->settings->burst : 1;
+
+    return (uint64_t) test->settings->blksize * 8 * burst * SEC_TO_NS / test->settings->rate;
+}
+
+/*
+ * How late a software-paced packet may go out before it is dropped:
+ * one gap, but no less than the send timer period, or every timer tick
+ * would drop the packets whose slots passed while we slept.
+ */
+static uint64_t
+txtime_slack(struct iperf_test *test)
+{
+    uint64_t gap = txtime_gap(test);
+
+    return gap > TXTIME_SW_MIN_PERIOD * uS_TO_NS ? gap : TXTIME_SW_MIN_PERIOD * uS_TO_NS;
+}
+
+/*
+ * Receiver side of --txtime: compare the spacing the sender intended
+ * between two consecutive datagrams with the spacing they arrived with.
+ */
+static void
+txtime_account(struct iperf_stream *sp, uint64_t pcount, uint64_t departure, uint64_t arrival)
+{
+    double error;
+
+    if (sp->txtime_prev_pcount != 0 && pcount == sp->txtime_prev_pcount + 1) {
+	error = (double) (int64_t) (arrival - sp->txtime_prev_arrival) -
+	        (double) (int64_t) (departure - sp->txtime_prev_departure);
+	if (error < 0)
+	    error = -error;
+	sp->txtime_error_sum += error;
+	if (error > sp->txtime_error_max)
+	    sp->txtime_error_max = error;
+	++sp->txtime_error_count;
+    }
+    sp->txtime_prev_pcount = pcount;
+    sp->txtime_prev_departure = departure;
+    sp->txtime_prev_arrival = arrival;
+}
+
+/*
+ * Read one datagram.  If the kernel attached a receive timestamp
+ * (SO_TIMESTAMPNS or SO_TIMESTAMP, see udp_set_rx_timestamps) it is
+ * returned in *arrival; otherwise *arrival is zeroed and the caller
+ * has to fall back to reading the clock itself.  A SO_RXQ_OVFL count
+ * of datagrams the socket dropped, if attached, goes into
+ * sp->socket_drops.  Return values follow Nread().
+ */
+static int
+udp_recv_timestamped(struct iperf_stream *sp, int size, struct timespec *arrival)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    ssize_t r;
+
+    iov.iov_base = sp->buffer;
+    iov.iov_len = size;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    arrival->tv_sec = 0;
+    arrival->tv_nsec = 0;
+
+    r = recvmsg(sp->socket, &msg, 0);
+    ++sp->io.calls;
+    if (r < 0) {
+	if (errno == EINTR || errno == EAGAIN) {
+	    ++sp->io.eagain;
+	    return 0;
+	}
+	return NET_HARDERROR;
+    }
+    sp->io.bytes += r;
+    if (r < size)
+	++sp->io.short_io;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	if (cmsg->cmsg_level != SOL_SOCKET)
+	    continue;
+#if defined(SCM_TIMESTAMPNS)
+	if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+	    memcpy(arrival, CMSG_DATA(cmsg), sizeof(*arrival));
+	    continue;
+	}
+#endif /* SCM_TIMESTAMPNS */
+#if defined(SCM_TIMESTAMP)
+	if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+	    struct timeval tv;
+
+	    memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+	    arrival->tv_sec = tv.tv_sec;
+	    arrival->tv_nsec = tv.tv_usec * uS_TO_NS;
+	    continue;
+	}
+#endif /* SCM_TIMESTAMP */
+#if defined(SO_RXQ_OVFL)
+	if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+	    uint32_t drops;
+
+	    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+	    sp->socket_drops = drops;
+	}
+#endif /* SO_RXQ_OVFL */
+    }
+
+    return r;
+}
+
 /* iperf_udp_recv
  *
  * receives the data for UDP
@@ -59,9 +222,11 @@ iperf_udp_recv(struct iperf_stream *sp)
     int       r;
     int       size = sp->settings->blksize;
     double    transit = 0, d = 0;
-    struct timeval sent_time, arrival_time;
+    struct timeval sent_time;
+    struct timespec arrival_time;
+    uint64_t  departure = 0;
 
-    r = Nread(sp->socket, sp->buffer, size, Pudp);
+    r = udp_recv_timestamped(sp, size, &arrival_time);
 
     /*
      * If we got an error in the read, or if we didn't read anything
@@ -95,29 +260,82 @@ iperf_udp_recv(struct iperf_stream *sp)
 	sent_time.tv_sec = sec;
 	sent_time.tv_usec = usec;
     }
+    if (sp->test->txtime && r >= udp_header_len(sp->test) + sizeof(departure)) {
+	memcpy(&departure, sp->buffer + udp_header_len(sp->test), sizeof(departure));
+	departure = be64toh(departure);
+    }
 
-    /* Out of order packets */
-    if (pcount >= sp->packet_count + 1) {
-        if (pcount > sp->packet_count + 1) {
-            sp->cnt_error += (pcount - 1) - sp->packet_count;
-        }
-        sp->packet_count = pcount;
-    } else {
-        sp->outoforder_packets++;
-	iperf_err(sp->test, "OUT OF ORDER - incoming packet = %zu and received packet = %d AND SP = %d", pcount, sp->packet_count, sp->socket);
+    /*
+     * Out of order packets.  A gap is counted as lost straight away, so
+     * that the interval reports stay current; a late datagram that
+     * fills it takes its loss back.  Duplicates are neither.
+     */
+    switch (iperf_seqwin_record(sp->seqwin, pcount)) {
+	case SEQWIN_NEW:
+	    if (pcount > sp->packet_count + 1) {
+		sp->cnt_error += (pcount - 1) - sp->packet_count;
+	    }
+	    sp->packet_count = pcount;
+	    break;
+	case SEQWIN_LATE:
+	    if (sp->cnt_error > 0)
+		sp->cnt_error--;
+	    /* FALLTHROUGH */
+	case SEQWIN_STALE:
+	    sp->outoforder_packets++;
+	    if (sp->test->debug)
+		iperf_err(sp->test, "OUT OF ORDER - incoming packet = %zu and received packet = %d AND SP = %d", pcount, sp->packet_count, sp->socket);
+	    break;
+	case SEQWIN_DUPLICATE:
+	    break;
     }
 
-    /* jitter measurement */
-    gettimeofday(&arrival_time, NULL);
+    /*
+     * Jitter measurement.  Prefer the kernel's receive timestamp, so
+     * that time the packet spent waiting for us to get scheduled is
+     * not counted as network jitter.
+     */
+    if (arrival_time.tv_sec == 0) {
+	struct timeval now;
 
-    transit = timeval_diff(&sent_time, &arrival_time);
-    d = transit - sp->prev_transit;
-    if (d < 0)
-        d = -d;
+	gettimeofday(&now, NULL);
+	arrival_time.tv_sec = now.tv_sec;
+	arrival_time.tv_nsec = now.tv_usec * uS_TO_NS;
+    }
+
+    /*
+     * Relative transit time, R - S.  The two hosts' clocks need not be
+     * synchronized since only differences between packets are used.
+     * Jitter is the RFC 3550 (section 6.4.1) estimator,
+     *     J += (|D(i-1,i)| - J) / 16,
+     * where D(i-1,i) = (R_i - S_i) - (R_i-1 - S_i-1).
+     *
+     * The distributions of the transit time (the one-way delay, which
+     * is only meaningful when the clocks are synchronized) and of
+     * |D(i-1,i)| are kept in histograms, since the tail matters more
+     * than the smoothed mean.  The first packet has no predecessor,
+     * so it contributes no D.
+     */
+    transit = (arrival_time.tv_sec - sent_time.tv_sec) +
+	      (arrival_time.tv_nsec / 1e9 - sent_time.tv_usec / 1e6);
+    if (sp->owd_hist != NULL) {
+	iperf_histogram_record(sp->owd_hist, (int64_t) (transit * SEC_TO_NS));
+	iperf_histogram_record(sp->owd_hist_interval, (int64_t) (transit * SEC_TO_NS));
+    }
+    if (sp->prev_transit != 0) {
+	d = transit - sp->prev_transit;
+	if (d < 0)
+	    d = -d;
+	sp->jitter += (d - sp->jitter) / 16.0;
+	if (sp->ipdv_hist != NULL) {
+	    iperf_histogram_record(sp->ipdv_hist, (int64_t) (d * SEC_TO_NS));
+	    iperf_histogram_record(sp->ipdv_hist_interval, (int64_t) (d * SEC_TO_NS));
+	}
+    }
     sp->prev_transit = transit;
-    // XXX: This is NOT the way to calculate jitter
-    //      J = |(R1 - S1) - (R0 - S0)| [/ number of packets, for average]
-    sp->jitter += (d - sp->jitter) / 16.0;
+
+    if (departure != 0)
+	txtime_account(sp, pcount, departure, (uint64_t) arrival_time.tv_sec * SEC_TO_NS + (uint64_t) arrival_time.tv_nsec);
 
     if (sp->test->debug) {
 	fprintf(stderr, "packet_count %d\n", sp->packet_count);
@@ -127,6 +345,93 @@ iperf_udp_recv(struct iperf_stream *sp)
 }
 
 
+#if defined(HAVE_SO_TXTIME)
+/*
+ * Send one datagram with its departure time attached as an SCM_TXTIME
+ * control message.  Error handling follows Nwrite().
+ */
+static int
+udp_send_txtime(struct iperf_stream *sp, int size, uint64_t departure)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(sizeof(departure))];
+    ssize_t r;
+
+    iov.iov_base = sp->buffer;
+    iov.iov_len = size;
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(departure));
+    memcpy(CMSG_DATA(cmsg), &departure, sizeof(departure));
+
+    r = sendmsg(sp->socket, &msg, 0);
+    ++sp->io.calls;
+    if (r < 0) {
+	switch (errno) {
+	    case EINTR:
+	    case EAGAIN:
+	    ++sp->io.eagain;
+	    return 0;
+
+	    case ENOBUFS:
+	    ++sp->io.soft_errors;
+	    return NET_SOFTERROR;
+
+	    default:
+	    return NET_HARDERROR;
+	}
+    }
+    sp->io.bytes += r;
+    return r;
+}
+#endif /* HAVE_SO_TXTIME */
+
+
+/* iperf_udp_txtime_ready
+ *
+ * With --txtime the send throttle follows the departure schedule
+ * instead of the average rate.  The kernel modes may queue packets up
+ * to TXTIME_HORIZON_NS ahead; the software mode only sends on time.
+ */
+int
+iperf_udp_txtime_ready(struct iperf_stream *sp)
+{
+    uint64_t now;
+
+    if (sp->txtime_next == 0)
+	return 1;
+    now = txtime_now(sp->test);
+    if (sp->test->txtime == TXTIME_SW)
+	return sp->txtime_next <= now;
+    return sp->txtime_next <= now + TXTIME_HORIZON_NS;
+}
+
+
+/* iperf_udp_txtime_period
+ *
+ * How often the send timer re-checks the schedule, in usec.
+ */
+long
+iperf_udp_txtime_period(struct iperf_test *test)
+{
+    long period;
+
+    if (test->txtime != TXTIME_SW)
+	return TXTIME_HORIZON_NS / 4 / uS_TO_NS;
+    period = txtime_gap(test) / uS_TO_NS;
+    return period > TXTIME_SW_MIN_PERIOD ? period : TXTIME_SW_MIN_PERIOD;
+}
+
+
 /* iperf_udp_send
  *
  * sends the data for UDP
@@ -135,11 +440,38 @@ int
 iperf_udp_send(struct iperf_stream *sp)
 {
     int r;
-    int       size = sp->settings->blksize;
+    int       size = sp->send_size;
     struct timeval before;
+    uint64_t  departure = 0, now;
 
     gettimeofday(&before, 0);
 
+    if (sp->test->txtime) {
+	/*
+	 * Take the next slot off the departure schedule.  Packets of
+	 * one burst share a departure time; the schedule advances by a
+	 * whole burst gap once the burst is complete.
+	 */
+	now = txtime_now(sp->test);
+	if (sp->txtime_next == 0)
+	    sp->txtime_next = now + (sp->test->txtime == TXTIME_SW ? 0 : TXTIME_HORIZON_NS / 10);
+	departure = sp->txtime_next;
+	if (++sp->txtime_burst_pos >= (sp->settings->burst ? sp->settings->burst : 1)) {
+	    sp->txtime_burst_pos = 0;
+	    sp->txtime_next += txtime_gap(sp->test);
+	}
+	if (sp->test->txtime == TXTIME_SW && now >= departure + txtime_slack(sp->test)) {
+	    /*
+	     * Missed the slot entirely.  Drop the packet the way etf
+	     * would, but still consume its sequence number so that the
+	     * receiver accounts for it as lost.
+	     */
+	    ++sp->packet_count;
+	    ++sp->txtime_late;
+	    return 0;
+	}
+    }
+
     ++sp->packet_count;
 
     if (sp->test->udp_counters_64bit) {
@@ -170,7 +502,17 @@ iperf_udp_send(struct iperf_stream *sp)
 	
     }
 
-    r = Nwrite(sp->socket, sp->buffer, size, Pudp);
+    if (sp->test->txtime) {
+	uint64_t dep = htobe64(departure);
+	memcpy(sp->buffer + udp_header_len(sp->test), &dep, sizeof(dep));
+    }
+
+#if defined(HAVE_SO_TXTIME)
+    if (sp->test->txtime == TXTIME_FQ || sp->test->txtime == TXTIME_ETF)
+	r = udp_send_txtime(sp, size, departure);
+    else
+#endif /* HAVE_SO_TXTIME */
+	r = Nwrite_counted(sp->socket, sp->buffer, size, Pudp, &sp->io);
 
     if (r < 0)
 	return r;
@@ -193,6 +535,93 @@ iperf_udp_send(struct iperf_stream *sp)
  * connection knows about each other before the real data transfers begin.
  */
 
+/*
+ * Turn on SO_TXTIME for a stream socket we are going to send on, if
+ * one of the kernel-scheduled --txtime modes was requested.
+ */
+static int
+udp_set_txtime(struct iperf_test *test, int s)
+{
+    if (!test->sender || (test->txtime != TXTIME_FQ && test->txtime != TXTIME_ETF))
+	return 0;
+#if defined(HAVE_SO_TXTIME)
+    struct sock_txtime st;
+
+    memset(&st, 0, sizeof(st));
+    st.clockid = txtime_clock(test);
+    if (setsockopt(s, SOL_SOCKET, SO_TXTIME, &st, sizeof(st)) < 0) {
+	i_errno = IESETTXTIME;
+	return -1;
+    }
+    return 0;
+#else /* HAVE_SO_TXTIME */
+    i_errno = IESETTXTIME;
+    errno = ENOPROTOOPT;
+    return -1;
+#endif /* HAVE_SO_TXTIME */
+}
+
+/*
+ * Have the kernel timestamp datagrams as they arrive on a stream
+ * socket we are going to receive on.  This is best effort; without it
+ * iperf_udp_recv timestamps packets itself.
+ */
+static void
+udp_set_rx_timestamps(struct iperf_test *test, int s)
+{
+    int on = 1;
+
+    if (test->sender)
+	return;
+#if defined(SO_TIMESTAMPNS)
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0)
+	return;
+#endif /* SO_TIMESTAMPNS */
+#if defined(SO_TIMESTAMP)
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) == 0)
+	return;
+#endif /* SO_TIMESTAMP */
+    if (test->debug)
+	printf("kernel receive timestamps not available, using gettimeofday\n");
+}
+
+/*
+ * Have the kernel tell a receiving stream socket how many datagrams
+ * it dropped because its buffer was full, so that they can be told
+ * apart from loss in the network.  Best effort, like the timestamps.
+ */
+static void
+udp_set_rxq_ovfl(struct iperf_test *test, int s)
+{
+#if defined(SO_RXQ_OVFL)
+    int on = 1;
+
+    if (test->sender)
+	return;
+    if (setsockopt(s, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == 0)
+	return;
+#endif /* SO_RXQ_OVFL */
+    if (test->debug && !test->sender)
+	printf("socket overflow drop counts not available\n");
+}
+
+/*
+ * Whether stream socket s reports its overflow drops (see
+ * udp_set_rxq_ovfl).
+ */
+int
+iperf_udp_rxq_ovfl(int s)
+{
+#if defined(SO_RXQ_OVFL)
+    int on = 0;
+    socklen_t len = sizeof(on);
+
+    if (getsockopt(s, SOL_SOCKET, SO_RXQ_OVFL, &on, &len) == 0 && on)
+	return 1;
+#endif /* SO_RXQ_OVFL */
+    return 0;
+}
+
 /*
  * iperf_udp_accept
  *
@@ -243,6 +672,10 @@ iperf_udp_accept(struct iperf_test *test)
             return -1;
         }
     }
+    if (udp_set_txtime(test, s) < 0)
+        return -1;
+    udp_set_rx_timestamps(test, s);
+    udp_set_rxq_ovfl(test, s);
 
     /*
      * Create a new "listening" socket to replace the one we were using before.
@@ -322,6 +755,10 @@ iperf_udp_connect(struct iperf_test *test)
             return -1;
         }
     }
+    if (udp_set_txtime(test, s) < 0)
+        return -1;
+    udp_set_rx_timestamps(test, s);
+    udp_set_rxq_ovfl(test, s);
 
     /*
      * Write a datagram to the UDP stream to let the server know we're here.
@@ -60,5 +60,25 @@ int iperf_udp_connect(struct iperf_test *);
 
 int iperf_udp_init(struct iperf_test *);
 
+/**
+ * iperf_udp_rxq_ovfl -- whether a stream socket reports the datagrams
+ * it dropped on buffer overflow (SO_RXQ_OVFL)
+ *
+ */
+int iperf_udp_rxq_ovfl(int s);
+
+/**
+ * iperf_udp_txtime_ready -- whether the next scheduled departure of a
+ * --txtime stream is due (or within the kernel queueing horizon)
+ *
+ */
+int iperf_udp_txtime_ready(struct iperf_stream *);
+
+/**
+ * iperf_udp_txtime_period -- send timer period in usec for --txtime
+ *
+ */
+long iperf_udp_txtime_period(struct iperf_test *);
+
 
 #endif
@@ -29,6 +29,7 @@
  * Iperf utility functions
  *
  */
+#define _GNU_SOURCE /* for RUSAGE_THREAD */
 #include "iperf_config.h"
 
 #include <stdio.h>
@@ -211,6 +212,26 @@ cpu_util(double pcpu[3])
     pcpu[2] = (systemdiff / timediff) * 100;
 }
 
+/* thread_cpu
+ *
+ * The user and system CPU time of the calling thread so far, in
+ * seconds.  Where RUSAGE_THREAD is not available this is the whole
+ * process, which for iperf3's single I/O thread is nearly the same.
+ */
+
+void
+thread_cpu(double t[2])
+{
+    struct rusage r;
+
+#if defined(RUSAGE_THREAD)
+    if (getrusage(RUSAGE_THREAD, &r) < 0)
+#endif
+	getrusage(RUSAGE_SELF, &r);
+    t[0] = r.ru_utime.tv_sec + r.ru_utime.tv_usec / 1000000.0;
+    t[1] = r.ru_stime.tv_sec + r.ru_stime.tv_usec / 1000000.0;
+}
+
 const char *
 get_system_info(void)
 {
@@ -285,6 +306,26 @@ get_optional_features(void)
     numfeatures++;
 #endif /* HAVE_SENDFILE */
 
+#if defined(HAVE_SO_TXTIME)
+    if (numfeatures > 0) {
+	strncat(features, ", ",
+		sizeof(features) - strlen(features) - 1);
+    }
+    strncat(features, "SO_TXTIME departure scheduling",
+	sizeof(features) - strlen(features) - 1);
+    numfeatures++;
+#endif /* HAVE_SO_TXTIME */
+
+#if defined(HAVE_PERF_EVENT)
+    if (numfeatures > 0) {
+	strncat(features, ", ",
+		sizeof(features) - strlen(features) - 1);
+    }
+    strncat(features, "perf_event counters",
+	sizeof(features) - strlen(features) - 1);
+    numfeatures++;
+#endif /* HAVE_PERF_EVENT */
+
     if (numfeatures == 0) {
 	strncat(features, "None", 
 		sizeof(features) - strlen(features) - 1);
@@ -44,6 +44,8 @@ int delay(int64_t ns);
 
 void cpu_util(double pcpu[3]);
 
+void thread_cpu(double t[2]);
+
 const char* get_system_info(void);
 
 const char* get_optional_features(void);
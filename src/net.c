@@ -38,6 +38,13 @@
 #include <netdb.h>
 #include <string.h>
 #include <sys/fcntl.h>
+#include <sys/ioctl.h>
+#ifdef linux
+#include <linux/sockios.h>
+#endif
+#ifdef HAVE_SO_MEMINFO
+#include <linux/sock_diag.h>
+#endif
 
 #ifdef HAVE_SENDFILE
 #ifdef linux
@@ -200,7 +207,8 @@ netannounce(int domain, int proto, char *local, int port)
     freeaddrinfo(res);
     
     if (proto == SOCK_STREAM) {
-        if (listen(s, 5) < 0) {
+	/* A deep backlog lets --crr connections queue rather than be refused. */
+        if (listen(s, SOMAXCONN) < 0) {
 	    close(s);
             return -1;
         }
@@ -214,22 +222,36 @@ netannounce(int domain, int proto, char *local, int port)
 /* reads 'count' bytes from a socket  */
 /********************************************************************/
 
+/* Where the uncounted calls count. */
+static struct net_stats net_stats_discard;
+
 int
 Nread(int fd, char *buf, size_t count, int prot)
+{
+    return Nread_counted(fd, buf, count, prot, &net_stats_discard);
+}
+
+int
+Nread_counted(int fd, char *buf, size_t count, int prot, struct net_stats *ns)
 {
     register ssize_t r;
     register size_t nleft = count;
 
     while (nleft > 0) {
         r = read(fd, buf, nleft);
+	++ns->calls;
         if (r < 0) {
-            if (errno == EINTR || errno == EAGAIN)
+            if (errno == EINTR || errno == EAGAIN) {
+		++ns->eagain;
                 break;
-            else
+	    } else
                 return NET_HARDERROR;
         } else if (r == 0)
             break;
 
+	ns->bytes += r;
+	if (r < nleft)
+	    ++ns->short_io;
         nleft -= r;
         buf += r;
     }
@@ -243,26 +265,40 @@ Nread(int fd, char *buf, size_t count, int prot)
 
 int
 Nwrite(int fd, const char *buf, size_t count, int prot)
+{
+    return Nwrite_counted(fd, buf, count, prot, &net_stats_discard);
+}
+
+int
+Nwrite_counted(int fd, const char *buf, size_t count, int prot, struct net_stats *ns)
 {
     register ssize_t r;
     register size_t nleft = count;
 
     while (nleft > 0) {
 	r = write(fd, buf, nleft);
+	++ns->calls;
 	if (r < 0) {
 	    switch (errno) {
 		case EINTR:
 		case EAGAIN:
+		++ns->eagain;
 		return count - nleft;
 
 		case ENOBUFS:
+		++ns->soft_errors;
 		return NET_SOFTERROR;
 
 		default:
 		return NET_HARDERROR;
 	    }
-	} else if (r == 0)
+	} else if (r == 0) {
+	    ++ns->soft_errors;
 	    return NET_SOFTERROR;
+	}
+	ns->bytes += r;
+	if (r < nleft)
+	    ++ns->short_io;
 	nleft -= r;
 	buf += r;
     }
@@ -288,6 +324,12 @@ has_sendfile(void)
 
 int
 Nsendfile(int fromfd, int tofd, const char *buf, size_t count)
+{
+    return Nsendfile_counted(fromfd, tofd, buf, count, &net_stats_discard);
+}
+
+int
+Nsendfile_counted(int fromfd, int tofd, const char *buf, size_t count, struct net_stats *ns)
 {
     off_t offset;
 #if defined(HAVE_SENDFILE)
@@ -320,21 +362,29 @@ Nsendfile(int fromfd, int tofd, const char *buf, size_t count)
 #endif
 #endif
 #endif
+	++ns->calls;
 	if (r < 0) {
 	    switch (errno) {
 		case EINTR:
 		case EAGAIN:
+		++ns->eagain;
 		return count - nleft;
 
 		case ENOBUFS:
 		case ENOMEM:
+		++ns->soft_errors;
 		return NET_SOFTERROR;
 
 		default:
 		return NET_HARDERROR;
 	    }
-	} else if (r == 0)
+	} else if (r == 0) {
+	    ++ns->soft_errors;
 	    return NET_SOFTERROR;
+	}
+	ns->bytes += r;
+	if (r < nleft)
+	    ++ns->short_io;
 	nleft -= r;
     }
     return count;
@@ -458,3 +508,52 @@ getsockdomain(int sock)
 	return -1;
     return sa.sa_family;
 }
+
+/****************************************************************************/
+
+/*
+ * Sample the socket's kernel memory and queues.  SO_MEMINFO gives the
+ * allocations, backlog and drops; without it only the buffer sizes
+ * are known.  Anything not available is left at -1.
+ */
+void
+getsockmem(int sock, struct net_sockmem *m)
+{
+    int n;
+    socklen_t len;
+#ifdef HAVE_SO_MEMINFO
+    uint32_t mem[SK_MEMINFO_VARS];
+#endif
+
+    m->rmem_alloc = m->rcvbuf = m->wmem_alloc = m->wmem_queued = m->sndbuf = -1;
+    m->backlog = m->drops = m->inq = m->outq = -1;
+#ifdef HAVE_SO_MEMINFO
+    len = sizeof(mem);
+    memset(mem, 0, sizeof(mem));
+    if (getsockopt(sock, SOL_SOCKET, SO_MEMINFO, mem, &len) == 0) {
+	m->rmem_alloc = mem[SK_MEMINFO_RMEM_ALLOC];
+	m->rcvbuf = mem[SK_MEMINFO_RCVBUF];
+	m->wmem_alloc = mem[SK_MEMINFO_WMEM_ALLOC];
+	m->sndbuf = mem[SK_MEMINFO_SNDBUF];
+	m->wmem_queued = mem[SK_MEMINFO_WMEM_QUEUED];
+	if (len > SK_MEMINFO_BACKLOG * sizeof(uint32_t))
+	    m->backlog = mem[SK_MEMINFO_BACKLOG];
+	if (len > SK_MEMINFO_DROPS * sizeof(uint32_t))
+	    m->drops = mem[SK_MEMINFO_DROPS];
+    }
+#endif
+    if (m->rcvbuf < 0) {
+	len = sizeof(n);
+	if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &n, &len) == 0)
+	    m->rcvbuf = n;
+	len = sizeof(n);
+	if (getsockopt(sock, SOL_SOCKET, SO_SNDBUF, &n, &len) == 0)
+	    m->sndbuf = n;
+    }
+    if (ioctl(sock, FIONREAD, &n) == 0)
+	m->inq = n;
+#ifdef SIOCOUTQ
+    if (ioctl(sock, SIOCOUTQ, &n) == 0)
+	m->outq = n;
+#endif
+}
@@ -27,16 +27,60 @@
 #ifndef __NET_H
 #define __NET_H
 
+#include <sys/types.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+/*
+ * What the data path's system calls did.  A call that moves fewer
+ * bytes than it was asked to is short; a soft error is one that the
+ * test carries on from, such as ENOBUFS.
+ */
+struct net_stats
+{
+    uint64_t  calls;
+    uint64_t  bytes;
+    uint64_t  eagain;			/* EAGAIN or EINTR, nothing moved */
+    uint64_t  short_io;
+    uint64_t  soft_errors;
+};
+
+/*
+ * A socket's kernel memory and queues, in bytes: what is allocated
+ * against the receive and send buffers and how big they are, the
+ * backlog and the packets dropped since the socket was opened, and
+ * the bytes unread (for UDP, the next datagram) and unsent.  Any of
+ * them is -1 if the kernel does not report it.
+ */
+struct net_sockmem
+{
+    int64_t   rmem_alloc;
+    int64_t   rcvbuf;
+    int64_t   wmem_alloc;
+    int64_t   wmem_queued;			/* TCP: queued, not yet sent */
+    int64_t   sndbuf;
+    int64_t   backlog;
+    int64_t   drops;
+    int64_t   inq;
+    int64_t   outq;
+};
+
 int netdial(int domain, int proto, char *local, int local_port, char *server, int port);
 int netannounce(int domain, int proto, char *local, int port);
 int Nread(int fd, char *buf, size_t count, int prot);
 int Nwrite(int fd, const char *buf, size_t count, int prot) /* __attribute__((hot)) */;
 int has_sendfile(void);
 int Nsendfile(int fromfd, int tofd, const char *buf, size_t count) /* __attribute__((hot)) */;
+/* The same, adding what each system call did to *ns. */
+int Nread_counted(int fd, char *buf, size_t count, int prot, struct net_stats *ns);
+int Nwrite_counted(int fd, const char *buf, size_t count, int prot, struct net_stats *ns) /* __attribute__((hot)) */;
+int Nsendfile_counted(int fromfd, int tofd, const char *buf, size_t count, struct net_stats *ns) /* __attribute__((hot)) */;
 int getsock_tcp_mss(int inSock);
 int set_tcp_options(int sock, int no_delay, int mss);
 int setnonblocking(int fd, int nonblocking);
 int getsockdomain(int sock);
+void getsockmem(int sock, struct net_sockmem *m);
 
 #define NET_SOFTERROR -1
 #define NET_HARDERROR -2
@@ -0,0 +1,178 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_binlog.h"
+
+static void
+write_header(FILE *f)
+{
+    uint32_t words[2];
+
+    words[0] = htonl(BINLOG_VERSION);
+    words[1] = 0;
+    fwrite(BINLOG_MAGIC, 8, 1, f);
+    fwrite(words, sizeof(words), 1, f);
+}
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_binlog_record r, got;
+    unsigned char buf[BINLOG_MAX_RECORD + 8];
+    uint16_t h[2];
+    FILE *f;
+    int len, i;
+    struct iperf_test *test;
+    struct iperf_stream sp;
+    struct iperf_interval_results ir;
+    struct timeval now;
+
+    memset(&r, 0, sizeof(r));
+    r.type = BINLOG_STREAM_INTERVAL;
+    r.start_us = 5000000000ULL;		/* needs all 64 bits */
+    r.duration_us = 100000;
+    r.streams = 7;
+    r.flags = BINLOG_F_SENDER | BINLOG_F_OMITTED;
+    r.bytes = 123456789012ULL;
+    r.retrans = 3;
+    r.snd_cwnd = 65160;
+    r.rtt_us = 250;
+    len = iperf_binlog_encode(&r, buf);
+    assert(len == 56);
+    assert(buf[0] == 0 && buf[1] == BINLOG_STREAM_INTERVAL);
+    assert(buf[2] == 0 && buf[3] == 56);
+
+    r.type = 99;
+    assert(iperf_binlog_encode(&r, buf) == -1);
+    r.type = BINLOG_STREAM_INTERVAL;
+
+    f = tmpfile();
+    assert(f != NULL);
+    write_header(f);
+    iperf_binlog_encode(&r, buf);
+    fwrite(buf, len, 1, f);
+
+    /* A later version's record, four bytes longer. */
+    h[0] = htons(BINLOG_STREAM_INTERVAL);
+    h[1] = htons(len + 4);
+    memcpy(buf, h, 4);
+    fwrite(buf, len, 1, f);
+    fwrite("more", 4, 1, f);
+
+    /* A type this reader does not know. */
+    h[0] = htons(77);
+    h[1] = htons(8);
+    fwrite(h, 4, 1, f);
+    fwrite("skip", 4, 1, f);
+
+    /* A second log appended with cat, with an older, shorter record. */
+    write_header(f);
+    iperf_binlog_encode(&r, buf);
+    h[0] = htons(BINLOG_STREAM_INTERVAL);
+    h[1] = htons(4 + 8 + 4);
+    memcpy(buf, h, 4);
+    fwrite(buf, 16, 1, f);
+
+    /* Cut short. */
+    iperf_binlog_encode(&r, buf);
+    fwrite(buf, 10, 1, f);
+
+    rewind(f);
+    assert(iperf_binlog_read_header(f) == BINLOG_VERSION);
+    for (i = 0; i < 2; ++i) {
+	assert(iperf_binlog_read(f, &got) == 1);
+	assert(memcmp(&got, &r, sizeof(r)) == 0);
+    }
+    assert(iperf_binlog_read(f, &got) == 1);
+    assert(got.type == 77 && iperf_binlog_fields(got.type) == NULL);
+    assert(iperf_binlog_read(f, &got) == 1);
+    assert(got.type == BINLOG_STREAM_INTERVAL);
+    assert(got.start_us == r.start_us && got.duration_us == r.duration_us);
+    assert(got.streams == 0 && got.bytes == 0);
+    assert(iperf_binlog_read(f, &got) == -1);
+    fclose(f);
+
+    /* Every type comes back as it went out. */
+    for (i = BINLOG_TEST; i < BINLOG_TYPES; ++i) {
+	const struct iperf_binlog_field *fp;
+	uint64_t v = 1;
+
+	memset(&r, 0, sizeof(r));
+	r.type = i;
+	for (fp = iperf_binlog_fields(i); fp->name != NULL; ++fp, ++v)
+	    memcpy((char *) &r + fp->offset, &v, sizeof(v));
+	f = tmpfile();
+	write_header(f);
+	len = iperf_binlog_encode(&r, buf);
+	assert(len > 4 && len <= BINLOG_MAX_RECORD);
+	fwrite(buf, len, 1, f);
+	rewind(f);
+	assert(iperf_binlog_read_header(f) == BINLOG_VERSION);
+	assert(iperf_binlog_read(f, &got) == 1);
+	assert(memcmp(&got, &r, sizeof(r)) == 0);
+	assert(iperf_binlog_read(f, &got) == 0);
+	fclose(f);
+    }
+
+    f = tmpfile();
+    fwrite("not a log at all", 16, 1, f);
+    rewind(f);
+    assert(iperf_binlog_read_header(f) == -1);
+    fclose(f);
+
+    /* A write that fails closes the log, and nothing touches it after. */
+    test = iperf_new_test();
+    assert(test != NULL);
+    iperf_defaults(test);
+    test->binlog_name = strdup("/dev/full");
+    gettimeofday(&now, NULL);
+    assert(iperf_binlog_open(test, &now) == 0);
+    memset(&sp, 0, sizeof(sp));
+    sp.id = 1;
+    memset(&ir, 0, sizeof(ir));
+    ir.interval_start_time = now;
+    ir.interval_duration = 1.0;
+    ir.bytes_transferred = 1000;
+    for (i = 0; i < BINLOG_BUFSIZE && test->binlog != NULL; ++i)
+	iperf_binlog_stream_interval(test, &sp, &ir);
+    assert(test->binlog == NULL);
+    iperf_free_test(test);
+
+    return 0;
+}
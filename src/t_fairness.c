@@ -0,0 +1,112 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "iperf_fairness.h"
+
+static int
+close_to(double got, double want)
+{
+    return fabs(got - want) < 1e-9;
+}
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_fairness f;
+    double equal[4] = { 10, 10, 10, 10 };
+    double hog[4] = { 40, 0, 0, 0 };
+    double mixed[2] = { 30, 10 };
+    double ramp[8] = { 1, 4, 9, 10, 11, 10, 10, 9 };
+    double wobble[4] = { 10, 10, 10, 2 };
+    struct iperf_fairness_series series;
+    int i;
+
+    iperf_fairness_compute(equal, 4, &f);
+    assert(f.n == 4);
+    assert(close_to(f.jain, 1));
+    assert(close_to(f.min, 10) && close_to(f.max, 10));
+    assert(close_to(f.mean, 10) && close_to(f.stddev, 0));
+
+    iperf_fairness_compute(hog, 4, &f);
+    assert(close_to(f.jain, 0.25));
+    assert(close_to(f.min, 0) && close_to(f.max, 40));
+
+    /* 40^2 / (2 * 1000) */
+    iperf_fairness_compute(mixed, 2, &f);
+    assert(close_to(f.jain, 0.8));
+    assert(close_to(f.mean, 20) && close_to(f.stddev, 10));
+
+    iperf_fairness_compute(equal, 0, &f);
+    assert(f.jain == 0);
+
+    /* The share is 10; the ramp is within 20% from the third interval. */
+    assert(close_to(iperf_fairness_steady(ramp, 8, FAIRNESS_STEADY_TOLERANCE, &i), 10));
+    assert(i == 2);
+
+    /* Steady from the start. */
+    iperf_fairness_steady(equal, 4, FAIRNESS_STEADY_TOLERANCE, &i);
+    assert(i == 0);
+
+    /* The last interval is off, so it never settled. */
+    iperf_fairness_steady(wobble, 4, FAIRNESS_STEADY_TOLERANCE, &i);
+    assert(i == -1);
+
+    iperf_fairness_steady(hog, 0, FAIRNESS_STEADY_TOLERANCE, &i);
+    assert(i == -1);
+
+    /* A series of one-second intervals is the ramp again. */
+    iperf_fairness_series_reset(&series);
+    for (i = 0; i < 8; ++i)
+	iperf_fairness_series_add(&series, i, ramp[i], 1);
+    assert(close_to(iperf_fairness_series_steady(&series, FAIRNESS_STEADY_TOLERANCE, &i), 10));
+    assert(close_to(series.start[i], 2));
+
+    /*
+     * A long test stays within FAIRNESS_SERIES_MAX buckets.  Slow for
+     * the first 1000 intervals, then steady at 10.
+     */
+    iperf_fairness_series_reset(&series);
+    for (i = 0; i < 10000; ++i) {
+	iperf_fairness_series_add(&series, i, i < 1000 ? 1 : 10, 1);
+	assert(series.n < FAIRNESS_SERIES_MAX);
+    }
+    assert(series.span == 32);
+    assert(close_to(iperf_fairness_series_steady(&series, FAIRNESS_STEADY_TOLERANCE, &i), 10));
+    /* The bucket holding interval 1000 is part slow, so the next one. */
+    assert(close_to(series.start[i], 1024));
+
+    iperf_fairness_series_reset(&series);
+    iperf_fairness_series_steady(&series, FAIRNESS_STEADY_TOLERANCE, &i);
+    assert(i == -1);
+
+    return 0;
+}
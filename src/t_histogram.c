@@ -0,0 +1,113 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iperf_histogram.h"
+#include "cjson.h"
+
+/* Within the ~3% resolution of a bucket. */
+static int
+close_to(int64_t got, int64_t want)
+{
+    double err = (double) (got - want);
+
+    if (err < 0)
+	err = -err;
+    return err <= 0.04 * want + 1;
+}
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_histogram *h, *h2, *h3;
+    struct iperf_histogram_summary s;
+    cJSON *j;
+    char *str;
+    int64_t i;
+
+    h = iperf_histogram_new();
+    assert(h != NULL);
+    assert(iperf_histogram_percentile(h, 50) == 0);
+
+    /* 1..100000 us, uniformly */
+    for (i = 1; i <= 100000; ++i)
+	iperf_histogram_record(h, i * 1000);
+    assert(h->count == 100000);
+    assert(h->min == 1000);
+    assert(h->max == 100000000);
+    assert(close_to(iperf_histogram_percentile(h, 50), 50000000));
+    assert(close_to(iperf_histogram_percentile(h, 90), 90000000));
+    assert(close_to(iperf_histogram_percentile(h, 99), 99000000));
+    assert(iperf_histogram_percentile(h, 100) == h->max);
+
+    iperf_histogram_summarize(h, &s);
+    assert(s.count == 100000);
+    assert(s.max == 0.1);
+    assert(s.p50 > 0.048 && s.p50 < 0.052);
+
+    /* Small values are exact, negative ones count as zero. */
+    h2 = iperf_histogram_new();
+    iperf_histogram_record(h2, -5);
+    iperf_histogram_record(h2, 7);
+    iperf_histogram_record(h2, 7);
+    assert(h2->min == 0);
+    assert(iperf_histogram_percentile(h2, 34) == 7);
+    assert(iperf_histogram_percentile(h2, 33) == 0);
+
+    /* Merge */
+    iperf_histogram_merge(h2, h);
+    assert(h2->count == 100003);
+    assert(h2->min == 0 && h2->max == 100000000);
+
+    /* JSON round trip */
+    j = iperf_histogram_to_json(h);
+    str = cJSON_PrintUnformatted(j);
+    cJSON_Delete(j);
+    j = cJSON_Parse(str);
+    free(str);
+    h3 = iperf_histogram_new();
+    assert(iperf_histogram_from_json(h3, j) == 0);
+    cJSON_Delete(j);
+    assert(memcmp(h, h3, sizeof(*h)) == 0);
+
+    iperf_histogram_reset(h);
+    assert(h->count == 0 && iperf_histogram_percentile(h, 99) == 0);
+
+    iperf_histogram_free(h);
+    iperf_histogram_free(h2);
+    iperf_histogram_free(h3);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf_live.h"
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_live_header *h, copy;
+    struct iperf_live *lv;
+
+    /* The layout readers in other languages are written against. */
+    assert(sizeof(struct iperf_live_header) == 112);
+    assert(offsetof(struct iperf_live_header, seq) == 24);
+    assert(offsetof(struct iperf_live_header, bytes) == 80);
+    assert(sizeof(struct iperf_live_stream) == 56);
+
+    h = (struct iperf_live_header *) calloc(1, LIVE_FILE_SIZE);
+    assert(h != NULL);
+    h->bytes = 1;
+
+    iperf_live_write_begin(h);
+    assert(h->seq == 1);
+    h->bytes = 2;
+    /* No consistent copy while an update is in progress. */
+    assert(iperf_live_read(h, &copy, sizeof(copy)) == -1);
+    iperf_live_write_end(h);
+    assert(h->seq == 2);
+    assert(iperf_live_read(h, &copy, sizeof(copy)) == 0);
+    assert(copy.seq == 2 && copy.bytes == 2);
+    free(h);
+
+    lv = iperf_live_parse("/tmp/x,a,b,2.5");
+    assert(lv != NULL);
+    assert(strcmp(lv->file_name, "/tmp/x,a,b") == 0);
+    assert(lv->period == 2500);
+    free(lv->file_name);
+    free(lv);
+    lv = iperf_live_parse("/tmp/x");
+    assert(lv != NULL && lv->period == LIVE_DEFAULT_PERIOD);
+    free(lv->file_name);
+    free(lv);
+    assert(iperf_live_parse("/tmp/x,0.5") == NULL);
+    assert(iperf_live_parse(",10") == NULL);
+    assert(iperf_live_parse("/tmp/x,") == NULL);
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf.h"
+#include "iperf_api.h"
+#include "iperf_metrics.h"
+
+/*
+ * Every sample has to come after its own family's TYPE line, with no
+ * other family in between, and a family is described only once.
+ */
+static void
+check_families(char *text)
+{
+    char family[128], seen[64][128];
+    char *line, *next;
+    size_t n;
+    int nseen = 0, i;
+
+    family[0] = '\0';
+    for (line = text; *line != '\0'; line = next) {
+	next = strchr(line, '\n');
+	assert(next != NULL);
+	*next++ = '\0';
+	if (strncmp(line, "# TYPE ", 7) == 0) {
+	    n = strcspn(line + 7, " ");
+	    assert(n < sizeof(family));
+	    memcpy(family, line + 7, n);
+	    family[n] = '\0';
+	    for (i = 0; i < nseen; ++i)
+		assert(strcmp(seen[i], family) != 0);
+	    assert(nseen < 64);
+	    strcpy(seen[nseen++], family);
+	} else if (strncmp(line, "# HELP ", 7) == 0) {
+	    n = strlen(family);
+	    assert(strncmp(line + 7, family, n) == 0 && line[7 + n] == ' ');
+	} else if (strcmp(line, "# EOF") == 0) {
+	    assert(*next == '\0');
+	} else {
+	    n = strlen(family);
+	    assert(n > 0 && strncmp(line, family, n) == 0);
+	    assert(strchr("_{ ", line[n]) != NULL);
+	}
+    }
+}
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_test *test;
+    struct iperf_metrics *m;
+    char *text;
+
+    test = iperf_new_test();
+    assert(test != NULL);
+    iperf_defaults(test);
+    m = (struct iperf_metrics *) calloc(1, sizeof(struct iperf_metrics));
+    assert(m != NULL);
+    test->metrics = m;
+
+    m->tests = 3;
+    m->nerrors = 1;
+    m->errors[0].code = IESTREAMREAD;
+    m->errors[0].count = 2;
+    strcpy(m->errors[0].message, "a \"quoted\" message");
+    text = iperf_metrics_render(test);
+    assert(text != NULL);
+    assert(strstr(text, "iperf3_server_tests_total 3\n") != NULL);
+    assert(strstr(text, "error=\"a \\\"quoted\\\" message\"} 2\n") != NULL);
+    assert(strstr(text, "iperf3_server_test_seconds") == NULL);
+    check_families(text);
+    free(text);
+
+    m->have_last = 1;
+    m->last.seconds = 10;
+    m->last.bytes = 1250000000;
+    m->last.streams = 2;
+    text = iperf_metrics_render(test);
+    assert(text != NULL);
+    assert(strstr(text, "# HELP iperf3_server_test_bytes Test data moved by this side, after --omit.\n"
+		  "iperf3_server_test_bytes{test=\"last\"} 1250000000\n"
+		  "# TYPE iperf3_server_test_bits_per_second gauge\n") != NULL);
+    assert(strstr(text, "iperf3_server_test_bits_per_second{test=\"last\"} 1000000000\n") != NULL);
+    check_families(text);
+    free(text);
+
+    /* Not a real listener; keep iperf_free_test from closing it. */
+    test->metrics = NULL;
+    free(m);
+    iperf_free_test(test);
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include "iperf_sample.h"
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_sample_ring *r;
+    struct iperf_sample_stats st;
+    uint64_t t;
+
+    r = iperf_sample_ring_new(8);
+    assert(r != NULL);
+    assert(iperf_sample_summarize(r, 0, &st) == -1);
+
+    /* 1 ms samples of 1000 bytes, with two stalls of 1 and 2 ms. */
+    iperf_sample_add(r, 1000, 1000);
+    iperf_sample_add(r, 2000, 0);
+    iperf_sample_add(r, 3000, 1000);
+    iperf_sample_add(r, 4000, 0);
+    iperf_sample_add(r, 5000, 0);
+    iperf_sample_add(r, 6000, 2000);
+    assert(iperf_sample_summarize(r, 0, &st) == 0);
+    assert(st.samples == 6);
+    assert(st.min == 0);
+    assert(fabs(st.median - 500000) < 1e-6);
+    assert(fabs(st.max - 2000000) < 1e-6);
+    assert(st.stalls == 2);
+    assert(fabs(st.longest_stall - 0.002) < 1e-9);
+
+    /* Samples up to and including from_us are left out. */
+    assert(iperf_sample_summarize(r, 3000, &st) == 0);
+    assert(st.samples == 3 && st.stalls == 1);
+
+    /* Overwritten: the oldest left only marks the start of the next. */
+    for (t = 7000; t <= 12000; t += 1000)
+	iperf_sample_add(r, t, 1000);
+    assert(r->head - r->tail == 8);
+    assert(iperf_sample_summarize(r, 0, &st) == 0);
+    assert(st.samples == 7);
+    assert(st.stalls == 0);		/* the 5 ms one is the marker */
+    assert(fabs(st.min - 1000000) < 1e-6);
+    assert(fabs(st.max - 2000000) < 1e-6);
+
+    iperf_sample_ring_free(r);
+    return 0;
+}
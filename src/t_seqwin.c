@@ -0,0 +1,108 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#include "iperf_config.h"
+
+#include <assert.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "iperf_seqwin.h"
+#include "cjson.h"
+
+int 
+main(int argc, char **argv)
+{
+    struct iperf_seqwin *w;
+    struct iperf_seqwin_counts c;
+    cJSON *j;
+    uint64_t s;
+
+    /* In order: nothing to report. */
+    w = iperf_seqwin_new();
+    assert(w != NULL);
+    for (s = 1; s <= 5000; ++s)
+	assert(iperf_seqwin_record(w, s) == SEQWIN_NEW);
+    iperf_seqwin_flush(w);
+    assert(iperf_seqwin_total(w->total.reorder) == 0);
+    assert(iperf_seqwin_total(w->total.bursts) == 0);
+    assert(w->total.duplicates == 0);
+    iperf_seqwin_free(w);
+
+    /* A swap is one late datagram and no loss; a repeat is a duplicate. */
+    w = iperf_seqwin_new();
+    assert(iperf_seqwin_record(w, 1) == SEQWIN_NEW);
+    assert(iperf_seqwin_record(w, 2) == SEQWIN_NEW);
+    assert(iperf_seqwin_record(w, 4) == SEQWIN_NEW);
+    assert(iperf_seqwin_record(w, 3) == SEQWIN_LATE);
+    assert(iperf_seqwin_record(w, 3) == SEQWIN_DUPLICATE);
+    assert(iperf_seqwin_record(w, 9) == SEQWIN_NEW);
+    assert(iperf_seqwin_record(w, 5) == SEQWIN_LATE);
+    assert(w->total.reorder[0] == 1);		/* 3, one behind 4 */
+    assert(w->total.reorder[2] == 1);		/* 5, four behind 9 */
+    assert(w->total.duplicates == 1);
+    assert(w->interval.duplicates == 1);
+    iperf_seqwin_flush(w);
+    assert(w->total.bursts[1] == 1);		/* 6-8 */
+    assert(iperf_seqwin_total(w->total.bursts) == 1);
+    iperf_seqwin_free(w);
+
+    /* Losses are settled as they leave the window. */
+    w = iperf_seqwin_new();
+    for (s = 1; s <= 3 * SEQWIN_SIZE; ++s)
+	if (s != 10 && s != 20 && s != 21)
+	    iperf_seqwin_record(w, s);
+    assert(w->total.bursts[0] == 1 && w->total.bursts[1] == 1);
+    /* Too late to tell from a duplicate: reordered, still lost. */
+    assert(iperf_seqwin_record(w, 10) == SEQWIN_STALE);
+    assert(w->total.reorder[SEQWIN_BUCKETS - 1] == 1);
+    assert(iperf_seqwin_total(w->total.bursts) == 2);
+
+    /* A jump past the window is one long burst. */
+    iperf_seqwin_record(w, 100000);
+    iperf_seqwin_flush(w);
+    assert(w->total.bursts[SEQWIN_BUCKETS - 1] == 1);
+    assert(iperf_seqwin_total(w->total.bursts) == 3);
+    iperf_seqwin_flush(w);
+    assert(iperf_seqwin_total(w->total.bursts) == 3);
+
+    /* JSON round trip */
+    j = iperf_seqwin_to_json(&w->total);
+    assert(j != NULL);
+    assert(iperf_seqwin_from_json(&c, j) == 0);
+    cJSON_Delete(j);
+    assert(memcmp(&c, &w->total, sizeof(c)) == 0);
+
+    iperf_seqwin_reset(w);
+    assert(iperf_seqwin_total(w->total.bursts) == 0);
+    iperf_seqwin_free(w);
+
+    return 0;
+}
@@ -48,14 +48,17 @@
 #include <sys/param.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
 #include <netinet/tcp.h>
 #include <string.h>
 #include <netinet/in.h>
 #include <errno.h>
+#include <stddef.h>
 
 #include "iperf.h"
 #include "iperf_api.h"
 #include "iperf_locale.h"
+#include "tcp_info_ext.h"
 
 /*************************************************************/
 int
@@ -159,6 +162,79 @@ get_rtt(struct iperf_interval_results *irp)
 #endif
 }
 
+/*************************************************************/
+/*
+ * Read the connection's totals of sender-limited time from extended
+ * TCP_INFO, feature-detected by the length the kernel returns.
+ */
+void
+save_tcpinfo_limits(struct iperf_stream *sp, struct iperf_tcp_limits *l)
+{
+    struct iperf_tcp_info_ext ti;
+    int len;
+
+    l->busy = l->rwnd = l->sndbuf = l->bytes_retrans = l->delivery_rate = -1;
+    if ((len = get_tcpinfo_ext(sp->socket, &ti)) < 0)
+	return;
+    if (TCP_INFO_EXT_HAS(len, tcpi_sndbuf_limited)) {
+	l->busy = ti.tcpi_busy_time;
+	l->rwnd = ti.tcpi_rwnd_limited;
+	l->sndbuf = ti.tcpi_sndbuf_limited;
+    }
+    if (TCP_INFO_EXT_HAS(len, tcpi_bytes_retrans))
+	l->bytes_retrans = ti.tcpi_bytes_retrans;
+    if (TCP_INFO_EXT_HAS(len, tcpi_delivery_rate))
+	l->delivery_rate = ti.tcpi_delivery_rate;
+}
+
+/*************************************************************/
+/*
+ * Read the receiving side of the socket: TCP_INFO for the receive
+ * RTT, space, window clamp and out-of-order count, and SIOCINQ
+ * (FIONREAD on TCP) for the bytes waiting to be read.
+ */
+void
+save_tcpinfo_rcv(struct iperf_stream *sp, struct iperf_tcp_rcv *r)
+{
+    struct iperf_tcp_info_ext ti;
+    int len, inq;
+
+    r->rcv_rtt = r->rcv_space = r->rcv_ssthresh = r->ooopack = r->inq = -1;
+    if ((len = get_tcpinfo_ext(sp->socket, &ti)) < 0)
+	return;
+    if (TCP_INFO_EXT_HAS(len, tcpi_rcv_space)) {
+	r->rcv_rtt = ti.tcpi_rcv_rtt;
+	r->rcv_space = ti.tcpi_rcv_space;
+	r->rcv_ssthresh = ti.tcpi_rcv_ssthresh;
+    }
+    if (TCP_INFO_EXT_HAS(len, tcpi_rcv_ooopack))
+	r->ooopack = ti.tcpi_rcv_ooopack;
+    if (ioctl(sp->socket, FIONREAD, &inq) == 0)
+	r->inq = inq;
+}
+
+/*************************************************************/
+/*
+ * Read the kernel's full struct tcp_info, including the fields newer
+ * than the C library's copy.  Returns the number of bytes the kernel
+ * filled in (see TCP_INFO_EXT_HAS), or -1.
+ */
+int
+get_tcpinfo_ext(int fd, struct iperf_tcp_info_ext *ti)
+{
+#if defined(linux)
+    socklen_t len = sizeof(*ti);
+
+    memset(ti, 0, sizeof(*ti));
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, (void *) ti, &len) < 0)
+	return -1;
+    return len;
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
 /*************************************************************/
 void
 build_tcpinfo_message(struct iperf_interval_results *r, char *message)
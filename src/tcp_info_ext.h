@@ -0,0 +1,121 @@
+/*
+ * iperf, Copyright (c) 2014, The Regents of the University of
+ * California, through Lawrence Berkeley National Laboratory (subject
+ * to receipt of any required approvals from the U.S. Dept. of
+ * Energy).  All rights reserved.
+ *
+ * If you have questions about your rights to use or distribute this
+ * software, please contact Berkeley Lab's Technology Transfer
+ * Department at TTD@lbl.gov.
+ *
+ * NOTICE.  This software is owned by the U.S. Department of Energy.
+ * As such, the U.S. Government has been granted for itself and others
+ * acting on its behalf a paid-up, nonexclusive, irrevocable,
+ * worldwide license in the Software to reproduce, prepare derivative
+ * works, and perform publicly and display publicly.  Beginning five
+ * (5) years after the date permission to assert copyright is obtained
+ * from the U.S. Department of Energy, and subject to any subsequent
+ * five (5) year renewals, the U.S. Government is granted for itself
+ * and others acting on its behalf a paid-up, nonexclusive,
+ * irrevocable, worldwide license in the Software to reproduce,
+ * prepare derivative works, distribute copies to the public, perform
+ * publicly and display publicly, and to permit others to do so.
+ *
+ * This code is distributed under a BSD style license, see the LICENSE
+ * file for complete information.
+ */
+#ifndef        __TCP_INFO_EXT_H
+#define        __TCP_INFO_EXT_H
+
+#include <stdint.h>
+
+/*
+   A copy of the Linux kernel's "struct tcp_info" from "linux/tcp.h".
+   The C library's "netinet/tcp.h" stops at tcpi_total_retrans, and
+   "linux/tcp.h" cannot be included next to it.  Kernels fill in as
+   much of the structure as they know about and return that length,
+   so any field past the returned length must be taken as missing.
+*/
+
+struct iperf_tcp_info_ext
+{
+    uint8_t   tcpi_state;
+    uint8_t   tcpi_ca_state;
+    uint8_t   tcpi_retransmits;
+    uint8_t   tcpi_probes;
+    uint8_t   tcpi_backoff;
+    uint8_t   tcpi_options;
+    uint8_t   tcpi_wscale;		/* snd:4, rcv:4 */
+    uint8_t   tcpi_flags;		/* delivery_rate_app_limited:1, ... */
+
+    uint32_t  tcpi_rto;
+    uint32_t  tcpi_ato;
+    uint32_t  tcpi_snd_mss;
+    uint32_t  tcpi_rcv_mss;
+
+    uint32_t  tcpi_unacked;
+    uint32_t  tcpi_sacked;
+    uint32_t  tcpi_lost;
+    uint32_t  tcpi_retrans;
+    uint32_t  tcpi_fackets;
+
+    uint32_t  tcpi_last_data_sent;
+    uint32_t  tcpi_last_ack_sent;
+    uint32_t  tcpi_last_data_recv;
+    uint32_t  tcpi_last_ack_recv;
+
+    uint32_t  tcpi_pmtu;
+    uint32_t  tcpi_rcv_ssthresh;
+    uint32_t  tcpi_rtt;
+    uint32_t  tcpi_rttvar;
+    uint32_t  tcpi_snd_ssthresh;
+    uint32_t  tcpi_snd_cwnd;
+    uint32_t  tcpi_advmss;
+    uint32_t  tcpi_reordering;
+
+    uint32_t  tcpi_rcv_rtt;
+    uint32_t  tcpi_rcv_space;
+
+    uint32_t  tcpi_total_retrans;
+
+    /* Linux 3.15 and later */
+    uint64_t  tcpi_pacing_rate;
+    uint64_t  tcpi_max_pacing_rate;
+    uint64_t  tcpi_bytes_acked;
+    uint64_t  tcpi_bytes_received;
+    uint32_t  tcpi_segs_out;
+    uint32_t  tcpi_segs_in;
+
+    uint32_t  tcpi_notsent_bytes;
+    uint32_t  tcpi_min_rtt;
+    uint32_t  tcpi_data_segs_in;
+    uint32_t  tcpi_data_segs_out;
+
+    /* Linux 4.9 and later */
+    uint64_t  tcpi_delivery_rate;
+
+    /* Linux 4.10 and later */
+    uint64_t  tcpi_busy_time;
+    uint64_t  tcpi_rwnd_limited;
+    uint64_t  tcpi_sndbuf_limited;
+
+    /* Linux 4.18 and later */
+    uint32_t  tcpi_delivered;
+    uint32_t  tcpi_delivered_ce;
+
+    uint64_t  tcpi_bytes_sent;
+    uint64_t  tcpi_bytes_retrans;
+    uint32_t  tcpi_dsack_dups;
+    uint32_t  tcpi_reord_seen;
+
+    /* Linux 5.4 and later */
+    uint32_t  tcpi_rcv_ooopack;
+
+    uint32_t  tcpi_snd_wnd;
+};
+
+/* Whether a field was filled in by a getsockopt() that returned len bytes. */
+#define TCP_INFO_EXT_HAS(len, field) \
+    ((len) >= offsetof(struct iperf_tcp_info_ext, field) + sizeof(((struct iperf_tcp_info_ext *) 0)->field))
+
+#endif